@@ -9,136 +9,221 @@
 #include "ape_reader.h"
 #include "..\image_loader.h"
 #include "..\utils_common.h"
+#include "tag_tail.h"
 #include <shlwapi.h>
 #pragma comment(lib, "shlwapi.lib")
 
+typedef unsigned __int64 U64;
+
 // ============================================================================
 // Tag Location Structure / Структура расположения тега
 // ============================================================================
 typedef struct {
-  DWORD absStart;   ///< Absolute offset to tag start / Абсолютное смещение начала тега
-  DWORD absFooter;  ///< Absolute offset to tag footer / Абсолютное смещение footer'а
-  DWORD totalSize;  ///< Total tag size including header/footer / Полный размер тега
+  U64   absStart;   ///< Absolute offset of the first item / Абсолютное смещение первого элемента
+  U64   absFooter;  ///< Absolute offset to tag footer / Абсолютное смещение footer'а
+  DWORD totalSize;  ///< Tag size including footer, excluding header / Размер тега с footer'ом, без заголовка
+  DWORD items;      ///< Item count from the footer / Количество элементов из footer'а
 } ApeLoc;
 
+#define APE_WINDOW       4096                 ///< Item headers are read in blocks of this size / Заголовки элементов читаются блоками такого размера
+#define APE_MAX_KEY      255                  ///< Longest key the spec allows / Наибольший ключ по спецификации
+#define APE_MAX_NAME     256                  ///< File name searched in front of the image / Имя файла, ищущееся перед изображением
+#define APE_MAX_ITEMS    32                   ///< Picture items kept / Хранится элементов-изображений
+#define APE_MAX_PICTURE  (16 * 1024 * 1024)   ///< Same limit as FLAC / Тот же предел, что у FLAC
+#define APE_SKIP_UNKNOWN 0xFFFFFFFF
+
+static APEStats s_stats = {0};
+
+static BOOL Ape_ReadAt(FileHandle& f, U64 pos, void* buf, DWORD size)
+{
+    s_stats.reads++;
+    s_stats.bytesRead += size;
+    return f.ReadAt(pos, buf, size);
+}
+
 // ============================================================================
 // Helper Functions / Вспомогательные функции
 // ============================================================================
 
 /**
- * @brief Scan file end for APEv2 footer
- * @brief Сканирование конца файла на наличие APEv2 footer'а
- * * Reads last 4KB of file to find "APETAGEX" signature.
- * Читает последние 4КБ файла для поиска сигнатуры "APETAGEX".
+ * @brief Locate the APEv2 footer in the shared tail read
+ * @brief Поиск APEv2 footer'а в общем чтении конца файла
+ * * The last 4KB come from TagTail, which the ID3v2 reader has usually read already;
+ * the footer is found behind ID3v1/Lyrics3v2 from their size fields.
+ * Последние 4КБ берутся из TagTail, который ридер ID3v2 обычно уже прочитал;
+ * footer находится за ID3v1/Lyrics3v2 по их полям размера.
+ *
+ * @param tail [out] The tail, kept to serve item headers that lie in it / Конец файла, для заголовков элементов, лежащих в нём
+ */
+static BOOL Ape_ScanFooter(FileHandle& f, const char* path, ApeLoc* out, TagTail* tail) {
+    if (!TagTail_Get(path, f, tail)) return FALSE;
+
+    TagTailApe ape;
+    if (!TagTail_FindApe(tail, &ape)) return FALSE;
+
+    out->absFooter = ape.footer;
+    out->totalSize = ape.size;
+    out->absStart = ape.footer + 32 - ape.size;
+    out->items = ape.items;
+    return TRUE;
+}
+
+/**
+ * @brief Rank a picture item by its key: 0 = front, 1 = generic, 2 = back, -1 = not a picture
+ * @brief Ранг элемента-изображения по ключу: 0 = лицевая, 1 = общая, 2 = задняя, -1 = не изображение
  */
-static BOOL Ape_ScanFooter(FileHandle& f, ApeLoc* out) {
-    DWORD fSize = f.GetSize();
-    if (fSize < 32) return FALSE;
-
-    // Read last 1KB-4KB (usually enough)
-    // Читаем последний 1КБ-4КБ (обычно достаточно)
-    DWORD scanSize = (fSize > 4096) ? 4096 : fSize;
-    BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, scanSize);
-    if (!buf) return FALSE;
-
-    if (!f.ReadAt(fSize - scanSize, buf, scanSize)) {
-        GlobalFree(buf); return FALSE;
+static int Ape_PictureRank(const char* key) {
+    // Normalize key for comparison
+    // Нормализация ключа для сравнения
+    char norm[64];
+    int o = 0;
+    for (int i=0; key[i] && o < 63; ++i) {
+        char c = key[i];
+        if (c >= 'A' && c <= 'Z') c += 32; // ToLower
+        if (c >= 'a' && c <= 'z') norm[o++] = c;
     }
+    norm[o] = 0;
 
-    // Search for "APETAGEX" backwards
-    // Ищем "APETAGEX" с конца
-    for (int i = (int)scanSize - 32; i >= 0; --i) {
-        BYTE* p = &buf[i];
-        if (memcmp(p, "APETAGEX", 8) == 0) {
-            DWORD size = LE32(p + 12); // Tag Size (including footer)
-            // Validate size
-            // Валидация размера
-            if (size >= 32 && size <= fSize) {
-                out->absFooter = (fSize - scanSize) + i;
-                out->totalSize = size;
-                out->absStart = out->absFooter + 32 - size;
-                GlobalFree(buf);
-                return TRUE;
-            }
-        }
+    int rank = -1;
+    if (StrStrIA(norm, "cover") || StrStrIA(norm, "picture")) {
+        rank = 1; // Generic
+        if (StrStrIA(norm, "front")) rank = 0; // Best
+        else if (StrStrIA(norm, "back")) rank = 2; // Fallback
     }
-    GlobalFree(buf);
-    return FALSE;
+    return rank;
+}
+
+// Bytes [at, at + need) if already in memory: the shared tail or the window
+// Байты [at, at + need), если уже в памяти: общий конец файла или окно
+static const BYTE* Ape_Held(const TagTail* t, const FileWindow* w, U64 at, DWORD need)
+{
+    if (at >= t->pos && need <= t->len && at - t->pos <= t->len - need) return t->data + (DWORD)(at - t->pos);
+    return FileWindow_Held(w, at, need);
+}
+
+// Bytes [at, at + need), reading a block of the tag only if they are not held
+// Байты [at, at + need); блок тега читается, только если их нет в памяти
+static const BYTE* Ape_View(const TagTail* t, FileWindow* w, U64 at, DWORD need)
+{
+    const BYTE* p = Ape_Held(t, w, at, need);
+    return p ? p : FileWindow_View(w, at, need);
 }
 
 /**
- * @brief Parse APEv2 items to find cover art
- * @brief Парсинг элементов APEv2 для поиска обложки
- * * Implements priority logic: Front > Cover > Back.
- * Реализует логику приоритетов: Front > Cover > Back.
+ * @brief Image bytes start after "name.jpg\0"; values without a name start with the image itself
+ * @brief Байты изображения начинаются после "name.jpg\0"; значения без имени начинаются сразу с изображения
  */
-static BOOL Ape_ParseItems(const BYTE* data, DWORD size, HBITMAP* phbm, SIZE* psz) {
-    DWORD pos = 0;
-    // Skip Header if present ("APETAGEX" at start)
-    // Пропуск заголовка если есть ("APETAGEX" в начале)
-    if (size >= 32 && memcmp(data, "APETAGEX", 8) == 0) pos = 32;
-
-    const BYTE* bestData = NULL; 
-    DWORD bestSize = 0; 
-    int bestRank = 99; // Lower is better / Чем меньше, тем лучше
-
-    while (pos + 8 <= size) {
-        DWORD valSize = LE32(data + pos);
-        // DWORD flags = LE32(data + pos + 4); // Flags unused / Флаги не используются
-        pos += 8;
-
-        DWORD keyStart = pos;
-        while (pos < size && data[pos] != 0) ++pos; // Find Key null-terminator
-        if (pos >= size) break;
-        
-        const char* key = (const char*)(data + keyStart);
-        pos++; // Skip 0x00
-
-        if (pos + valSize > size) break;
-        const BYTE* val = data + pos;
-
-        // Normalize key for comparison
-        // Нормализация ключа для сравнения
-        char norm[64];
-        int o = 0;
-        for (int i=0; key[i] && o < 63; ++i) {
-            char c = key[i];
-            if (c >= 'A' && c <= 'Z') c += 32; // ToLower
-            if (c >= 'a' && c <= 'z') norm[o++] = c;
-        }
-        norm[o] = 0;
-
-        // Determine rank
-        // Определение ранга
-        int rank = -1;
-        if (StrStrIA(norm, "cover") || StrStrIA(norm, "picture")) {
-            rank = 1; // Generic
-            if (StrStrIA(norm, "front")) rank = 0; // Best
-            else if (StrStrIA(norm, "back")) rank = 2; // Fallback
-        }
+static DWORD Ape_NameSkip(const BYTE* val, DWORD n)
+{
+    if (n >= 2 && val[0] == 0xFF && val[1] == 0xD8) return 0;        // JPEG
+    if (n >= 4 && memcmp(val, "\x89PNG", 4) == 0) return 0;
+    if (n >= 3 && memcmp(val, "GIF", 3) == 0) return 0;
 
-        if (rank >= 0) {
-            // Find binary data after filename (APE stores images as Name\0Data)
-            // Поиск бинарных данных после имени файла
-            DWORD p = 0;
-            while (p < valSize && val[p] != 0) ++p;
-            
-            const BYTE* img = (p < valSize) ? (val + p + 1) : val;
-            DWORD imgLen = (p < valSize) ? (valSize - p - 1) : valSize;
-
-            if (imgLen > 0) {
-                // Update if better rank or same rank but larger size (heuristic)
-                // Обновляем если ранг лучше или ранг тот же, но размер больше
-                if (!bestData || rank < bestRank || (rank == bestRank && imgLen > bestSize)) {
-                    bestData = img; bestSize = imgLen; bestRank = rank;
-                }
-            }
+    DWORD lim = (n < APE_MAX_NAME) ? n : APE_MAX_NAME;
+    for (DWORD p = 0; p < lim; ++p) {
+        if (val[p] == 0) return p + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief One picture item, described from its header
+ * @brief Один элемент-изображение, описанный по заголовку
+ */
+typedef struct {
+    U64   valPos;            ///< Item value in the file / Значение элемента в файле
+    DWORD valSize;
+    DWORD skip;              ///< Name in front of the image, APE_SKIP_UNKNOWN if not seen / Имя перед изображением, APE_SKIP_UNKNOWN если не видно
+    int   rank;              ///< Ape_PictureRank()
+    BOOL  failed;
+} ApeItem;
+
+/**
+ * @brief Walk the item headers and describe every picture item without reading its value
+ * @brief Обойти заголовки элементов и описать каждый элемент-изображение, не читая значения
+ *
+ * Items are [size(4)] [flags(4)] [key\0] [value]. Headers that lie in the
+ * shared tail cost nothing; the others are read in APE_WINDOW blocks, and a
+ * large value is jumped over rather than read.
+ * Элементы: [размер(4)] [флаги(4)] [ключ\0] [значение]. Заголовки в общем конце
+ * файла ничего не стоят; остальные читаются блоками APE_WINDOW, а большое
+ * значение перепрыгивается, а не читается.
+ *
+ * @return Number of picture items / Количество элементов-изображений
+ */
+static int Ape_CollectItems(FileHandle& f, const char* path, ApeItem* items, int max)
+{
+    ApeLoc  loc = {0};
+    TagTail tail;
+    if (!Ape_ScanFooter(f, path, &loc, &tail)) return 0;
+    s_stats.tags++;
+
+    U64 pos = loc.absStart;
+    U64 end = loc.absFooter;
+    FileWindow w;
+    FileWindow_Init(&w, f, APE_WINDOW, &s_stats.reads, &s_stats.bytesRead);
+    w.end = end;   // blocks are clipped to the tag / блоки обрезаются по тегу
+
+    // Some writers count the header in the tag size, so it precedes the items
+    // Некоторые программы включают заголовок в размер тега, и он идёт перед элементами
+    const BYTE* p = Ape_View(&tail, &w, pos, 32);
+    if (p && memcmp(p, "APETAGEX", 8) == 0) pos += 32;
+
+    int n = 0;
+    for (DWORD i = 0; i < loc.items && pos + 9 <= end; ++i) {
+        DWORD cb = (end - pos > 8 + APE_MAX_KEY + 1) ? 8 + APE_MAX_KEY + 1 : (DWORD)(end - pos);
+        p = Ape_View(&tail, &w, pos, cb);
+        if (!p) break;
+
+        DWORD valSize = LE32(p);
+        DWORD k = 8;
+        while (k < cb && p[k] != 0) ++k;
+        if (k >= cb) break;                   // key too long or truncated / ключ слишком длинный или обрезан
+
+        U64 valPos = pos + k + 1;
+        if (valSize > end - valPos) break;
+
+        int rank = Ape_PictureRank((const char*)(p + 8));
+        if (rank >= 0 && valSize > 0 && valSize <= APE_MAX_PICTURE && n < max) {
+            ApeItem* it = &items[n++];
+            it->valPos  = valPos;
+            it->valSize = valSize;
+            it->rank    = rank;
+            it->failed  = FALSE;
+
+            // The name is known for free when the value start is already in memory
+            // Имя известно даром, если начало значения уже в памяти
+            DWORD nb = (valSize < APE_MAX_NAME) ? valSize : APE_MAX_NAME;
+            const BYTE* val = Ape_Held(&tail, &w, valPos, nb);
+            it->skip = val ? Ape_NameSkip(val, nb) : APE_SKIP_UNKNOWN;
         }
-        pos += valSize;
+        pos = valPos + valSize;
     }
+    FileWindow_Free(&w);
+    s_stats.items += n;
+    return n;
+}
 
-    if (bestData) return Img_LoadFromMemoryToBitmap(bestData, bestSize, phbm, psz);
-    return FALSE;
+/**
+ * @brief Best item by key rank (front > generic > back), the larger one on a tie; failed ones skipped
+ * @brief Лучший элемент по рангу ключа (лицевая > общая > задняя), при равенстве больший; неудачные пропускаются
+ *
+ * @return Item number or -1 / Номер элемента или -1
+ */
+static int Ape_BestItem(const ApeItem* items, int n)
+{
+    int best = -1;
+    for (int i = 0; i < n; ++i) {
+        if (items[i].failed) continue;
+        if (best < 0 || items[i].rank < items[best].rank ||
+            (items[i].rank == items[best].rank && items[i].valSize > items[best].valSize)) best = i;
+    }
+    return best;
+}
+
+static BYTE Ape_PictureType(int rank)
+{
+    return (rank == 0) ? PIC_TYPE_FRONT : (rank == 2) ? PIC_TYPE_BACK : PIC_TYPE_OTHER;
 }
 
 // ============================================================================
@@ -146,23 +231,60 @@ static BOOL Ape_ParseItems(const BYTE* data, DWORD size, HBITMAP* phbm, SIZE* ps
 // ============================================================================
 
 extern "C" BOOL __cdecl APE_LoadCoverToBitmapA(const char* path, HBITMAP* phbm, SIZE* psz) {
+    if (phbm) *phbm = NULL;
+    if (psz) { psz->cx = 0; psz->cy = 0; }
+
     FileHandle f(path);
     if (!f.IsValid()) return FALSE;
 
-    ApeLoc loc = {0};
-    if (Ape_ScanFooter(f, &loc)) {
-        DWORD dataSize = loc.totalSize - 32; // Exclude Footer size from data read
-        if (loc.totalSize < 32) return FALSE;
-
-        BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, dataSize);
-        if (buf) {
-            if (f.ReadAt(loc.absStart, buf, dataSize)) {
-                BOOL ok = Ape_ParseItems(buf, dataSize, phbm, psz);
-                GlobalFree(buf);
-                return ok;
+    ApeItem items[APE_MAX_ITEMS];
+    int n = Ape_CollectItems(f, path, items, APE_MAX_ITEMS);
+
+    // Only the value of the chosen item is read; the next one only if it fails to decode
+    // Читается только значение выбранного элемента; следующего - только если оно не декодировалось
+    BOOL ok = FALSE;
+    for (int best = Ape_BestItem(items, n); best >= 0 && !ok; best = Ape_BestItem(items, n)) {
+        ApeItem* it = &items[best];
+        BYTE* val = (BYTE*)GlobalAlloc(GMEM_FIXED, it->valSize);
+        if (val && Ape_ReadAt(f, it->valPos, val, it->valSize)) {
+            DWORD skip = Ape_NameSkip(val, it->valSize);
+            if (skip < it->valSize) {
+                s_stats.decodes++;
+                ok = Img_LoadFromMemoryToBitmap(val + skip, it->valSize - skip, phbm, psz);
             }
-            GlobalFree(buf);
         }
+        if (val) GlobalFree(val);
+        it->failed = !ok;
     }
-    return FALSE;
-}
\ No newline at end of file
+    return ok;
+}
+
+extern "C" int __cdecl APE_IndexPicturesA(const char* path, PictureIndex* idx) {
+    if (!idx) return 0;
+    FileHandle f(path);
+    if (!f.IsValid()) return 0;
+
+    ApeItem items[APE_MAX_ITEMS];
+    int n = Ape_CollectItems(f, path, items, APE_MAX_ITEMS);
+
+    int added = 0;
+    for (int i = 0; i < n; ++i) {
+        ApeItem* it = &items[i];
+        if (it->skip == APE_SKIP_UNKNOWN) {
+            // Value start was not in memory: read just the file name
+            // Начала значения не было в памяти: читаем только имя файла
+            BYTE  name[APE_MAX_NAME];
+            DWORD nb = (it->valSize < APE_MAX_NAME) ? it->valSize : APE_MAX_NAME;
+            if (!Ape_ReadAt(f, it->valPos, name, nb)) continue;
+            it->skip = Ape_NameSkip(name, nb);
+        }
+        if (it->skip >= it->valSize) continue;
+        if (PicIndex_Add(idx, it->valPos + it->skip, it->valSize - it->skip,
+                         Ape_PictureType(it->rank), PIC_SRC_APE)) ++added;
+    }
+    return added;
+}
+
+extern "C" void __cdecl APE_GetStats(APEStats* out) {
+    if (out) *out = s_stats;
+}
@@ -42,8 +42,10 @@
  * 2. Общая обложка/изображение (ранг 1) - предпочтительна
  * 3. Задняя обложка (ранг 2) - запасной вариант
  * 
- * @note Scans last 4KB of file for footer (performance optimization)
- * @note Сканирует последние 4KB файла для поиска footer (оптимизация производительности)
+ * @note The footer is located behind ID3v1/Lyrics3v2 from their size fields;
+ *       the last 4KB are scanned for it only as a fallback
+ * @note Footer находится за ID3v1/Lyrics3v2 по их полям размера; последние 4KB
+ *       сканируются только как запасной вариант
  * 
  * @author [Your Name]
  * @date 2025
@@ -52,11 +54,23 @@
 
 #pragma once
 #include <windows.h>
+#include "picture_index.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Reader statistics / Статистика ридера
+ */
+typedef struct {
+    DWORD tags;        ///< Tags walked / Обойдено тегов
+    DWORD reads;       ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;   ///< Bytes read / Прочитано байт
+    DWORD items;       ///< Picture items described / Описано элементов-изображений
+    DWORD decodes;     ///< Pictures handed to the decoder / Изображений передано декодеру
+} APEStats;
+
 /**
  * @brief Extract cover art from APE/APEv2 tagged file
  * @brief Извлечь обложку из файла с APE/APEv2 тегами
@@ -70,21 +84,21 @@ extern "C" {
  * ключей изображений и приоритизирует изображения передней обложки.
  * 
  * Algorithm / Алгоритм:
- * 1. Scan last 4KB of file for "APETAGEX" signature
- * 2. Read tag size and locate tag start
- * 3. Parse key-value items
+ * 1. Locate the "APETAGEX" footer behind ID3v1/Lyrics3v2 (scan the last 4KB as a fallback)
+ * 2. Read tag size and locate tag start (after a header counted in the size)
+ * 3. Walk the item headers (size, flags, key) in small block reads
  * 4. Identify picture items by key names (cover, picture, front, back)
- * 5. Extract binary image data (skip filename)
- * 6. Select best picture based on priority ranking
- * 7. Load image to bitmap
+ * 5. Select best picture based on priority ranking
+ * 6. Read only that item's value, skip the file name and load the image
+ *    (the next best item only if decoding fails)
  * 
- * 1. Сканировать последние 4KB файла для поиска сигнатуры "APETAGEX"
- * 2. Прочитать размер тега и найти начало тега
- * 3. Парсить элементы ключ-значение
+ * 1. Найти footer "APETAGEX" за ID3v1/Lyrics3v2 (запасной вариант - сканировать последние 4KB)
+ * 2. Прочитать размер тега и найти начало тега (после заголовка, учтённого в размере)
+ * 3. Обойти заголовки элементов (размер, флаги, ключ) короткими блочными чтениями
  * 4. Идентифицировать элементы изображений по именам ключей (cover, picture, front, back)
- * 5. Извлечь бинарные данные изображения (пропустить имя файла)
- * 6. Выбрать лучшее изображение на основе ранжирования приоритета
- * 7. Загрузить изображение в bitmap
+ * 5. Выбрать лучшее изображение на основе ранжирования приоритета
+ * 6. Прочитать только значение этого элемента, пропустить имя файла и загрузить
+ *    изображение (следующий элемент - только при ошибке декодирования)
  * 
  * @param audioPath Path to audio file with APEv2 tags / Путь к аудиофайлу с APEv2 тегами
  * @param phbm [out] Receives handle to loaded bitmap / Получает дескриптор загруженного bitmap'а
@@ -108,6 +122,24 @@ extern "C" {
  */
 BOOL __cdecl APE_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz);
 
+/**
+ * @brief Index every picture item without reading the image bytes
+ * @brief Проиндексировать все элементы-изображения, не читая байты изображений
+ *
+ * Item headers are read one by one, so the tag is never loaded as a whole.
+ * Заголовки элементов читаются по одному, тег целиком не загружается.
+ *
+ * @param audioPath Path to audio file with APEv2 tags / Путь к аудиофайлу с APEv2 тегами
+ * @param idx [in,out] Index to append to / Индекс для дополнения
+ * @return Number of pictures added / Количество добавленных изображений
+ */
+int __cdecl APE_IndexPicturesA(const char* audioPath, PictureIndex* idx);
+
+/**
+ * @brief Copy reader statistics / Скопировать статистику ридера
+ */
+void __cdecl APE_GetStats(APEStats* out);
+
 #ifdef __cplusplus
 }
 #endif
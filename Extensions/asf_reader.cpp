@@ -0,0 +1,284 @@
+/**
+ * @file asf_reader.cpp
+ * @brief ASF cover art extractor implementation
+ * @brief Реализация экстрактора обложек ASF
+ *
+ * Object layout / Структура объекта:
+ * GUID(16) size(8, LE, header included) body. The Header Object body starts
+ * with an object count(4) and two reserved bytes; the Header Extension
+ * Object body with a reserved GUID(16), reserved(2) and a data size(4).
+ * Тело Header Object начинается с числа объектов(4) и двух зарезервированных
+ * байт; тело Header Extension Object - с зарезервированного GUID(16),
+ * зарезервированных(2) и размера данных(4).
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <string.h>
+#include "asf_reader.h"
+#include "..\image_loader.h"
+#include "..\utils_common.h"
+
+typedef unsigned __int64 U64;
+
+#define ASF_LEAD         30                     ///< Header Object GUID, size, count and reserved bytes / GUID, размер, число объектов и резерв Header Object
+#define ASF_MAX_HEADER   (32 * 1024 * 1024)     ///< Largest Header Object read / Наибольший читаемый Header Object
+#define ASF_MAX_PICTURES 32
+#define ASF_MAX_PICTURE  (16 * 1024 * 1024)     ///< Same limit as FLAC / Тот же предел, что у FLAC
+#define ASF_OBJECT_HDR   24                     ///< GUID + size / GUID + размер
+#define ASF_TYPE_BYTES   1                      ///< Attribute data type: byte array / Тип данных атрибута: массив байт
+
+// GUIDs as stored in the file (first three fields little-endian)
+// GUID в том виде, как хранятся в файле (первые три поля little-endian)
+static const BYTE kGuidHeader[16] = {
+    0x30, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11, 0xA6, 0xD9, 0x00, 0xAA, 0x00, 0x62, 0xCE, 0x6C };
+static const BYTE kGuidExtContent[16] = {
+    0x40, 0xA4, 0xD0, 0xD2, 0x07, 0xE3, 0xD2, 0x11, 0x97, 0xF0, 0x00, 0xA0, 0xC9, 0x5E, 0xA8, 0x50 };
+static const BYTE kGuidHeaderExt[16] = {
+    0xB5, 0x03, 0xBF, 0x5F, 0x2E, 0xA9, 0xCF, 0x11, 0x8E, 0xE3, 0x00, 0xC0, 0x0C, 0x20, 0x53, 0x65 };
+static const BYTE kGuidMetadata[16] = {
+    0xEA, 0xCB, 0xF8, 0xC5, 0xAF, 0x5B, 0x77, 0x48, 0x84, 0x67, 0xAA, 0x8C, 0x44, 0xFA, 0x4C, 0xCA };
+static const BYTE kGuidMetadataLib[16] = {
+    0x94, 0x1C, 0x23, 0x44, 0x98, 0x94, 0xD1, 0x49, 0xA1, 0x41, 0x1D, 0x13, 0x4E, 0x45, 0x70, 0x54 };
+
+static ASFStats s_stats = {0};
+
+/**
+ * @brief One WM/Picture, described without decoding it
+ * @brief Одно изображение WM/Picture, описанное без декодирования
+ */
+typedef struct {
+    PictureCandidate cand;   ///< ID3 picture type, size from the image header / Тип изображения ID3, размер по заголовку изображения
+    DWORD pos, len;   ///< Image bytes (file offset = header offset) / Байты изображения (смещение в файле = в заголовке)
+} AsfPicture;
+
+/**
+ * @brief Header Object in memory and the pictures found in it
+ * @brief Header Object в памяти и найденные в нём изображения
+ */
+typedef struct {
+    BYTE*      data;    ///< Header Object from file offset 0 / Header Object от смещения 0 в файле
+    DWORD      size;
+    AsfPicture pics[ASF_MAX_PICTURES];
+    int        count;
+} AsfHeader;
+
+static BOOL Asf_ReadAt(FileHandle& f, DWORD pos, void* buf, DWORD size)
+{
+    s_stats.reads++;
+    s_stats.bytesRead += size;
+    return f.ReadAt(pos, buf, size);
+}
+
+/**
+ * @brief Read the Header Object: its first ASF_LEAD bytes, then exactly the rest
+ * @brief Прочитать Header Object: первые ASF_LEAD байт, затем ровно остаток
+ *
+ * The first read gives the GUID and the object size, so any other format
+ * passing through PicIndex_BuildA() costs one short read, and no Data Object
+ * packet is ever read.
+ * Первое чтение даёт GUID и размер объекта, поэтому любой другой формат,
+ * проходящий через PicIndex_BuildA(), стоит одно короткое чтение, и ни один
+ * пакет Data Object не читается.
+ */
+static BOOL Asf_ReadHeader(FileHandle& f, AsfHeader* h)
+{
+    ZeroMemory(h, sizeof(*h));
+    U64 fileSize = f.GetSize64();
+    if (fileSize < ASF_LEAD) return FALSE;
+
+    BYTE lead[ASF_LEAD];
+    if (!Asf_ReadAt(f, 0, lead, ASF_LEAD) || memcmp(lead, kGuidHeader, 16) != 0) return FALSE;
+
+    U64 size = LE64(lead + 16);
+    if (size < ASF_LEAD || size > fileSize) return FALSE;
+    if (size > ASF_MAX_HEADER) size = ASF_MAX_HEADER;   // objects past the bound are ignored / объекты за пределом игнорируются
+    s_stats.files++;
+
+    h->data = (BYTE*)GlobalAlloc(GMEM_FIXED, (DWORD)size);
+    if (!h->data) return FALSE;
+    CopyMemory(h->data, lead, ASF_LEAD);
+    if (size > ASF_LEAD && !Asf_ReadAt(f, ASF_LEAD, h->data + ASF_LEAD, (DWORD)size - ASF_LEAD)) return FALSE;
+    h->size = (DWORD)size;
+    return TRUE;
+}
+
+static void Asf_FreeHeader(AsfHeader* h)
+{
+    if (h->data) GlobalFree(h->data);
+    h->data = NULL;
+}
+
+// Whether a UTF-16LE name (terminator optional) equals an ASCII string
+// Равно ли имя UTF-16LE (терминатор необязателен) строке ASCII
+static BOOL Asf_NameIs(const BYTE* p, DWORD cb, const char* ascii)
+{
+    DWORD n = (DWORD)strlen(ascii);
+    if (cb == 2 * (n + 1) && (p[2 * n] || p[2 * n + 1])) return FALSE;
+    if (cb != 2 * n && cb != 2 * (n + 1)) return FALSE;
+    for (DWORD i = 0; i < n; ++i) {
+        if (p[2 * i] != (BYTE)ascii[i] || p[2 * i + 1]) return FALSE;
+    }
+    return TRUE;
+}
+
+// Bytes of a 0-terminated UTF-16 string, terminator included; 0 if unterminated
+// Байты UTF-16 строки с нулём в конце, включая терминатор; 0 если нет терминатора
+static DWORD Asf_SkipWide(const BYTE* p, DWORD cb)
+{
+    for (DWORD i = 0; i + 1 < cb; i += 2) {
+        if (!p[i] && !p[i + 1]) return i + 2;
+    }
+    return 0;
+}
+
+/**
+ * @brief Describe a WM/Picture value at @p pos
+ * @brief Описать значение WM/Picture по смещению @p pos
+ */
+static void Asf_AddPicture(AsfHeader* h, DWORD pos, DWORD len)
+{
+    if (h->count >= ASF_MAX_PICTURES || len < 5) return;
+    const BYTE* v = h->data + pos;
+
+    // [type 1][data length 4][MIME z][description z][data]
+    DWORD dataLen = LE32(v + 1);
+    DWORD off = 5, n;
+    if (!(n = Asf_SkipWide(v + off, len - off))) return;
+    off += n;
+    if (!(n = Asf_SkipWide(v + off, len - off))) return;
+    off += n;
+    if (!dataLen || dataLen > len - off || dataLen > ASF_MAX_PICTURE) return;
+
+    AsfPicture* pic = &h->pics[h->count++];
+    ZeroMemory(pic, sizeof(*pic));
+    pic->pos  = pos + off;
+    pic->len  = dataLen;
+    pic->cand.type = (BYTE)(v[0] <= 20 ? v[0] : PIC_TYPE_OTHER);
+    if (!Img_ProbeSize(h->data + pic->pos, dataLen, &pic->cand.dim)) pic->cand.dim.cx = pic->cand.dim.cy = 0;
+    s_stats.pictures++;
+}
+
+/**
+ * @brief Extended Content Description: [count 2] {[name len 2][name][type 2][value len 2][value]}
+ * @brief Extended Content Description: [число 2] {[длина имени 2][имя][тип 2][длина значения 2][значение]}
+ */
+static void Asf_ScanExtContent(AsfHeader* h, DWORD pos, DWORD end)
+{
+    if (end - pos < 2) return;
+    DWORD count = LE16(h->data + pos);
+    pos += 2;
+    for (DWORD i = 0; i < count && end - pos >= 2; ++i) {
+        DWORD nameLen = LE16(h->data + pos);
+        if (end - pos < 2 + nameLen + 4) return;
+        const BYTE* name = h->data + pos + 2;
+        pos += 2 + nameLen;
+        DWORD type = LE16(h->data + pos), len = LE16(h->data + pos + 2);
+        pos += 4;
+        if (len > end - pos) return;
+        if (type == ASF_TYPE_BYTES && Asf_NameIs(name, nameLen, "WM/Picture")) Asf_AddPicture(h, pos, len);
+        pos += len;
+    }
+}
+
+/**
+ * @brief Metadata / Metadata Library: [count 2] {[lang 2][stream 2][name len 2][type 2][data len 4][name][data]}
+ * @brief Metadata / Metadata Library: [число 2] {[язык 2][поток 2][длина имени 2][тип 2][длина данных 4][имя][данные]}
+ */
+static void Asf_ScanMetadata(AsfHeader* h, DWORD pos, DWORD end)
+{
+    if (end - pos < 2) return;
+    DWORD count = LE16(h->data + pos);
+    pos += 2;
+    for (DWORD i = 0; i < count && end - pos >= 12; ++i) {
+        const BYTE* r = h->data + pos;
+        DWORD nameLen = LE16(r + 4), type = LE16(r + 6), len = LE32(r + 8);
+        pos += 12;
+        if (nameLen > end - pos || len > end - pos - nameLen) return;
+        if (type == ASF_TYPE_BYTES && Asf_NameIs(h->data + pos, nameLen, "WM/Picture")) {
+            Asf_AddPicture(h, pos + nameLen, len);
+        }
+        pos += nameLen + len;
+    }
+}
+
+/**
+ * @brief Walk the objects in [pos, end) in memory
+ * @brief Обойти объекты в [pos, end) в памяти
+ *
+ * @param nested TRUE inside the Header Extension Object / TRUE внутри Header Extension Object
+ */
+static void Asf_ScanObjects(AsfHeader* h, DWORD pos, DWORD end, BOOL nested)
+{
+    while (pos < end && end - pos >= ASF_OBJECT_HDR) {
+        const BYTE* o = h->data + pos;
+        U64 size = LE64(o + 16);
+        if (size < ASF_OBJECT_HDR || size > end - pos) return;
+        DWORD body = pos + ASF_OBJECT_HDR, next = pos + (DWORD)size;
+        s_stats.objects++;
+
+        if (memcmp(o, kGuidExtContent, 16) == 0) {
+            Asf_ScanExtContent(h, body, next);
+        } else if (memcmp(o, kGuidMetadataLib, 16) == 0 || memcmp(o, kGuidMetadata, 16) == 0) {
+            Asf_ScanMetadata(h, body, next);
+        } else if (!nested && memcmp(o, kGuidHeaderExt, 16) == 0 && next - body >= 22) {
+            Asf_ScanObjects(h, body + 22, next, TRUE);
+        }
+        pos = next;
+    }
+}
+
+// Read the Header Object and describe every picture in it
+// Прочитать Header Object и описать каждое изображение в нём
+static int Asf_Collect(FileHandle& f, AsfHeader* h)
+{
+    if (!Asf_ReadHeader(f, h)) return 0;
+    Asf_ScanObjects(h, ASF_LEAD, h->size, FALSE);
+    return h->count;
+}
+
+// ============================================================================
+// Main Function / Главная функция
+// ============================================================================
+
+BOOL ASF_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz)
+{
+    if (!audioPath || !*audioPath) return FALSE;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return FALSE;
+
+    // No I/O after the header read: only the chosen picture is decoded, the next best only on failure
+    // Без ввода-вывода после чтения заголовка: декодируется только выбранное изображение, следующее - при ошибке
+    AsfHeader h;
+    int n = Asf_Collect(f, &h);
+    BOOL ok = FALSE;
+    for (int best = PicIndex_Best(h.pics, n, sizeof(h.pics[0])); best >= 0 && !ok;
+         best = PicIndex_Best(h.pics, n, sizeof(h.pics[0]))) {
+        s_stats.decodes++;
+        ok = Img_LoadFromMemoryToBitmap(h.data + h.pics[best].pos, h.pics[best].len, phbm, psz);
+        h.pics[best].cand.failed = !ok;
+    }
+    Asf_FreeHeader(&h);
+    return ok;
+}
+
+int ASF_IndexPicturesA(const char* audioPath, PictureIndex* idx)
+{
+    if (!idx || !audioPath || !*audioPath) return 0;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return 0;
+
+    AsfHeader h;
+    int n = Asf_Collect(f, &h);
+    int added = 0;
+    for (int i = 0; i < n; ++i) {
+        if (PicIndex_Add(idx, h.pics[i].pos, h.pics[i].len, h.pics[i].cand.type, PIC_SRC_ASF)) ++added;
+    }
+    Asf_FreeHeader(&h);
+    return added;
+}
+
+void ASF_GetStats(ASFStats* out)
+{
+    if (out) *out = s_stats;
+}
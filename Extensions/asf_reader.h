@@ -0,0 +1,84 @@
+/**
+ * @file asf_reader.h
+ * @brief ASF (WMA/WMV) embedded cover art extractor
+ * @brief Экстрактор встроенных обложек ASF (WMA/WMV)
+ *
+ * Cover art is a "WM/Picture" attribute in the Header Object: in the
+ * Extended Content Description Object (values up to 64 KB) or in the
+ * Metadata / Metadata Library Objects of the Header Extension Object
+ * (larger values). The attribute value is:
+ * [picture type 1][data length 4][MIME UTF-16 z][description UTF-16 z][data]
+ *
+ * Обложка - атрибут "WM/Picture" в Header Object: в Extended Content
+ * Description Object (значения до 64 КБ) или в Metadata / Metadata Library
+ * Objects внутри Header Extension Object (значения больше). Значение атрибута:
+ * [тип изображения 1][длина данных 4][MIME UTF-16 z][описание UTF-16 z][данные]
+ *
+ * Reading / Чтение:
+ * The first 30 bytes of the file give the Header Object size; one more read
+ * takes exactly the rest of it (bounded by ASF_MAX_HEADER). The object list is
+ * walked in memory; Data Object packets are never read. Every picture is
+ * described from its value header, and only the one PicIndex_Prefer() ranks
+ * best is decoded.
+ * Первые 30 байт файла дают размер Header Object; ещё одно чтение берёт ровно
+ * его остаток (ограничено ASF_MAX_HEADER). Список объектов обходится в
+ * памяти; пакеты Data Object никогда не читаются. Каждое изображение
+ * описывается по заголовку значения, декодируется только лучшее по PicIndex_Prefer().
+ *
+ * Supported Containers / Поддерживаемые контейнеры:
+ * - .wma, .wmv, .asf
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+#include "picture_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reader statistics / Статистика ридера
+ */
+typedef struct {
+    DWORD files;       ///< Header Objects read / Прочитано Header Object
+    DWORD reads;       ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;   ///< Bytes read / Прочитано байт
+    DWORD objects;     ///< Header objects walked / Пройдено объектов заголовка
+    DWORD pictures;    ///< WM/Picture values described / Описано значений WM/Picture
+    DWORD decodes;     ///< Pictures handed to the decoder / Изображений передано декодеру
+} ASFStats;
+
+/**
+ * @brief Load the best WM/Picture of an ASF file
+ * @brief Загрузить лучшее изображение WM/Picture файла ASF
+ *
+ * @param audioPath Path to WMA/WMV/ASF file / Путь к файлу WMA/WMV/ASF
+ * @param phbm [out] Result bitmap, owned by the caller / Результирующий bitmap, принадлежит вызывающему
+ * @param psz  [out] Result dimensions / Результирующие размеры
+ * @return TRUE on success / TRUE при успехе
+ */
+BOOL ASF_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz);
+
+/**
+ * @brief Index every WM/Picture without decoding them
+ * @brief Проиндексировать все WM/Picture, не декодируя их
+ *
+ * @param audioPath Path to WMA/WMV/ASF file / Путь к файлу WMA/WMV/ASF
+ * @param idx [in,out] Index to append to / Индекс для дополнения
+ * @return Number of pictures added / Количество добавленных изображений
+ */
+int ASF_IndexPicturesA(const char* audioPath, PictureIndex* idx);
+
+/**
+ * @brief Copy reader statistics / Скопировать статистику ридера
+ */
+void ASF_GetStats(ASFStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file chunk_tags.cpp
+ * @brief Chunked container walker implementation
+ * @brief Реализация обхода контейнеров из чанков
+ */
+
+#include "chunk_tags.h"
+#include "..\utils_common.h"
+
+typedef unsigned __int64 U64;
+
+#define CHUNK_HEAD       64    ///< First read: form header and first chunks / Первое чтение: заголовок формы и первые чанки
+#define CHUNK_MAX        256   ///< Top-level chunks walked / Обходимых чанков верхнего уровня
+#define CHUNK_SIZE_64    0xFFFFFFFF   ///< RF64: the real size is in "ds64" / RF64: настоящий размер в "ds64"
+
+static ChunkTagStats s_stats = {0};
+
+/**
+ * @brief Layout of one container family / Раскладка одного семейства контейнеров
+ */
+typedef struct {
+    BOOL  bigEndian;   ///< Sizes are big-endian (AIFF, DSDIFF) / Размеры big-endian (AIFF, DSDIFF)
+    DWORD sizeBytes;   ///< 4, or 8 for DSDIFF / 4, или 8 для DSDIFF
+    BOOL  rf64;        ///< 32-bit sizes may defer to "ds64" / 32-битные размеры могут ссылаться на "ds64"
+} ChunkLayout;
+
+static BOOL Chunk_ReadAt(HANDLE file, U64 pos, BYTE* buf, DWORD size)
+{
+    s_stats.reads++;
+    s_stats.bytesRead += size;
+    return ReadFileAt(file, pos, buf, size);
+}
+
+// Bytes [pos, pos + n) from the first read, or one small read past it
+// Байты [pos, pos + n) из первого чтения, или одно короткое чтение за ним
+static BOOL Chunk_Bytes(HANDLE file, const BYTE* head, DWORD headLen, U64 pos, DWORD n, BYTE* out)
+{
+    if (pos + n <= headLen) {
+        CopyMemory(out, head + (DWORD)pos, n);
+        return TRUE;
+    }
+    return Chunk_ReadAt(file, pos, out, n);
+}
+
+static BOOL Chunk_IsId3(DWORD id)
+{
+    return id == FCC('I', 'D', '3', ' ') || id == FCC('i', 'd', '3', ' ') || id == FCC('I', 'D', '3', '2');
+}
+
+/**
+ * @brief Walk the top-level chunks in [pos, end) and stop at the ID3v2 chunk
+ * @brief Обойти чанки верхнего уровня в [pos, end) и остановиться на чанке ID3v2
+ *
+ * Chunks are padded to an even size in all three families. A chunk running
+ * past @p end ends the walk: no size can move it backwards or wrap it.
+ * Во всех трёх семействах чанки выравниваются до чётного размера. Чанк,
+ * выходящий за @p end, завершает обход: никакой размер не сдвинет его назад
+ * и не переполнит.
+ */
+static BOOL Chunk_Walk(HANDLE file, const BYTE* head, DWORD headLen, const ChunkLayout* l,
+                       U64 pos, U64 end, U64* at)
+{
+    const DWORD hdr = 4 + l->sizeBytes;
+    U64  data64 = 0;   // RF64 "data" size / Размер "data" в RF64
+    BYTE h[16];
+
+    for (int i = 0; i < CHUNK_MAX && pos + hdr <= end; ++i) {
+        if (!Chunk_Bytes(file, head, headLen, pos, hdr, h)) return FALSE;
+        s_stats.chunks++;
+
+        DWORD id = BE32(h);
+        U64 size;
+        if (l->sizeBytes == 8)   size = BE64(h + 4);
+        else if (l->bigEndian)   size = BE32(h + 4);
+        else                     size = LE32(h + 4);
+
+        if (Chunk_IsId3(id)) {
+            if (size < 10 || size > end - pos - hdr) return FALSE;
+            *at = pos + hdr;
+            return TRUE;
+        }
+
+        // ds64: [riff size 8][data size 8][sample count 8]...
+        if (l->rf64 && i == 0 && id == FCC('d', 's', '6', '4') && size >= 16) {
+            BYTE v[8];
+            if (Chunk_Bytes(file, head, headLen, pos + hdr + 8, 8, v)) data64 = LE64(v);
+        }
+        if (l->rf64 && size == CHUNK_SIZE_64 && id == FCC('d', 'a', 't', 'a')) {
+            if (!data64) return FALSE;   // unknown size: nothing after it can be found / размер неизвестен
+            size = data64;
+        }
+        if (size > end - pos - hdr) return FALSE;
+        pos += hdr + size + (size & 1);
+    }
+    return FALSE;
+}
+
+BOOL ChunkTag_IsContainer(const BYTE* lead)
+{
+    if (!lead) return FALSE;
+    DWORD form = BE32(lead);
+    return form == FCC('R', 'I', 'F', 'F') || form == FCC('R', 'F', '6', '4') || form == FCC('B', 'W', '6', '4') ||
+           form == FCC('F', 'O', 'R', 'M') || form == FCC('F', 'R', 'M', '8') || form == FCC('D', 'S', 'D', ' ');
+}
+
+BOOL ChunkTag_FindId3v2(HANDLE file, unsigned __int64* at)
+{
+    if (file == INVALID_HANDLE_VALUE || !at) return FALSE;
+
+    U64 fileSize = FileSize64(file);
+    if (fileSize < 12) return FALSE;
+
+    BYTE  head[CHUNK_HEAD];
+    DWORD headLen = (fileSize < CHUNK_HEAD) ? (DWORD)fileSize : CHUNK_HEAD;
+    if (!Chunk_ReadAt(file, 0, head, headLen)) return FALSE;
+
+    ChunkLayout l = { FALSE, 4, FALSE };
+    U64 pos = 12;
+    DWORD form = BE32(head), type = BE32(head + 8);
+    if (form == FCC('D', 'S', 'D', ' ')) {
+        // DSF: ["DSD "][chunk size 8][file size 8][metadata offset 8], little-endian
+        // DSF: ["DSD "][размер чанка 8][размер файла 8][смещение метаданных 8], little-endian
+        if (headLen < 28) return FALSE;
+        U64 meta = LE64(head + 20);
+        s_stats.files++;
+        if (meta < 28 || meta > fileSize - 10) return FALSE;
+        *at = meta;
+        s_stats.found++;
+        return TRUE;
+    }
+    if (form == FCC('R', 'I', 'F', 'F') || form == FCC('R', 'F', '6', '4') || form == FCC('B', 'W', '6', '4')) {
+        if (type != FCC('W', 'A', 'V', 'E')) return FALSE;
+        l.rf64 = (form != FCC('R', 'I', 'F', 'F'));
+    } else if (form == FCC('F', 'O', 'R', 'M')) {
+        if (type != FCC('A', 'I', 'F', 'F') && type != FCC('A', 'I', 'F', 'C')) return FALSE;
+        l.bigEndian = TRUE;
+    } else if (form == FCC('F', 'R', 'M', '8')) {
+        // DSDIFF: ["FRM8"][size 8]["DSD "]
+        if (headLen < 16 || BE32(head + 12) != FCC('D', 'S', 'D', ' ')) return FALSE;
+        l.bigEndian = TRUE;
+        l.sizeBytes = 8;
+        pos = 16;
+    } else {
+        return FALSE;
+    }
+    s_stats.files++;
+
+    // The form size is often wrong in files written while recording; the file size bounds the walk
+    // Размер формы часто неверен в файлах, записанных во время записи; обход ограничен размером файла
+    if (!Chunk_Walk(file, head, headLen, &l, pos, fileSize, at)) return FALSE;
+    s_stats.found++;
+    return TRUE;
+}
+
+void ChunkTag_GetStats(ChunkTagStats* out)
+{
+    if (out) *out = s_stats;
+}
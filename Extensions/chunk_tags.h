@@ -0,0 +1,84 @@
+/**
+ * @file chunk_tags.h
+ * @brief ID3v2 tag location in chunked containers: WAV, RF64, AIFF, DSF, DSDIFF
+ * @brief Поиск тега ID3v2 в контейнерах из чанков: WAV, RF64, AIFF, DSF, DSDIFF
+ *
+ * These formats carry their cover art in an ID3v2 tag that is not at the
+ * start of the file:
+ * - RIFF/WAVE, RF64/BW64: an "id3 " (or "ID3 ") chunk, usually after "data"
+ * - AIFF/AIFC: an "ID3 " chunk
+ * - DSDIFF (.dff): an "ID3 " chunk with a 64-bit size
+ * - DSF: the "DSD " header holds the file offset of the tag
+ *
+ * Эти форматы хранят обложку в теге ID3v2, который находится не в начале файла:
+ * - RIFF/WAVE, RF64/BW64: чанк "id3 " (или "ID3 "), обычно после "data"
+ * - AIFF/AIFC: чанк "ID3 "
+ * - DSDIFF (.dff): чанк "ID3 " с 64-битным размером
+ * - DSF: заголовок "DSD " содержит смещение тега в файле
+ *
+ * Reading / Чтение:
+ * Top-level chunks are walked by their headers only: the first 64 bytes
+ * cover the form header and the first chunks, then each further chunk
+ * header is one 12-byte read. Audio data chunks are jumped over, never read;
+ * RF64 takes the 64-bit "data" size from its "ds64" chunk. DSF jumps
+ * straight to the tag. The tag itself is then read and parsed by the ID3v2
+ * reader.
+ * Обходятся только заголовки чанков верхнего уровня: первые 64 байта
+ * покрывают заголовок формы и первые чанки, затем каждый следующий заголовок
+ * чанка - одно чтение 12 байт. Чанки аудиоданных перепрыгиваются, не читаются;
+ * RF64 берёт 64-битный размер "data" из чанка "ds64". DSF прыгает прямо к
+ * тегу. Сам тег затем читает и разбирает ридер ID3v2.
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Walker statistics / Статистика обхода
+ */
+typedef struct {
+    DWORD files;       ///< Containers recognised / Распознано контейнеров
+    DWORD reads;       ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;   ///< Bytes read / Прочитано байт
+    DWORD chunks;      ///< Chunk headers looked at / Просмотрено заголовков чанков
+    DWORD found;       ///< ID3v2 tags located / Найдено тегов ID3v2
+} ChunkTagStats;
+
+/**
+ * @brief Whether the first 4 bytes of a file start one of these containers
+ * @brief Начинают ли первые 4 байта файла один из этих контейнеров
+ *
+ * Lets a caller that has already read the start of the file skip the walk
+ * for everything else.
+ * Позволяет вызывающему, который уже прочитал начало файла, не запускать
+ * обход для всего остального.
+ */
+BOOL ChunkTag_IsContainer(const BYTE* lead);
+
+/**
+ * @brief Locate the ID3v2 tag of a chunked container
+ * @brief Найти тег ID3v2 контейнера из чанков
+ *
+ * @param file Open file / Открытый файл
+ * @param at   [out] File offset of the "ID3" tag header / Смещение заголовка тега "ID3" в файле
+ * @return FALSE if the file is not such a container or has no tag
+ * @return FALSE если файл не такой контейнер или в нём нет тега
+ */
+BOOL ChunkTag_FindId3v2(HANDLE file, unsigned __int64* at);
+
+/**
+ * @brief Copy walker statistics / Скопировать статистику обхода
+ */
+void ChunkTag_GetStats(ChunkTagStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,19 +11,22 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <string.h>
+#include <shlwapi.h>
 #include "flac_reader.h"
 #include "..\image_loader.h"
 #include "..\utils_common.h"
 
+typedef unsigned __int64 U64;  ///< 64-bit unsigned integer for file offsets
+
 // ============================================================================
 // Helper Class (Replaces Lambdas) / Вспомогательный класс (Вместо лямбд)
 // ============================================================================
 
 class FLAC_BlockReader {
-    BYTE* _p;
-    BYTE* _end;
+    const BYTE* _p;
+    const BYTE* _end;
 public:
-    FLAC_BlockReader(BYTE* ptr, DWORD len) {
+    FLAC_BlockReader(const BYTE* ptr, DWORD len) {
         _p = ptr;
         _end = ptr + len;
     }
@@ -47,7 +50,7 @@ public:
 
     // Get current pointer
     // Получить текущий указатель
-    BYTE* Current() const { return _p; }
+    const BYTE* Current() const { return _p; }
     
     // Check if N bytes are available
     // Проверить наличие N байт
@@ -55,118 +58,214 @@ public:
 };
 
 // ============================================================================
-// Main Function / Главная функция
+// Picture Scan / Поиск изображений
 // ============================================================================
 
-BOOL FLAC_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz)
+/**
+ * @brief One PICTURE block, described from its fixed fields
+ * @brief Один блок PICTURE, описанный по его фиксированным полям
+ */
+typedef struct {
+    PictureCandidate cand;   ///< Type and width/height from the block / Тип и ширина/высота из блока
+    U64   pos;        ///< Image offset in the file / Смещение изображения в файле
+    DWORD len;        ///< Image bytes / Байт изображения
+} FlacPicture;
+
+#define FLAC_MAX_PICTURES 32
+#define FLAC_MAX_PICTURE  (16 * 1024 * 1024)   // 16MB limit per picture / Лимит 16МБ на изображение
+
+static FLACStats s_stats = {0};
+
+#define FLAC_META_BYTES (64 * 1024)    ///< Metadata window / Окно метаданных
+#define FLAC_SNIFF      10             ///< ID3v2 header or "fLaC" of a file not named as FLAC / Заголовок ID3v2 или "fLaC" файла, не названного как FLAC
+
+static BOOL HasFlacExt(const char* path) {
+    const char* ext = PathFindExtensionA(path);
+    return ext && lstrcmpiA(ext, ".flac") == 0;
+}
+
+/**
+ * @brief Offset of the first metadata block, after an optional ID3v2 tag and "fLaC"
+ * @brief Смещение первого блока метаданных, после необязательного ID3v2 и "fLaC"
+ *
+ * A file not named as FLAC is sniffed with FLAC_SNIFF-byte reads; the
+ * metadata window is read only once "fLaC" is found.
+ * Файл, не названный как FLAC, проверяется чтениями по FLAC_SNIFF байт;
+ * окно метаданных читается, только когда найден "fLaC".
+ *
+ * @return Offset, or 0 if this is not a FLAC file / Смещение, или 0 если это не FLAC
+ */
+static U64 Flac_Start(FileWindow* w, const char* path)
 {
-    if (phbm) *phbm = NULL;
-    if (psz) { psz->cx = 0; psz->cy = 0; }
+    w->block = HasFlacExt(path) ? FLAC_META_BYTES : FLAC_SNIFF;
+    U64 pos = 0;
+    const BYTE* p = FileWindow_View(w, 0, 10);
+    if (!p) return 0;
+    if (p[0] == 'I' && p[1] == 'D' && p[2] == '3') {
+        pos = 10 + SyncSafeToInt(&p[6]);   // Jump over tag / Прыгаем через тег
+    }
+    p = FileWindow_View(w, pos, 4);
+    if (!p || memcmp(p, "fLaC", 4) != 0) return 0;
+    w->block = FLAC_META_BYTES;
+    return pos + 4;
+}
 
-    FileHandle f(audioPath);
-    if (!f.IsValid()) return FALSE;
+BOOL FLAC_DescribePicture(const BYTE* pre, DWORD cb, DWORD bodyLen, BYTE* type, SIZE* dim,
+                          DWORD* dataOff, DWORD* dataLen)
+{
+    if (!pre || !type || !dim || !dataOff || !dataLen) return FALSE;
 
-    // 1. Skip ID3v2 if present at start
-    // 1. Пропуск ID3v2, если есть в начале
-    BYTE probe[10];
-    if (f.Read(probe, 10)) {
-        if (probe[0] == 'I' && probe[1] == 'D' && probe[2] == '3') {
-            DWORD id3size = SyncSafeToInt(&probe[6]);
-            f.Seek(id3size, FILE_CURRENT); // Jump over tag / Прыгаем через тег
-        } else {
-            f.Seek(0, FILE_BEGIN); // Rewind / Возвращаемся в начало
-        }
+    // [type(4)] [mimeLen(4)] [mime] [descLen(4)] [desc] [w(4)] [h(4)] [depth(4)] [colors(4)] [dataLen(4)] [data]
+    FLAC_BlockReader reader(pre, cb);
+    DWORD picType = reader.ReadU32();
+    DWORD mimeLen = reader.ReadU32();
+    const BYTE* mime = reader.Current();
+    if (!reader.SafeSkip(mimeLen)) return FALSE;
+
+    // "-->" means the block holds a URL, not an image
+    // "-->" означает, что в блоке URL, а не изображение
+    if (mimeLen == 3 && memcmp(mime, "-->", 3) == 0) return FALSE;
+
+    DWORD descLen = reader.ReadU32();
+    if (!reader.SafeSkip(descLen) || !reader.HasBytes(20)) return FALSE;
+    DWORD w = reader.ReadU32();
+    DWORD h = reader.ReadU32();
+    reader.SafeSkip(8);                       // Depth + Colors
+    DWORD len = reader.ReadU32();
+    DWORD off = (DWORD)(reader.Current() - pre);
+    if (len == 0 || off > bodyLen || len > bodyLen - off || len > FLAC_MAX_PICTURE) return FALSE;
+
+    *type    = (BYTE)(picType <= 20 ? picType : PIC_TYPE_OTHER);
+    dim->cx  = (LONG)w;
+    dim->cy  = (LONG)h;
+    *dataOff = off;
+    *dataLen = len;
+
+    // Some taggers leave the size at 0: the image header may already be in the buffer
+    // Некоторые программы оставляют размер 0: заголовок изображения может уже быть в буфере
+    if ((!w || !h) && off < cb) {
+        if (!Img_ProbeSize(pre + off, cb - off, dim)) dim->cx = dim->cy = 0;
     }
+    return TRUE;
+}
 
-    // 2. Check FLAC signature
-    // 2. Проверка сигнатуры FLAC
-    BYTE sig[4];
-    if (!f.Read(sig, 4) || memcmp(sig, "fLaC", 4) != 0) return FALSE;
+/**
+ * @brief Describe a PICTURE block from its first bytes
+ * @brief Описать блок PICTURE по его первым байтам
+ *
+ * @param pre, cb   First bytes of the block body / Первые байты тела блока
+ * @param blockPos  File offset of the body / Смещение тела в файле
+ * @param blockLen  Body size / Размер тела
+ */
+static BOOL Flac_ParsePicture(const BYTE* pre, DWORD cb, U64 blockPos, DWORD blockLen, FlacPicture* pic)
+{
+    ZeroMemory(pic, sizeof(*pic));
+    DWORD off = 0;
+    if (!FLAC_DescribePicture(pre, cb, blockLen, &pic->cand.type, &pic->cand.dim, &off, &pic->len)) return FALSE;
+    pic->pos = blockPos + off;
+    return TRUE;
+}
 
-    HBITMAP hbmFallback = NULL;
-    SIZE szFallback = {0, 0};
-    const DWORD kMaxBlock = 16 * 1024 * 1024; // 16MB limit per block / Лимит 16МБ на блок
+/**
+ * @brief Walk the metadata blocks in memory and describe every picture without reading its bytes
+ * @brief Обойти блоки метаданных в памяти и описать каждое изображение, не читая его байты
+ *
+ * The metadata region usually fits in FLAC_META_BYTES, so one read serves the
+ * whole walk; another is issued only when the walk leaves the window, e.g.
+ * past a large PICTURE block or a long ID3v2 tag in front.
+ * Область метаданных обычно умещается в FLAC_META_BYTES, поэтому весь обход
+ * обслуживает одно чтение; следующее выполняется, только если обход выходит
+ * за окно, например за большим блоком PICTURE или длинным тегом ID3v2 в начале.
+ *
+ * @param w [out] Window, kept for the caller (free with FileWindow_Free) / Окно, остаётся вызывающему (освободить FileWindow_Free)
+ * @return Number of pictures / Количество изображений
+ */
+static int Flac_CollectPictures(FileHandle& f, const char* path, FileWindow* w, FlacPicture* pics, int max)
+{
+    FileWindow_Init(w, f, FLAC_META_BYTES, &s_stats.reads, &s_stats.bytesRead);
 
-    // 3. Iterate Metadata Blocks
-    // 3. Итерация по блокам метаданных
-    for (;;) {
-        // Read block header (4 bytes)
-        // Читаем заголовок блока (4 байта)
-        BYTE hdr[4];
-        if (!f.Read(hdr, 4)) break;
+    U64 pos = Flac_Start(w, path);
+    int n = 0;
+    while (pos) {
+        // Block header (4 bytes) / Заголовок блока (4 байта)
+        const BYTE* hdr = FileWindow_View(w, pos, 4);
+        if (!hdr) break;
 
         BOOL isLast = (hdr[0] & 0x80) != 0;
         BYTE type = (hdr[0] & 0x7F);
         DWORD length = BE24(&hdr[1]);
+        pos += 4;
 
         // We only care about type 6 (PICTURE)
         // Нас интересует только тип 6 (PICTURE)
-        if (type != 6 || length > kMaxBlock) {
-            f.Seek(length, FILE_CURRENT); // Skip block / Пропускаем блок
-            if (isLast) break;
-            continue;
+        if (type == 6 && n < max) {
+            // Fixed fields plus MIME and description fit in the first few hundred bytes
+            // Фиксированные поля, MIME и описание умещаются в первые несколько сотен байт
+            DWORD cb = (length < 1024) ? length : 1024;
+            const BYTE* pre = FileWindow_View(w, pos, cb);
+            if (pre && Flac_ParsePicture(pre, cb, pos, length, &pics[n])) ++n;
         }
+        pos += length;
+        if (isLast) break;
+    }
+    s_stats.files++;
+    s_stats.pictures += n;
+    return n;
+}
+
+// ============================================================================
+// Main Function / Главная функция
+// ============================================================================
+
+BOOL FLAC_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz)
+{
+    if (phbm) *phbm = NULL;
+    if (psz) { psz->cx = 0; psz->cy = 0; }
+
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return FALSE;
 
-        // Read Picture block body
-        // Читаем тело блока Picture
-        BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, length);
-        if (!buf) break;
-
-        if (f.Read(buf, length)) {
-            // Use helper for parsing
-            // Используем помощник для парсинга
-            FLAC_BlockReader reader(buf, length);
-
-            DWORD picType = reader.ReadU32(); // Picture Type (3=Cover)
-            DWORD mimeLen = reader.ReadU32(); // MIME Length
-            
-            if (reader.SafeSkip(mimeLen)) {   // Skip MIME string
-                DWORD descLen = reader.ReadU32(); // Description Length
-                if (reader.SafeSkip(descLen)) {   // Skip Description
-                     // Skip Width(4)+Height(4)+Depth(4)+Colors(4) = 16 bytes
-                    if (reader.SafeSkip(16)) { 
-                        DWORD dataLen = reader.ReadU32(); // Image Data Length
-                        
-                        // Check if data is physically in buffer
-                        // Проверка наличия данных в буфере
-                        if (reader.HasBytes(dataLen)) {
-                            BYTE* pData = reader.Current();
-                            
-                            HBITMAP hb = NULL; SIZE s = {0};
-                            if (Img_LoadFromMemoryToBitmap(pData, dataLen, &hb, &s)) {
-                                // Priority: Front Cover (Type 3)
-                                // Приоритет: Передняя обложка (Тип 3)
-                                if (picType == 3) {
-                                    if (phbm) *phbm = hb;
-                                    if (psz) *psz = s;
-                                    if (hbmFallback) DeleteObject(hbmFallback);
-                                    GlobalFree(buf);
-                                    return TRUE;
-                                }
-                                // Save as fallback
-                                // Сохраняем как запасной вариант
-                                if (!hbmFallback) {
-                                    hbmFallback = hb;
-                                    szFallback = s;
-                                } else {
-                                    DeleteObject(hb);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+    FileWindow w;
+    FlacPicture pics[FLAC_MAX_PICTURES];
+    int n = Flac_CollectPictures(f, audioPath, &w, pics, FLAC_MAX_PICTURES);
+
+    // Only the chosen picture is read and decoded (straight from the window when
+    // the metadata read already covered it); the next best one only if that fails
+    // Читается и декодируется только выбранное изображение (прямо из окна, если
+    // чтение метаданных его уже захватило); следующее - только при ошибке
+    BOOL ok = FALSE;
+    for (int best = PicIndex_Best(pics, n, sizeof(pics[0])); best >= 0 && !ok;
+         best = PicIndex_Best(pics, n, sizeof(pics[0]))) {
+        const BYTE* img = FileWindow_View(&w, pics[best].pos, pics[best].len);
+        if (img) {
+            s_stats.decodes++;
+            ok = Img_LoadFromMemoryToBitmap(img, pics[best].len, phbm, psz);
         }
-        GlobalFree(buf);
-        if (isLast) break;
+        pics[best].cand.failed = !ok;
     }
+    FileWindow_Free(&w);
+    return ok;
+}
 
-    // Return fallback if specific Front Cover not found
-    // Возвращаем запасной вариант, если Front Cover не найден
-    if (hbmFallback) {
-        if (phbm) *phbm = hbmFallback;
-        if (psz) *psz = szFallback;
-        return TRUE;
+int FLAC_IndexPicturesA(const char* audioPath, PictureIndex* idx)
+{
+    if (!idx) return 0;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return 0;
+
+    FileWindow w;
+    FlacPicture pics[FLAC_MAX_PICTURES];
+    int n = Flac_CollectPictures(f, audioPath, &w, pics, FLAC_MAX_PICTURES);
+    FileWindow_Free(&w);
+
+    int added = 0;
+    for (int i = 0; i < n; ++i) {
+        if (PicIndex_Add(idx, pics[i].pos, pics[i].len, pics[i].cand.type, PIC_SRC_FLAC)) ++added;
     }
-    return FALSE;
-}
\ No newline at end of file
+    return added;
+}
+
+void FLAC_GetStats(FLACStats* out)
+{
+    if (out) *out = s_stats;
+}
@@ -18,12 +18,11 @@
  * - Width, Height, Depth, Colors (16 bytes total)
  * - Picture data length + actual image bytes
  * 
- * Selection Priority / Приоритет выбора:
- * 1. Front cover (type 3) - preferred
- * 2. Any other picture type - fallback
- * 
- * 1. Передняя обложка (тип 3) - предпочтительно
- * 2. Любой другой тип изображения - запасной вариант
+ * Selection / Выбор:
+ * Only the fixed fields of each block are read (type, MIME, width, height);
+ * the picture ranked best by PicIndex_Prefer() is the only one read and decoded.
+ * Читаются только фиксированные поля каждого блока (тип, MIME, ширина, высота);
+ * читается и декодируется только изображение, лучшее по PicIndex_Prefer().
  * 
  * Supported Image Formats / Поддерживаемые форматы изображений:
  * - JPEG, PNG, GIF, BMP (via image_loader module)
@@ -41,11 +40,23 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include "picture_index.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Reader statistics / Статистика ридера
+ */
+typedef struct {
+    DWORD files;       ///< Block walks / Обходов блоков
+    DWORD reads;       ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;   ///< Bytes read / Прочитано байт
+    DWORD pictures;    ///< PICTURE blocks described / Описано блоков PICTURE
+    DWORD decodes;     ///< Pictures handed to the decoder / Изображений передано декодеру
+} FLACStats;
+
 /**
  * @brief Extract cover art from FLAC file
  * @brief Извлечь обложку из FLAC файла
@@ -61,10 +72,12 @@ extern "C" {
  * Algorithm / Алгоритм:
  * 1. Skip ID3v2 tag if present / Пропустить ID3v2 тег если есть
  * 2. Verify "fLaC" signature / Проверить сигнатуру "fLaC"
- * 3. Iterate through metadata blocks / Итерироваться по блокам метаданных
- * 4. Find PICTURE blocks (type 6) / Найти PICTURE блоки (тип 6)
- * 5. Extract image data and load to bitmap / Извлечь данные изображения и загрузить в bitmap
- * 6. Prefer front cover, fallback to any picture / Предпочесть переднюю обложку, запасной вариант любое изображение
+ * 3. Iterate through metadata blocks in memory (the region is read in one or two large reads)
+ *    Итерироваться по блокам метаданных в памяти (область читается одним-двумя большими чтениями)
+ * 4. Describe PICTURE blocks (type 6) from their headers / Описать PICTURE блоки (тип 6) по заголовкам
+ * 5. Pick the best one with PicIndex_Prefer() / Выбрать лучший через PicIndex_Prefer()
+ * 6. Read and decode only that one; the next best only on failure
+ *    Прочитать и декодировать только его; следующий - только при ошибке
  * 
  * @param audioPath Path to FLAC file / Путь к FLAC файлу
  * @param phbm [out] Receives handle to loaded bitmap / Получает дескриптор загруженного bitmap'а
@@ -76,14 +89,48 @@ extern "C" {
  * @note Caller must delete bitmap with DeleteObject() when done
  * @note Вызывающая сторона должна удалить bitmap через DeleteObject() после использования
  * 
- * @note Maximum block size is 16 MB for security
- * @note Максимальный размер блока 16 МБ для безопасности
+ * @note Maximum picture size is 16 MB for security
+ * @note Максимальный размер изображения 16 МБ для безопасности
  * 
  * @note Sets phbm to NULL and psz to {0,0} on failure
  * @note Устанавливает phbm в NULL и psz в {0,0} при ошибке
  */
 BOOL FLAC_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz);
 
+/**
+ * @brief Index every PICTURE block without reading the image bytes
+ * @brief Проиндексировать все блоки PICTURE, не читая байты изображений
+ *
+ * @param audioPath Path to FLAC file / Путь к FLAC файлу
+ * @param idx [in,out] Index to append to / Индекс для дополнения
+ * @return Number of pictures added / Количество добавленных изображений
+ */
+int FLAC_IndexPicturesA(const char* audioPath, PictureIndex* idx);
+
+/**
+ * @brief Describe a PICTURE block body from its first bytes
+ * @brief Описать тело блока PICTURE по его первым байтам
+ *
+ * The same structure is stored base64-encoded in METADATA_BLOCK_PICTURE
+ * Vorbis comments, so the Ogg reader describes its pictures with it too.
+ * Та же структура хранится в base64 в комментариях Vorbis METADATA_BLOCK_PICTURE,
+ * поэтому ридер Ogg описывает свои изображения тоже ею.
+ *
+ * @param pre, cb  First bytes of the body / Первые байты тела
+ * @param bodyLen  Whole body size / Полный размер тела
+ * @param type     [out] Picture type / Тип изображения
+ * @param dim      [out] Width/height, probed from the image if the block says 0 / Ширина/высота, из изображения если в блоке 0
+ * @param dataOff, dataLen [out] Image bytes inside the body / Байты изображения внутри тела
+ * @return FALSE for URLs and malformed blocks / FALSE для URL и некорректных блоков
+ */
+BOOL FLAC_DescribePicture(const BYTE* pre, DWORD cb, DWORD bodyLen, BYTE* type, SIZE* dim,
+                          DWORD* dataOff, DWORD* dataLen);
+
+/**
+ * @brief Copy reader statistics / Скопировать статистику ридера
+ */
+void FLAC_GetStats(FLACStats* out);
+
 #ifdef __cplusplus
 }
 #endif
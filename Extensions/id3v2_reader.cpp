@@ -7,6 +7,11 @@
 #include "..\Extensions\id3v2_reader.h"
 #include "..\image_loader.h"
 #include "..\utils_common.h"
+#include "tag_tail.h"
+#include "chunk_tags.h"
+#include "zlib_inflate.h"
+#include "..\pixel_ops.h"
+#include <emmintrin.h>
 
 // ============================================================================
 // Helper Functions / Вспомогательные функции
@@ -43,118 +48,597 @@ static DWORD SkipEncodedString(const BYTE* p, DWORD cb, BYTE enc) {
 }
 
 // ============================================================================
-// Main Logic / Основная логика
+// Tag Buffer and Frame Index / Буфер тега и индекс фреймов
 // ============================================================================
 
-BOOL __cdecl ID3v2_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz) {
-    FileHandle f(audioPath);
-    if (!f.IsValid()) return FALSE;
+/**
+ * @brief One frame of a tag held in memory
+ * @brief Один фрейм тега, находящегося в памяти
+ */
+typedef struct {
+    char  id[5];   ///< Frame ID, NUL-terminated / ID фрейма с завершающим нулём
+    BYTE  fmt;     ///< Format flags (second flags byte, 0 for v2.2) / Флаги формата (второй байт флагов, 0 для v2.2)
+    DWORD pos;     ///< Content offset in Id3Tag::data / Смещение содержимого в Id3Tag::data
+    DWORD size;    ///< Content size (decoded once prepared) / Размер содержимого (декодированного после подготовки)
+    DWORD stored;  ///< Content size as stored in the tag / Размер содержимого в теге
+    DWORD extra;   ///< Group/encryption/size bytes in front of the data / Байты группы/шифрования/размера перед данными
+    DWORD dlen;    ///< Declared decompressed size, 0 if not compressed / Объявленный распакованный размер, 0 если не сжат
+    BYTE  coding;  ///< PIC_CODING_* of the stored content / PIC_CODING_* хранимого содержимого
+    BOOL  ready;   ///< Id3_PrepareFrame done / Id3_PrepareFrame выполнена
+} Id3Frame;
 
-    // 1. Read and validate ID3v2 Header (10 bytes)
-    // 1. Чтение и валидация заголовка ID3v2 (10 байт)
-    BYTE hdr[10];
-    if (!f.Read(hdr, 10) || memcmp(hdr, "ID3", 3) != 0) return FALSE;
+/**
+ * @brief Whole tag read with one bounded read, plus its frame index
+ * @brief Весь тег, прочитанный одним ограниченным чтением, и его индекс фреймов
+ */
+typedef struct {
+    BYTE      ver;      ///< Major version (2, 3, 4) / Основная версия (2, 3, 4)
+    BYTE      flags;    ///< Tag header flags / Флаги заголовка тега
+    unsigned __int64 base;  ///< File offset of data[0] / Смещение data[0] в файле
+    BYTE*     data;     ///< Tag including its 10-byte header / Тег вместе с 10-байтовым заголовком
+    DWORD     size;     ///< Bytes in data / Байт в data
+    DWORD     stored;   ///< Body bytes as stored in the file / Байт тела тега в файле
+    BOOL      unsync;   ///< Whole body was resynchronised (v2.2/v2.3) / Всё тело тега декодировано (v2.2/v2.3)
+    Id3Frame* frames;   ///< Frame index / Индекс фреймов
+    int       count;    ///< Frames in the index / Фреймов в индексе
+    BYTE      lead[4];  ///< First bytes at base, kept when they are not a tag / Первые байты по base, сохраняются, даже если это не тег
+} Id3Tag;
+
+/**
+ * @brief One APIC/PIC candidate, described without decoding it
+ * @brief Один кандидат APIC/PIC, описанный без декодирования
+ */
+typedef struct {
+    PictureCandidate cand;   ///< ID3 picture type, size from the image header / Тип изображения ID3, размер по заголовку изображения
+    DWORD pos, len;   ///< Image bytes in the frame data (inflated) / Байты изображения в данных фрейма (распакованных)
+    char  mime[32];   ///< MIME type ("PNG"/"JPG" format for v2.2) / MIME-тип (формат для v2.2)
+    DWORD descPos;    ///< Description in the frame data / Описание в данных фрейма
+    DWORD descLen;    ///< Description bytes, terminator excluded / Байт описания без терминатора
+    int   tag;        ///< Tag of the chain holding it / Тег цепочки, в котором оно находится
+    int   frame;      ///< Frame number in that tag / Номер фрейма в этом теге
+} Id3Picture;
+
+#define ID3_MAX_PICTURES 32
+#define ID3_MAX_TAGS     3    ///< Tag at the start, SEEK target, appended tag / Тег в начале, цель SEEK, дописанный тег
+#define ID3_MAX_INFLATE  (32 * 1024 * 1024)   ///< Largest decompressed frame / Наибольший распакованный фрейм
+#define ID3_HEAD_BYTES   (64 * 1024)          ///< Inflated to describe a compressed picture / Распаковывается для описания сжатого изображения
+
+static ID3v2Stats s_stats = {0};
+
+static BOOL Id3_ReadAt(FileHandle& f, unsigned __int64 offset, void* buf, DWORD size)
+{
+    s_stats.reads++;
+    s_stats.bytesRead += size;
+    return f.ReadAt(offset, buf, size);
+}
+
+DWORD __cdecl ID3v2_Resync(BYTE* p, DWORD n)
+{
+    if (!p) return 0;
+    DWORD r = 0, w = 0;
+
+    if (Pix_HasSSE2()) {
+        const __m128i ff = _mm_set1_epi8((char)0xFF);
+        while (r + 16 <= n) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + r));
+            int m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, ff));
+            if (m == 0) {
+                // No 0xFF: move the block down as a whole (w <= r, loaded before stored)
+                // Нет 0xFF: сдвинуть блок целиком (w <= r, загружен до записи)
+                if (w != r) _mm_storeu_si128((__m128i*)(p + w), v);
+                r += 16;
+                w += 16;
+                continue;
+            }
+
+            // Copy up to and including the first 0xFF, then drop the 0x00 after it
+            // Скопировать до первого 0xFF включительно, затем удалить следующий 0x00
+            DWORD k = 1;
+            while (!(m & 1)) { m >>= 1; ++k; }
+            if (w != r) {
+                for (DWORD i = 0; i < k; ++i) p[w + i] = p[r + i];
+            }
+            r += k;
+            w += k;
+            if (r < n && p[r] == 0x00) ++r;
+        }
+    }
+
+    while (r < n) {
+        BYTE c = p[r++];
+        p[w++] = c;
+        if (c == 0xFF && r < n && p[r] == 0x00) ++r;
+    }
+    s_stats.resyncs++;
+    s_stats.resyncBytes += n - w;
+    return w;
+}
+
+static void Id3_Free(Id3Tag* t)
+{
+    if (t->data)   GlobalFree(t->data);
+    if (t->frames) GlobalFree(t->frames);
+    ZeroMemory(t, sizeof(*t));
+}
+
+static BOOL Id3_IsFrameIdChar(BYTE c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+static BOOL Id3_AddFrame(Id3Tag* t, int* cap, const BYTE* id, int idLen, BYTE fmt, DWORD pos, DWORD size)
+{
+    if (t->count == *cap) {
+        int grow = *cap ? *cap * 2 : 32;
+        HGLOBAL p = t->frames ? GlobalReAlloc(t->frames, grow * sizeof(Id3Frame), GMEM_MOVEABLE)
+                              : GlobalAlloc(GMEM_FIXED, grow * sizeof(Id3Frame));
+        if (!p) return FALSE;
+        t->frames = (Id3Frame*)p;
+        *cap = grow;
+    }
+    Id3Frame* fr = &t->frames[t->count++];
+    ZeroMemory(fr, sizeof(*fr));
+    CopyMemory(fr->id, id, idLen);
+    fr->fmt  = fmt;
+    fr->pos  = pos;
+    fr->size = size;
+    return TRUE;
+}
+
+/**
+ * @brief Read the tag starting at @p at and index its frames
+ * @brief Прочитать тег, начинающийся с @p at, и проиндексировать его фреймы
+ *
+ * Two reads in total: the 10-byte header and then the rest of the tag in one
+ * piece, clipped to the end of the file. Frames are walked in memory.
+ * Всего два чтения: 10-байтовый заголовок, затем остаток тега одним куском,
+ * обрезанным по концу файла. Фреймы обходятся в памяти.
+ */
+static BOOL Id3_Open(FileHandle& f, unsigned __int64 at, Id3Tag* t)
+{
+    ZeroMemory(t, sizeof(*t));
 
-    BYTE ver = hdr[3];      // Version (e.g., 3 for ID3v2.3)
-    BYTE flags = hdr[5];    // Flags
-    DWORD tagSize = SyncSafeToInt(&hdr[6]); // Size is encoded as SyncSafe (7 bits per byte)
+    BYTE hdr[10];
+    if (!Id3_ReadAt(f, at, hdr, 10)) return FALSE;
+    CopyMemory(t->lead, hdr, 4);
+    if (memcmp(hdr, "ID3", 3) != 0) return FALSE;
+    if (hdr[3] < 2 || hdr[3] > 4) return FALSE;
 
     // Safety check: Tag size reasonable? (Max 32MB)
     // Проверка безопасности: Разумен ли размер тега? (Макс 32МБ)
+    DWORD tagSize = SyncSafeToInt(&hdr[6]);
     if (tagSize < 10 || tagSize > (32 * 1024 * 1024)) return FALSE;
 
-    // 2. Handle Extended Header (if present)
-    // 2. Обработка расширенного заголовка (если есть)
-    if ((ver == 3 || ver == 4) && (flags & 0x40)) {
-        BYTE ex[10];
-        if (!f.Read(ex, 10)) return FALSE;
-        
-        // v2.4 uses SyncSafe for ext header size, v2.3 uses regular integer
-        DWORD extSize = (ver == 4) ? SyncSafeToInt(ex) : BE32(ex);
-        
-        if (extSize > tagSize) return FALSE;
-        
-        // Skip extended header data
-        // For v2.3 size excludes header itself, for v2.4 it's tricky.
-        // Assuming standard structure for safety: seek minus read bytes.
-        f.Seek(extSize - 10, FILE_CURRENT); 
-        tagSize -= extSize;
-    }
-
-    DWORD remaining = tagSize;
-    BOOL ok = FALSE;
+    unsigned __int64 fileSize = f.GetSize64();
+    if (fileSize && at + 10 + tagSize > fileSize) {
+        if (at + 10 >= fileSize) return FALSE;
+        tagSize = (DWORD)(fileSize - at - 10);   // truncated tag: index what is there / обрезанный тег
+    }
+
+    t->data = (BYTE*)GlobalAlloc(GMEM_FIXED, 10 + tagSize);
+    if (!t->data) return FALSE;
+    CopyMemory(t->data, hdr, 10);
+    if (!Id3_ReadAt(f, at + 10, t->data + 10, tagSize)) {
+        Id3_Free(t);
+        return FALSE;
+    }
+    t->ver    = hdr[3];
+    t->flags  = hdr[5];
+    t->base   = at;
+    t->size   = 10 + tagSize;
+    t->stored = tagSize;
+    s_stats.tags++;
+
+    // v2.2/v2.3: the whole body, frame headers included, is unsynchronised
+    // v2.2/v2.3: unsynchronised всё тело, включая заголовки фреймов
+    if (t->ver < 4 && (t->flags & 0x80)) {
+        t->size   = 10 + ID3v2_Resync(t->data + 10, tagSize);
+        t->unsync = TRUE;
+    }
+
+    DWORD pos = 10;
+    DWORD end = t->size;
+    if ((t->ver == 3 || t->ver == 4) && (t->flags & 0x40)) {
+        if (end - pos < 4) return TRUE;
+        // v2.3 size excludes its own 4 bytes, v2.4 includes them
+        // В v2.3 размер не включает свои 4 байта, в v2.4 включает
+        DWORD extSize = (t->ver == 4) ? SyncSafeToInt(t->data + pos) : BE32(t->data + pos) + 4;
+        if (extSize > end - pos) return TRUE;
+        pos += extSize;
+    }
+
+    const DWORD headerLen = (t->ver == 2) ? 6 : 10;
+    const int   idLen     = (t->ver == 2) ? 3 : 4;
+    int cap = 0;
+    while (pos + headerLen <= end) {
+        const BYTE* fh = t->data + pos;
+        if (fh[0] == 0) break; // Padding reached / Достигнут padding
+
+        BOOL valid = TRUE;
+        for (int i = 0; i < idLen; ++i) valid = valid && Id3_IsFrameIdChar(fh[i]);
+        if (!valid) break;
 
-    // 3. Iterate frames
-    // 3. Итерация по фреймам
-    while (remaining > 0) {
-        DWORD frameSize = 0;
-        BOOL isCover = FALSE;
-        DWORD headerLen = 0;
-
-        // Parse frame header based on version
-        // Парсинг заголовка фрейма в зависимости от версии
-        if (ver == 2) {
-            // ID3v2.2: 3 char ID, 3 byte size
-            BYTE fh[6];
-            if (!f.Read(fh, 6) || fh[0] == 0) break; // Padding reached / Достигнут padding
+        DWORD frameSize;
+        BYTE  fmt = 0;
+        if (t->ver == 2) {
             frameSize = BE24(&fh[3]);
-            if (memcmp(fh, "PIC", 3) == 0) isCover = TRUE;
-            headerLen = 6;
-        } else { 
-            // ID3v2.3/2.4: 4 char ID, 4 byte size
-            BYTE fh[10];
-            if (!f.Read(fh, 10) || fh[0] == 0) break;
+        } else {
             // v2.4 uses SyncSafe size, v2.3 uses Integer
-            frameSize = (ver == 4) ? SyncSafeToInt(&fh[4]) : BE32(&fh[4]);
-            if (memcmp(fh, "APIC", 4) == 0) isCover = TRUE;
-            headerLen = 10;
+            frameSize = (t->ver == 4) ? SyncSafeToInt(&fh[4]) : BE32(&fh[4]);
+            fmt = fh[9];
         }
+        if (frameSize > end - pos - headerLen) break;
 
-        if (frameSize > remaining) break;
-        remaining -= headerLen;
+        if (!Id3_AddFrame(t, &cap, fh, idLen, fmt, pos + headerLen, frameSize)) break;
+        t->frames[t->count - 1].stored = frameSize;
+        pos += headerLen + frameSize;
+    }
+    s_stats.frames += t->count;
+    return TRUE;
+}
 
-        if (!isCover) {
-            // Skip irrelevant frames
-            // Пропуск ненужных фреймов
-            f.Seek(frameSize, FILE_CURRENT);
-        } else {
-            // 4. Extract Picture
-            // 4. Извлечение изображения
-            BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, frameSize);
-            if (buf) {
-                if (f.Read(buf, frameSize)) {
-                    // Frame structure / Структура фрейма:
-                    // PIC (v2):  [Enc(1)] [Fmt(3)] [Type(1)] [Desc...] [Data]
-                    // APIC (v3): [Enc(1)] [Mime(str)] [Type(1)] [Desc...] [Data]
-                    
-                    DWORD p = 1; 
-                    BYTE enc = buf[0];
-                    
-                    if (ver == 2) {
-                        p = 5; // Skip Enc(1) + Fmt(3) + Type(1)
-                    } else {
-                        // Skip MIME type (null-terminated string)
-                        while (p < frameSize && buf[p] != 0) ++p; 
-                        p++; // Skip zero
-                        p++; // Skip Picture Type
-                    }
-                    
-                    // Skip Description (encoded string)
-                    // Пропуск описания (кодированная строка)
-                    p += SkipEncodedString(&buf[p], frameSize - p, enc);
-
-                    // Load actual image data
-                    if (p < frameSize) {
-                        ok = Img_LoadFromMemoryToBitmap(&buf[p], frameSize - p, phbm, psz);
-                    }
-                }
-                GlobalFree(buf);
+/**
+ * @brief Find the next frame with ID @p id at or after index @p from
+ * @brief Найти следующий фрейм с ID @p id, начиная с индекса @p from
+ *
+ * @return Frame number or -1 / Номер фрейма или -1
+ */
+static int Id3_FindFrame(const Id3Tag* t, const char* id, int from)
+{
+    for (int i = (from < 0 ? 0 : from); i < t->count; ++i) {
+        if (lstrcmpA(t->frames[i].id, id) == 0) return i;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Tag Chain / Цепочка тегов
+// ============================================================================
+
+/**
+ * @brief All ID3v2 tags of a file / Все теги ID3v2 файла
+ */
+typedef struct {
+    Id3Tag tag[ID3_MAX_TAGS];
+    int    count;
+} Id3Chain;
+
+static void Id3_FreeChain(Id3Chain* c)
+{
+    for (int i = 0; i < c->count; ++i) Id3_Free(&c->tag[i]);
+    c->count = 0;
+}
+
+static BOOL Id3_ChainHas(const Id3Chain* c, unsigned __int64 at)
+{
+    for (int i = 0; i < c->count; ++i) {
+        if (c->tag[i].base == at) return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOL Id3_ChainOpen(FileHandle& f, Id3Chain* c, unsigned __int64 at)
+{
+    if (c->count >= ID3_MAX_TAGS || Id3_ChainHas(c, at)) return FALSE;
+    if (!Id3_Open(f, at, &c->tag[c->count])) return FALSE;
+    c->count++;
+    return TRUE;
+}
+
+/**
+ * @brief Open the tag at the start of the file, the one its SEEK frame points to
+ *        and the one appended to the end of the file
+ * @brief Открыть тег в начале файла, тег, на который указывает его фрейм SEEK,
+ *        и тег, дописанный в конец файла
+ *
+ * Every tag is reached directly: SEEK gives the offset from the end of the
+ * tag, the "3DI" footer is found in the shared tail read (TagTail), which the
+ * APE reader reuses. The audio in between is never scanned. WAV, AIFF, DSF
+ * and DSDIFF files keep their tag in a chunk instead (ChunkTag_FindId3v2).
+ * Каждый тег достигается напрямую: SEEK задаёт смещение от конца тега, footer
+ * "3DI" находится в общем чтении конца файла (TagTail), которое повторно
+ * использует ридер APE. Аудио между ними никогда не сканируется. Файлы WAV,
+ * AIFF, DSF и DSDIFF хранят тег в чанке (ChunkTag_FindId3v2).
+ *
+ * @return Number of tags opened / Количество открытых тегов
+ */
+static int Id3_OpenChain(FileHandle& f, const char* path, Id3Chain* c)
+{
+    ZeroMemory(c, sizeof(*c));
+    // A failed open leaves the first bytes of the file in tag[0]
+    // Неудачное открытие оставляет первые байты файла в tag[0]
+    unsigned __int64 chunk = 0;
+    if (!Id3_ChainOpen(f, c, 0) && ChunkTag_IsContainer(c->tag[0].lead) && ChunkTag_FindId3v2(f, &chunk)) {
+        Id3_ChainOpen(f, c, chunk);
+    }
+
+    // SEEK (v2.4): minimum offset to the next tag, counted from the end of this one
+    // SEEK (v2.4): минимальное смещение до следующего тега от конца текущего
+    if (c->count == 1 && c->tag[0].ver == 4) {
+        const Id3Tag* t = &c->tag[0];
+        int i = Id3_FindFrame(t, "SEEK", 0);
+        if (i >= 0 && t->frames[i].size >= 4) {
+            unsigned __int64 end = t->base + 10 + SyncSafeToInt(t->data + 6);
+            if (t->flags & 0x10) end += 10;   // footer present / есть footer
+            Id3_ChainOpen(f, c, end + BE32(t->data + t->frames[i].pos));
+        }
+    }
+
+    TagTail tail;
+    unsigned __int64 at = 0;
+    if (TagTail_Get(path, f, &tail) && TagTail_FindId3v2(&tail, f, &at)) {
+        Id3_ChainOpen(f, c, at);
+    }
+    return c->count;
+}
+
+/**
+ * @brief Work out the bytes in front of the frame data and undo v2.4
+ *        per-frame unsynchronisation in the tag buffer, once
+ * @brief Определить байты перед данными фрейма и один раз снять пофреймовый
+ *        unsynchronisation v2.4 в буфере тега
+ *
+ * The content only shrinks, so it stays at the same offset. The data length
+ * indicator, when present, bounds the decoded size. Compressed data is left
+ * as it is: it is inflated only when needed. A frame too short for its own
+ * header bytes once decoded is left empty.
+ * Содержимое только уменьшается, поэтому остаётся по тому же смещению.
+ * Индикатор длины данных, если есть, ограничивает декодированный размер.
+ * Сжатые данные остаются как есть: они распаковываются только при необходимости.
+ * Фрейм, которому после декодирования не хватает байт на собственный
+ * заголовок, остаётся пустым.
+ */
+static void Id3_PrepareFrame(Id3Tag* t, Id3Frame* fr)
+{
+    if (fr->ready) return;
+    fr->ready = TRUE;
+
+    if (t->ver == 3) {
+        // [decompressed size(4)] [encryption method(1)] [group id(1)]
+        if (fr->fmt & 0x80) {
+            if (fr->size < 4) return;
+            fr->dlen = BE32(t->data + fr->pos);
+            fr->extra += 4;
+            fr->coding |= PIC_CODING_ZLIB;
+        }
+        if (fr->fmt & 0x40) fr->extra++;
+        if (fr->fmt & 0x20) fr->extra++;
+    } else if (t->ver == 4) {
+        // The tag flag marks every frame as unsynchronised; the flag bytes and the
+        // indicator are part of the unsynchronised data, so they are read after decoding
+        // Флаг тега отмечает все фреймы как unsynchronised; байты флагов и индикатор
+        // входят в unsynchronised данные, поэтому читаются после декодирования
+        if ((fr->fmt & 0x02) || (t->flags & 0x80)) {
+            fr->size    = ID3v2_Resync(t->data + fr->pos, fr->size);
+            fr->coding |= PIC_CODING_UNSYNC;
+        }
+
+        // [group id(1)] [encryption method(1)] [data length indicator(4)]
+        if (fr->fmt & 0x40) fr->extra++;
+        if (fr->fmt & 0x04) fr->extra++;
+        DWORD dli = 0;
+        if (fr->fmt & 0x01) {
+            if (fr->size < fr->extra + 4) { fr->size = fr->extra = 0; return; }
+            dli = SyncSafeToInt(t->data + fr->pos + fr->extra);
+            fr->extra += 4;
+        }
+        if (fr->size < fr->extra) { fr->size = fr->extra = 0; return; }
+
+        // Compression requires the indicator: it is the inflated size
+        // Сжатие требует индикатора: это размер после распаковки
+        if (fr->fmt & 0x08) {
+            fr->dlen    = dli;
+            fr->coding |= PIC_CODING_ZLIB;
+        } else if (dli && dli <= fr->size - fr->extra) {
+            fr->size = fr->extra + dli;
+        }
+    }
+}
+
+/**
+ * @brief Parse the header fields of a PIC/APIC frame
+ * @brief Разобрать поля заголовка фрейма PIC/APIC
+ *
+ * @param buf, cb Frame data (a prefix is enough) / Данные фрейма (достаточно начала)
+ * @param pic [out] Image range, type, MIME and description / Диапазон изображения, тип, MIME и описание
+ * @return FALSE if the frame holds no picture / FALSE если во фрейме нет изображения
+ */
+static BOOL Id3_ParsePicture(BYTE ver, const BYTE* buf, DWORD cb, Id3Picture* pic)
+{
+    ZeroMemory(pic, sizeof(*pic));
+    if (!cb) return FALSE;
+
+    // Frame structure / Структура фрейма:
+    // PIC (v2):  [Enc(1)] [Fmt(3)] [Type(1)] [Desc...] [Data]
+    // APIC (v3): [Enc(1)] [Mime(str)] [Type(1)] [Desc...] [Data]
+    BYTE enc = buf[0];
+    DWORD p;
+    if (ver == 2) {
+        if (cb < 5) return FALSE;
+        CopyMemory(pic->mime, buf + 1, 3);
+        pic->cand.type = buf[4];
+        p = 5; // Skip Enc(1) + Fmt(3) + Type(1)
+    } else {
+        // MIME type (null-terminated string)
+        p = 1;
+        while (p < cb && buf[p] != 0) {
+            if (p - 1 < sizeof(pic->mime) - 1) pic->mime[p - 1] = (char)buf[p];
+            ++p;
+        }
+        p++; // Skip zero
+        if (p >= cb) return FALSE;
+        pic->cand.type = buf[p];
+        p++; // Skip Picture Type
+    }
+    if (p >= cb) return FALSE;
+
+    // "-->" means the frame holds a URL, not an image
+    // "-->" означает, что во фрейме URL, а не изображение
+    if (lstrcmpA(pic->mime, "-->") == 0) return FALSE;
+
+    // Description (encoded string)
+    // Описание (кодированная строка)
+    DWORD d = SkipEncodedString(&buf[p], cb - p, enc);
+    DWORD term = (enc == 1 || enc == 2) ? 2 : 1;
+    pic->descPos = p;
+    pic->descLen = (d >= term) ? d - term : 0;
+    p += d;
+    if (p >= cb) return FALSE;
+
+    pic->pos = p;
+    pic->len = cb - p;
+    return TRUE;
+}
+
+/**
+ * @brief Collect every usable picture of the chain, with sizes probed from the image headers
+ * @brief Собрать все пригодные изображения цепочки с размерами из заголовков изображений
+ *
+ * Compressed frames are inflated only up to ID3_HEAD_BYTES for this, into the
+ * shared scratch buffer; pictures whose header exceeds IMG_MAX_PIXELS are
+ * dropped before anything else is inflated.
+ * Сжатые фреймы для этого распаковываются только до ID3_HEAD_BYTES в общий
+ * рабочий буфер; изображения, чей заголовок превышает IMG_MAX_PIXELS,
+ * отбрасываются до дальнейшей распаковки.
+ *
+ * @return Number of candidates / Количество кандидатов
+ */
+static int Id3_CollectPictures(Id3Chain* c, Id3Picture* pics, int max)
+{
+    int n = 0;
+    for (int k = 0; k < c->count; ++k) {
+        Id3Tag* t = &c->tag[k];
+        const char* id = (t->ver == 2) ? "PIC" : "APIC";
+        for (int i = Id3_FindFrame(t, id, 0); i >= 0 && n < max; i = Id3_FindFrame(t, id, i + 1)) {
+            Id3Frame* fr = &t->frames[i];
+            Id3_PrepareFrame(t, fr);
+            if ((t->ver == 3 && (fr->fmt & 0x40)) || (t->ver == 4 && (fr->fmt & 0x04))) continue;   // encrypted
+            if (fr->size <= fr->extra) continue;
+
+            const BYTE* data = t->data + fr->pos + fr->extra;
+            DWORD cb = fr->size - fr->extra;
+            Id3Picture* pic = &pics[n];
+
+            if (fr->coding & PIC_CODING_ZLIB) {
+                if (!fr->dlen || fr->dlen > ID3_MAX_INFLATE) continue;
+                DWORD want = (fr->dlen < ID3_HEAD_BYTES) ? fr->dlen : ID3_HEAD_BYTES;
+                BYTE* head = Inflate_Scratch(want);
+                DWORD got = 0;
+                int r = head ? Inflate_Zlib(data, cb, head, want, &got) : INFLATE_ERROR;
+                if (r == INFLATE_ERROR) continue;
+                if (r == INFLATE_DONE) fr->dlen = got;   // shorter than declared / короче объявленного
+                if (!Id3_ParsePicture(t->ver, head, got, pic)) continue;
+                pic->len = fr->dlen - pic->pos;
+                Img_ProbeSize(head + pic->pos, got - pic->pos, &pic->cand.dim);
+                if ((double)pic->cand.dim.cx * pic->cand.dim.cy > IMG_MAX_PIXELS) continue;
+            } else {
+                if (!Id3_ParsePicture(t->ver, data, cb, pic)) continue;
+                Img_ProbeSize(data + pic->pos, pic->len, &pic->cand.dim);
             }
-            if (ok) return TRUE; // Stop after first valid cover / Остановка после первой валидной обложки
+            pic->tag   = k;
+            pic->frame = i;
+            ++n;
         }
-        
-        if (remaining < frameSize) break;
-        remaining -= frameSize;
     }
-    return FALSE;
-}
\ No newline at end of file
+    return n;
+}
+
+/**
+ * @brief Image bytes of a candidate; compressed frames are inflated into the scratch buffer
+ * @brief Байты изображения кандидата; сжатые фреймы распаковываются в рабочий буфер
+ *
+ * The output is bounded by the declared size: a stream that inflates to more is rejected.
+ * Выход ограничен объявленным размером: поток, распаковывающийся в большее, отвергается.
+ *
+ * @return Image bytes or NULL / Байты изображения или NULL
+ */
+static const BYTE* Id3_PictureBytes(const Id3Chain* c, const Id3Picture* pic)
+{
+    const Id3Tag*   t  = &c->tag[pic->tag];
+    const Id3Frame* fr = &t->frames[pic->frame];
+    const BYTE* data = t->data + fr->pos + fr->extra;
+    if (!(fr->coding & PIC_CODING_ZLIB)) return data + pic->pos;
+
+    BYTE* out = Inflate_Scratch(fr->dlen);
+    DWORD got = 0;
+    if (!out || Inflate_Zlib(data, fr->size - fr->extra, out, fr->dlen, &got) != INFLATE_DONE || got != fr->dlen) {
+        return NULL;
+    }
+    s_stats.inflates++;
+    return out + pic->pos;
+}
+
+// ============================================================================
+// Main Logic / Основная логика
+// ============================================================================
+
+BOOL __cdecl ID3v2_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz) {
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return FALSE;
+
+    Id3Chain c;
+    if (!Id3_OpenChain(f, audioPath, &c)) return FALSE;
+
+    // No I/O from here on: the frame indexes point into the tag buffers.
+    // Only the chosen picture is decoded; the next best one only if that fails.
+    // Дальше без ввода-вывода: индексы фреймов указывают в буферы тегов.
+    // Декодируется только выбранное изображение; следующее - только при ошибке.
+    Id3Picture pics[ID3_MAX_PICTURES];
+    int n = Id3_CollectPictures(&c, pics, ID3_MAX_PICTURES);
+
+    BOOL ok = FALSE;
+    for (int best = PicIndex_Best(pics, n, sizeof(pics[0])); best >= 0 && !ok; best = PicIndex_Best(pics, n, sizeof(pics[0]))) {
+        const BYTE* img = Id3_PictureBytes(&c, &pics[best]);
+        if (img) {
+            s_stats.decodes++;
+            ok = Img_LoadFromMemoryToBitmap(img, pics[best].len, phbm, psz);
+        }
+        pics[best].cand.failed = !ok;
+    }
+    Inflate_ReleaseScratch(FALSE);
+    Id3_FreeChain(&c);
+    return ok;
+}
+
+int __cdecl ID3v2_IndexPicturesA(const char* audioPath, PictureIndex* idx) {
+    if (!idx) return 0;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return 0;
+
+    Id3Chain c;
+    if (!Id3_OpenChain(f, audioPath, &c)) return 0;
+
+    Id3Picture pics[ID3_MAX_PICTURES];
+    int n = Id3_CollectPictures(&c, pics, ID3_MAX_PICTURES);
+
+    int added = 0;
+    for (int i = 0; i < n; ++i) {
+        const Id3Picture* pic = &pics[i];
+        const Id3Tag*     t   = &c.tag[pic->tag];
+        const Id3Frame*   fr  = &t->frames[pic->frame];
+        BOOL  zlib = (fr->coding & PIC_CODING_ZLIB) != 0;
+        DWORD data = fr->pos + fr->extra;   // frame data in the decoded tag / данные фрейма в декодированном теге
+        BOOL ok;
+        if (t->unsync) {
+            // Decoded offsets don't map back to the file: index the whole stored body
+            // Декодированные смещения не отображаются в файл: индексируется всё тело тега
+            ok = PicIndex_AddCoded(idx, t->base + 10, t->stored, pic->cand.type, PIC_SRC_ID3V2,
+                                   (BYTE)(fr->coding | PIC_CODING_UNSYNC), data - 10,
+                                   zlib ? pic->pos : data - 10 + pic->pos, pic->len);
+        } else if (fr->coding) {
+            ok = PicIndex_AddCoded(idx, t->base + fr->pos, fr->stored, pic->cand.type, PIC_SRC_ID3V2,
+                                   fr->coding, fr->extra,
+                                   zlib ? pic->pos : fr->extra + pic->pos, pic->len);
+        } else {
+            ok = PicIndex_Add(idx, t->base + data + pic->pos, pic->len, pic->cand.type, PIC_SRC_ID3V2);
+        }
+        if (ok) ++added;
+    }
+    Inflate_ReleaseScratch(FALSE);
+    Id3_FreeChain(&c);
+    return added;
+}
+
+void __cdecl ID3v2_GetStats(ID3v2Stats* out) {
+    if (out) *out = s_stats;
+}
@@ -10,9 +10,14 @@
  * - PIC (ID3v2.2)
  * - APIC (ID3v2.3, ID3v2.4)
  * * Logic handles / Логика обрабатывает:
- * - Unsynchronization (SyncSafe integers)
+ * - SyncSafe integers
+ * - Unsynchronisation (whole tag in v2.2/v2.3, per frame in v2.4) and the v2.4 data length indicator
+ *   (unsynchronisation всего тега в v2.2/v2.3, пофреймово в v2.4, и индикатор длины данных v2.4)
+ * - zlib-compressed frames (сжатые zlib фреймы)
  * - Extended headers
  * - Text encoding byte skipping (ISO-8859-1, UTF-16, UTF-16BE, UTF-8)
+ * - Tags appended to the end of the file ("3DI" footer) and SEEK frames
+ *   (дописанные в конец файла теги и фреймы SEEK)
  * * @author [Your Name]
  * @date 2025
  * @version 1.0
@@ -20,16 +25,37 @@
 
 #pragma once
 #include <windows.h>
+#include "picture_index.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Reader statistics / Статистика ридера
+ */
+typedef struct {
+    DWORD tags;        ///< Tags read / Прочитано тегов
+    DWORD frames;      ///< Frames indexed / Проиндексировано фреймов
+    DWORD reads;       ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;   ///< Bytes read / Прочитано байт
+    DWORD decodes;     ///< Pictures handed to the decoder / Изображений передано декодеру
+    DWORD resyncs;     ///< Tags and frames resynchronised / Тегов и фреймов, с которых снят unsynchronisation
+    DWORD resyncBytes; ///< Stuffing bytes removed / Удалено вставленных байт
+    DWORD inflates;    ///< Compressed pictures inflated in full / Сжатых изображений распаковано целиком
+} ID3v2Stats;
+
 /**
  * @brief Extract cover art from ID3v2 tagged file
  * @brief Извлечь обложку из файла с ID3v2 тегами
- * * Parses the ID3v2 header and iterates through frames to find the attached picture.
- * * Парсит заголовок ID3v2 и итерируется по фреймам для поиска прикрепленного изображения.
+ * * Reads the whole tag with one bounded read, indexes its frames in memory and
+ * picks the attached picture from the index without further I/O. Every APIC is
+ * described first (type, MIME, description, size from the image header); the
+ * one ranked best by PicIndex_Prefer() is the only one decoded.
+ * * Читает весь тег одним ограниченным чтением, индексирует фреймы в памяти и
+ * выбирает прикреплённое изображение по индексу без дальнейшего ввода-вывода.
+ * Сначала описывается каждый APIC (тип, MIME, описание, размер из заголовка
+ * изображения); декодируется только лучший по PicIndex_Prefer().
  * * @param audioPath Path to the audio file / Путь к аудиофайлу
  * @param phbm [out] Receives handle to loaded bitmap / Получает дескриптор загруженного bitmap'а
  * @param psz [out] Receives bitmap dimensions / Получает размеры bitmap'а
@@ -37,6 +63,34 @@ extern "C" {
  */
 BOOL ID3v2_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz);
 
+/**
+ * @brief Index every APIC/PIC frame without reading the image bytes
+ * @brief Проиндексировать все фреймы APIC/PIC, не читая байты изображений
+ *
+ * @param audioPath Path to the audio file / Путь к аудиофайлу
+ * @param idx [in,out] Index to append to / Индекс для дополнения
+ * @return Number of pictures added / Количество добавленных изображений
+ */
+int ID3v2_IndexPicturesA(const char* audioPath, PictureIndex* idx);
+
+/**
+ * @brief Undo unsynchronisation in place: drop the 0x00 that follows every 0xFF
+ * @brief Снять unsynchronisation на месте: удалить 0x00 после каждого 0xFF
+ *
+ * Runs of 16 bytes without 0xFF are moved with SSE2 when the CPU has it.
+ * Участки по 16 байт без 0xFF переносятся через SSE2, если процессор его поддерживает.
+ *
+ * @param p Data / Данные
+ * @param n Stored size / Хранимый размер
+ * @return Decoded size (<= n) / Декодированный размер (<= n)
+ */
+DWORD ID3v2_Resync(BYTE* p, DWORD n);
+
+/**
+ * @brief Copy reader statistics / Скопировать статистику ридера
+ */
+void ID3v2_GetStats(ID3v2Stats* out);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
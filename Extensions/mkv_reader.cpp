@@ -0,0 +1,379 @@
+/**
+ * @file mkv_reader.cpp
+ * @brief Matroska cover art extractor implementation
+ * @brief Реализация экстрактора обложек Matroska
+ *
+ * Element layout / Структура элемента:
+ * ID (1-4 bytes, length marker kept) size (1-8 bytes, length marker removed,
+ * all ones = unknown) data. Both are EBML variable-length integers: the
+ * number of leading zero bits of the first byte gives the extra bytes.
+ * ID (1-4 байта, маркер длины сохраняется) размер (1-8 байт, маркер длины
+ * убирается, все единицы = неизвестен) данные. Оба - целые EBML переменной
+ * длины: число ведущих нулевых битов первого байта даёт число доп. байт.
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <string.h>
+#include <shlwapi.h>
+#pragma comment(lib, "shlwapi.lib")
+#include "mkv_reader.h"
+#include "..\image_loader.h"
+#include "..\utils_common.h"
+
+typedef unsigned __int64 U64;
+
+#define MKV_WINDOW       (4 * 1024)             ///< Read size: headers of one place in the file / Размер чтения: заголовки одного места файла
+#define MKV_SNIFF        64                     ///< First read of a file not named as Matroska / Первое чтение файла, не названного как Matroska
+#define MKV_MAX_TOP      64                     ///< Top-level elements walked without a SeekHead / Элементов верхнего уровня без SeekHead
+#define MKV_MAX_SEEKHEAD (64 * 1024)            ///< Largest SeekHead read / Наибольший читаемый SeekHead
+#define MKV_MAX_FILES    256                    ///< Attached files looked at / Просматриваемых вложений
+#define MKV_MAX_PICTURES 32
+#define MKV_MAX_PICTURE  (16 * 1024 * 1024)     ///< Same limit as FLAC / Тот же предел, что у FLAC
+#define MKV_MAX_NAME     128                    ///< Name and MIME bytes kept / Сохраняемых байт имени и MIME
+
+// Element IDs / ID элементов
+#define MKV_ID_EBML         0x1A45DFA3
+#define MKV_ID_DOCTYPE      0x4282
+#define MKV_ID_SEGMENT      0x18538067
+#define MKV_ID_SEEKHEAD     0x114D9B74
+#define MKV_ID_SEEK         0x4DBB
+#define MKV_ID_SEEKID       0x53AB
+#define MKV_ID_SEEKPOS      0x53AC
+#define MKV_ID_CLUSTER      0x1F43B675
+#define MKV_ID_ATTACHMENTS  0x1941A469
+#define MKV_ID_ATTACHEDFILE 0x61A7
+#define MKV_ID_FILENAME     0x466E
+#define MKV_ID_FILEMIME     0x4660
+#define MKV_ID_FILEDATA     0x465C
+
+static MKVStats s_stats = {0};
+
+static BOOL HasMkvExt(const char* path) {
+    const char* ext = PathFindExtensionA(path);
+    if (!ext || !*ext) return FALSE;
+
+    return lstrcmpiA(ext, ".mka") == 0 || lstrcmpiA(ext, ".mkv") == 0 ||
+           lstrcmpiA(ext, ".webm") == 0;
+}
+
+/**
+ * @brief Header of one element / Заголовок одного элемента
+ */
+typedef struct {
+    U64   off;       ///< Element start / Начало элемента
+    U64   data;      ///< Data start / Начало данных
+    U64   size;      ///< Data size / Размер данных
+    DWORD id;
+} MkvElem;
+
+/**
+ * @brief One image attachment, described without reading it
+ * @brief Одно вложенное изображение, описанное без чтения
+ *
+ * Sizes are unknown until decoded, so the name decides: the type comes from
+ * it, and "cover.*" goes before "cover_land.*".
+ * Размеры неизвестны до декодирования, поэтому решает имя: тип берётся из
+ * него, и "cover.*" идёт раньше "cover_land.*".
+ */
+typedef struct {
+    PictureCandidate cand;   ///< Type from the file name, tie 1 for "*_land" / Тип по имени файла, tie 1 для "*_land"
+    U64   pos;       ///< FileData start / Начало FileData
+    DWORD len;
+} MkvPicture;
+
+/**
+ * @brief File, read window and the attachments found
+ * @brief Файл, окно чтения и найденные вложения
+ */
+typedef struct {
+    FileWindow  win;      ///< Block size MKV_SNIFF until the file is known to be Matroska / Размер блока MKV_SNIFF, пока файл не признан Matroska
+    MkvPicture  pics[MKV_MAX_PICTURES];
+    int         count;
+} MkvReader;
+
+static BOOL Mkv_Open(MkvReader* r, FileHandle& f, const char* path)
+{
+    ZeroMemory(r, sizeof(*r));
+    FileWindow_Init(&r->win, f, HasMkvExt(path) ? MKV_WINDOW : MKV_SNIFF, &s_stats.reads, &s_stats.bytesRead);
+    return r->win.end >= 16;
+}
+
+// Bytes taken by a variable-length integer from its first byte, 0 if invalid
+// Байт, занимаемых целым переменной длины, по его первому байту, 0 если неверно
+static DWORD Mkv_VintLen(BYTE b)
+{
+    for (DWORD n = 1; n <= 8; ++n) {
+        if (b & (0x80 >> (n - 1))) return n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse the element header at @p off
+ * @brief Разобрать заголовок элемента по смещению @p off
+ *
+ * An unknown size (streamed Segment) runs to @p limit; a Segment larger than
+ * the file (interrupted recording) is cut at @p limit as well.
+ * Неизвестный размер (потоковый Segment) продолжается до @p limit; Segment
+ * больше файла (прерванная запись) также обрезается по @p limit.
+ *
+ * @param limit End of the parent / Конец родителя
+ */
+static BOOL Mkv_Header(MkvReader* r, U64 off, U64 limit, MkvElem* e)
+{
+    if (off >= limit || limit - off < 2) return FALSE;
+    DWORD need = (limit - off < 12) ? (DWORD)(limit - off) : 12;
+    const BYTE* p = FileWindow_View(&r->win, off, need);
+    if (!p) return FALSE;
+    s_stats.elements++;
+
+    DWORD il = Mkv_VintLen(p[0]);
+    if (!il || il > 4 || il >= need) return FALSE;
+    DWORD id = 0;
+    for (DWORD i = 0; i < il; ++i) id = (id << 8) | p[i];
+
+    DWORD sl = Mkv_VintLen(p[il]);
+    if (!sl || il + sl > need) return FALSE;
+    U64  size    = p[il] & (0xFF >> sl);
+    BOOL unknown = (size == (U64)(0xFF >> sl));
+    for (DWORD i = 1; i < sl; ++i) {
+        size = (size << 8) | p[il + i];
+        unknown = unknown && p[il + i] == 0xFF;
+    }
+
+    e->id   = id;
+    e->off  = off;
+    e->data = off + il + sl;
+    if (unknown || (id == MKV_ID_SEGMENT && size > limit - e->data)) size = limit - e->data;
+    if (size > limit - e->data) return FALSE;
+    e->size = size;
+    return TRUE;
+}
+
+// Unsigned integer element (SeekID, SeekPosition) / Элемент беззнакового целого
+static BOOL Mkv_Uint(MkvReader* r, const MkvElem* e, U64* v)
+{
+    if (!e->size || e->size > 8) return FALSE;
+    const BYTE* p = FileWindow_View(&r->win, e->data, (DWORD)e->size);
+    if (!p) return FALSE;
+    *v = 0;
+    for (DWORD i = 0; i < (DWORD)e->size; ++i) *v = (*v << 8) | p[i];
+    return TRUE;
+}
+
+// String element, cut to @p cap - 1 bytes / Строковый элемент, обрезанный до @p cap - 1 байт
+static void Mkv_String(MkvReader* r, const MkvElem* e, char* out, DWORD cap)
+{
+    DWORD n = (e->size < cap - 1) ? (DWORD)e->size : cap - 1;
+    const BYTE* p = n ? FileWindow_View(&r->win, e->data, n) : NULL;
+    if (!p) n = 0;
+    if (n) CopyMemory(out, p, n);
+    out[n] = 0;
+}
+
+// ASCII prefix, case-insensitive / Префикс ASCII без учёта регистра
+static BOOL Mkv_StartsWith(const char* s, const char* prefix)
+{
+    for (; *prefix; ++s, ++prefix) {
+        char a = *s, b = *prefix;
+        if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+        if (a != b) return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Check the EBML header and find the Segment data
+ * @brief Проверить заголовок EBML и найти данные Segment
+ */
+static BOOL Mkv_Segment(MkvReader* r, MkvElem* seg)
+{
+    MkvElem ebml, c;
+    if (!Mkv_Header(r, 0, r->win.end, &ebml) || ebml.id != MKV_ID_EBML) return FALSE;
+
+    // DocType defaults to "matroska" / DocType по умолчанию "matroska"
+    U64 end = ebml.data + ebml.size;
+    for (U64 pos = ebml.data; pos < end && Mkv_Header(r, pos, end, &c); pos = c.data + c.size) {
+        if (c.id != MKV_ID_DOCTYPE) continue;
+        char type[16];
+        Mkv_String(r, &c, type, sizeof(type));
+        if (lstrcmpA(type, "matroska") != 0 && lstrcmpA(type, "webm") != 0) return FALSE;
+    }
+
+    r->win.block = MKV_WINDOW;
+    if (!Mkv_Header(r, end, r->win.end, seg) || seg->id != MKV_ID_SEGMENT) return FALSE;
+    s_stats.files++;
+    return TRUE;
+}
+
+/**
+ * @brief Take the Attachments and SeekHead positions from a SeekHead
+ * @brief Взять позиции Attachments и SeekHead из SeekHead
+ *
+ * Positions in a SeekHead are relative to the Segment data.
+ * Позиции в SeekHead отсчитываются от данных Segment.
+ *
+ * @param more [out,opt] Position of a further SeekHead / Позиция следующего SeekHead
+ */
+static void Mkv_ParseSeekHead(MkvReader* r, const MkvElem* sh, const MkvElem* seg, U64* att, U64* more)
+{
+    // The whole SeekHead comes in one read, its entries then from the window
+    // Весь SeekHead приходит одним чтением, его записи затем из окна
+    U64 end = sh->data + ((sh->size < MKV_MAX_SEEKHEAD) ? sh->size : MKV_MAX_SEEKHEAD);
+    if (!FileWindow_View(&r->win, sh->data, (DWORD)(end - sh->data))) return;
+
+    MkvElem s, c;
+    for (U64 pos = sh->data; pos < end && Mkv_Header(r, pos, end, &s); pos = s.data + s.size) {
+        if (s.id != MKV_ID_SEEK) continue;
+        U64 id = 0, at = 0;
+        BOOL hasAt = FALSE;
+        U64 send = s.data + s.size;
+        for (U64 q = s.data; q < send && Mkv_Header(r, q, send, &c); q = c.data + c.size) {
+            if (c.id == MKV_ID_SEEKID) Mkv_Uint(r, &c, &id);
+            else if (c.id == MKV_ID_SEEKPOS) hasAt = Mkv_Uint(r, &c, &at);
+        }
+        if (!hasAt || at >= seg->size) continue;
+        if (id == MKV_ID_ATTACHMENTS && !*att) *att = seg->data + at;
+        else if (id == MKV_ID_SEEKHEAD && more && !*more && seg->data + at != sh->off) *more = seg->data + at;
+    }
+}
+
+/**
+ * @brief Find the Attachments element without crossing Clusters
+ * @brief Найти элемент Attachments, не проходя через Cluster'ы
+ */
+static BOOL Mkv_FindAttachments(MkvReader* r, MkvElem* att)
+{
+    MkvElem seg, e;
+    if (!Mkv_Segment(r, &seg)) return FALSE;
+    U64 end = seg.data + seg.size;
+
+    U64 at = 0, more = 0;
+    U64 pos = seg.data;
+    for (int i = 0; i < MKV_MAX_TOP && pos < end && Mkv_Header(r, pos, end, &e); ++i) {
+        if (e.id == MKV_ID_ATTACHMENTS) {
+            *att = e;
+            return TRUE;
+        }
+        if (e.id == MKV_ID_CLUSTER) break;
+        if (e.id == MKV_ID_SEEKHEAD) {
+            Mkv_ParseSeekHead(r, &e, &seg, &at, &more);
+            if (at || more) break;
+        }
+        pos = e.data + e.size;
+    }
+
+    // A SeekHead that lists no Attachments may point to a second one, usually at the end
+    // SeekHead без Attachments может указывать на второй, обычно в конце
+    if (!at && more) {
+        s_stats.seeks++;
+        if (Mkv_Header(r, more, end, &e) && e.id == MKV_ID_SEEKHEAD) Mkv_ParseSeekHead(r, &e, &seg, &at, NULL);
+    }
+    if (!at) return FALSE;
+    s_stats.seeks++;
+    return Mkv_Header(r, at, end, att) && att->id == MKV_ID_ATTACHMENTS;
+}
+
+/**
+ * @brief Picture type from the attachment name, 0xFF if not an image
+ * @brief Тип изображения по имени вложения, 0xFF если не изображение
+ */
+static BYTE Mkv_PictureType(const char* name, const char* mime)
+{
+    if (Mkv_StartsWith(name, "cover.") || Mkv_StartsWith(name, "cover_land.")) return PIC_TYPE_FRONT;
+    if (Mkv_StartsWith(name, "small_cover")) return 2;   // "other file icon": last resort / последний вариант
+    return Mkv_StartsWith(mime, "image/") ? PIC_TYPE_OTHER : 0xFF;
+}
+
+/**
+ * @brief Describe the image attachments: name, MIME and data position only
+ * @brief Описать вложенные изображения: только имя, MIME и позицию данных
+ */
+static int Mkv_Collect(MkvReader* r)
+{
+    MkvElem att, af, c;
+    if (!Mkv_FindAttachments(r, &att)) return 0;
+
+    U64 end = att.data + att.size;
+    U64 pos = att.data;
+    for (int i = 0; i < MKV_MAX_FILES && pos < end && Mkv_Header(r, pos, end, &af); ++i, pos = af.data + af.size) {
+        if (af.id != MKV_ID_ATTACHEDFILE) continue;
+
+        char name[MKV_MAX_NAME] = "", mime[MKV_MAX_NAME] = "";
+        U64 data = 0, size = 0;
+        U64 fend = af.data + af.size;
+        for (U64 q = af.data; q < fend && Mkv_Header(r, q, fend, &c); q = c.data + c.size) {
+            if (c.id == MKV_ID_FILENAME)      Mkv_String(r, &c, name, sizeof(name));
+            else if (c.id == MKV_ID_FILEMIME) Mkv_String(r, &c, mime, sizeof(mime));
+            else if (c.id == MKV_ID_FILEDATA) { data = c.data; size = c.size; }
+        }
+
+        BYTE type = Mkv_PictureType(name, mime);
+        if (type == 0xFF || !size || size > MKV_MAX_PICTURE || r->count >= MKV_MAX_PICTURES) continue;
+        MkvPicture* pic = &r->pics[r->count++];
+        ZeroMemory(pic, sizeof(*pic));
+        pic->pos       = data;
+        pic->len       = (DWORD)size;
+        pic->cand.type = type;
+        pic->cand.tie  = (Mkv_StartsWith(name, "cover_land.") || Mkv_StartsWith(name, "small_cover_land.")) ? 1 : 0;
+        s_stats.attachments++;
+    }
+    return r->count;
+}
+
+// ============================================================================
+// Main Function / Главная функция
+// ============================================================================
+
+BOOL MKV_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz)
+{
+    if (!audioPath || !*audioPath) return FALSE;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return FALSE;
+
+    MkvReader r;
+    if (!Mkv_Open(&r, f, audioPath)) return FALSE;
+    int n = Mkv_Collect(&r);
+    FileWindow_Free(&r.win);
+
+    // Only the chosen attachment is read; the next best only if it fails to decode
+    // Читается только выбранное вложение; следующее - только при ошибке декодирования
+    BOOL ok = FALSE;
+    for (int best = PicIndex_Best(r.pics, n, sizeof(r.pics[0])); best >= 0 && !ok;
+         best = PicIndex_Best(r.pics, n, sizeof(r.pics[0]))) {
+        MkvPicture* pic = &r.pics[best];
+        BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, pic->len);
+        if (!buf) break;
+        if (FileWindow_ReadAt(&r.win, pic->pos, buf, pic->len)) {
+            s_stats.decodes++;
+            ok = Img_LoadFromMemoryToBitmap(buf, pic->len, phbm, psz);
+        }
+        GlobalFree(buf);
+        pic->cand.failed = !ok;
+    }
+    return ok;
+}
+
+int MKV_IndexPicturesA(const char* audioPath, PictureIndex* idx)
+{
+    if (!idx || !audioPath || !*audioPath) return 0;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return 0;
+
+    MkvReader r;
+    if (!Mkv_Open(&r, f, audioPath)) return 0;
+    int n = Mkv_Collect(&r);
+    FileWindow_Free(&r.win);
+
+    int added = 0;
+    for (int i = 0; i < n; ++i) {
+        if (PicIndex_Add(idx, r.pics[i].pos, r.pics[i].len, r.pics[i].cand.type, PIC_SRC_MKV)) ++added;
+    }
+    return added;
+}
+
+void MKV_GetStats(MKVStats* out)
+{
+    if (out) *out = s_stats;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file mkv_reader.h
+ * @brief Matroska/WebM attached cover art extractor
+ * @brief Экстрактор вложенных обложек Matroska/WebM
+ *
+ * Matroska keeps cover art as attached files in the Attachments element of
+ * the Segment. By convention they are named "cover.jpg" / "cover.png", with
+ * "cover_land.*", "small_cover.*" and "small_cover_land.*" as variants.
+ * Matroska хранит обложку как вложенные файлы в элементе Attachments
+ * сегмента. По соглашению они называются "cover.jpg" / "cover.png", с
+ * вариантами "cover_land.*", "small_cover.*" и "small_cover_land.*".
+ *
+ * Reading / Чтение:
+ * Only the EBML header, the Segment header and the SeekHead are parsed. The
+ * SeekHead gives the position of Attachments, which is reached by one jump
+ * however many Clusters lie before it; a second SeekHead (written at the end
+ * by some muxers) is followed once. Without a SeekHead the top level is
+ * walked by element headers, stopping at the first Cluster. Inside
+ * Attachments only the name, MIME type and data position of each attached
+ * file are read; the data of the chosen cover is the only payload read.
+ * Разбираются только заголовок EBML, заголовок Segment и SeekHead. SeekHead
+ * даёт позицию Attachments, до которого добираемся одним прыжком, сколько бы
+ * Cluster'ов ни было перед ним; второй SeekHead (некоторые муксеры пишут его
+ * в конец) проходится один раз. Без SeekHead верхний уровень обходится по
+ * заголовкам элементов до первого Cluster'а. Внутри Attachments читаются
+ * только имя, MIME-тип и позиция данных каждого вложения; данные выбранной
+ * обложки - единственная читаемая полезная нагрузка.
+ *
+ * Supported Containers / Поддерживаемые контейнеры:
+ * - .mka, .mkv, .webm
+ * - Any name: files are recognised by the EBML header
+ *   Любое имя: файлы распознаются по заголовку EBML
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+#include "picture_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reader statistics / Статистика ридера
+ */
+typedef struct {
+    DWORD files;       ///< Matroska files recognised / Распознано файлов Matroska
+    DWORD reads;       ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;   ///< Bytes read / Прочитано байт
+    DWORD elements;    ///< Element headers parsed / Разобрано заголовков элементов
+    DWORD seeks;       ///< Jumps taken from a SeekHead / Прыжков по SeekHead
+    DWORD attachments; ///< Image attachments described / Описано вложенных изображений
+    DWORD decodes;     ///< Pictures handed to the decoder / Изображений передано декодеру
+} MKVStats;
+
+/**
+ * @brief Load the cover attachment of a Matroska file
+ * @brief Загрузить вложенную обложку файла Matroska
+ *
+ * @param audioPath Path to MKA/MKV/WebM file / Путь к файлу MKA/MKV/WebM
+ * @param phbm [out] Result bitmap, owned by the caller / Результирующий bitmap, принадлежит вызывающему
+ * @param psz  [out] Result dimensions / Результирующие размеры
+ * @return TRUE on success / TRUE при успехе
+ */
+BOOL MKV_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz);
+
+/**
+ * @brief Index every image attachment without reading its data
+ * @brief Проиндексировать все вложенные изображения, не читая их данные
+ *
+ * @param audioPath Path to MKA/MKV/WebM file / Путь к файлу MKA/MKV/WebM
+ * @param idx [in,out] Index to append to / Индекс для дополнения
+ * @return Number of pictures added / Количество добавленных изображений
+ */
+int MKV_IndexPicturesA(const char* audioPath, PictureIndex* idx);
+
+/**
+ * @brief Copy reader statistics / Скопировать статистику ридера
+ */
+void MKV_GetStats(MKVStats* out);
+
+#ifdef __cplusplus
+}
+#endif
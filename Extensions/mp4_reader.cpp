@@ -23,6 +23,7 @@
 #include "..\image_loader.h"
 #include "..\utils_common.h"
 #include <shlwapi.h>
+#include <process.h>
 #pragma comment(lib, "shlwapi.lib")
 
 // ============================================================================
@@ -39,6 +40,11 @@ typedef unsigned __int64 U64;  ///< 64-bit unsigned integer for file offsets
  * @brief Check if file has a valid MP4-related extension
  * @brief Проверка валидности расширения MP4-файла
  * 
+ * Only consulted for QuickTime files older than the 'ftyp' box; everything
+ * else is recognised by its brand (Mp4_IsMp4).
+ * Используется только для файлов QuickTime, которые старше box'а 'ftyp';
+ * всё остальное распознаётся по бренду (Mp4_IsMp4).
+ * 
  * @param path File path to check / Путь к файлу для проверки
  * @return TRUE if extension is .m4a, .m4b, .mp4, .m4v, or .mov
  * @return TRUE если расширение .m4a, .m4b, .mp4, .m4v или .mov
@@ -52,158 +58,699 @@ static BOOL HasMp4Ext(const char* path) {
            lstrcmpiA(ext, ".mov") == 0;
 }
 
+// ============================================================================
+// Box Reader / Чтение box'ов
+// ============================================================================
+
+/// FourCC as a constant expression, for the static box paths
+/// FourCC в виде константного выражения, для статических путей box'ов
+#define MP4_FCC(a, b, c, d) (((DWORD)(BYTE)(a) << 24) | ((DWORD)(BYTE)(b) << 16) | \
+                             ((DWORD)(BYTE)(c) << 8)  |  (DWORD)(BYTE)(d))
+
+#define MP4_WINDOW    (16 * 1024)            ///< Box headers are read in blocks of this size / Заголовки box'ов читаются блоками такого размера
+#define MP4_SNIFF     64                     ///< First read of a file not named as MP4 / Первое чтение файла, не названного как MP4
+#define MP4_TAIL      (256 * 1024)           ///< Tails and boxes up to this size are read whole / Хвосты и box'ы до этого размера читаются целиком
+#define MP4_MAX_IMAGE (32 * 1024 * 1024)     ///< Largest cover image / Наибольшее изображение обложки
+#define MP4_MAX_BRANDS 64                    ///< Brands of 'ftyp' looked at / Просматриваемых брендов 'ftyp'
+
+static MP4Stats s_stats = {0};
+
+/**
+ * @brief Header of one box / Заголовок одного box'а
+ */
+typedef struct {
+    U64   off;       ///< Box start / Начало box'а
+    U64   size;      ///< Whole box, header included / Весь box с заголовком
+    U64   payload;   ///< First byte after the (32- or 64-bit) header / Первый байт после (32- или 64-битного) заголовка
+    DWORD type;
+} Mp4Box;
+
+/**
+ * @brief Attach the box walk window to the file
+ * @brief Привязать окно обхода box'ов к файлу
+ *
+ * Sibling headers usually sit in the same block, so a level of the tree costs
+ * one read; a large box (mdat, a big trak) is jumped over, not read. Within
+ * MP4_TAIL of the end the block runs to the end of the file, so a 'moov'
+ * written after 'mdat' comes in with the read that finds its header.
+ * Заголовки соседних box'ов обычно лежат в одном блоке, поэтому уровень дерева
+ * стоит одного чтения; большой box (mdat, большой trak) перепрыгивается, а не
+ * читается. В пределах MP4_TAIL от конца блок идёт до конца файла, поэтому
+ * 'moov', записанный после 'mdat', приходит тем же чтением, что находит его заголовок.
+ */
+static BOOL Mp4_Open(FileWindow* r, FileHandle& f)
+{
+    FileWindow_Init(r, f, MP4_WINDOW, &s_stats.reads, &s_stats.bytesRead);
+    r->tail = MP4_TAIL;
+    return r->end >= 16;
+}
+
 /**
- * @brief Read and parse an MP4 box header
- * @brief Чтение и парсинг заголовка MP4 box'а
+ * @brief Parse the box header at @p off
+ * @brief Разобрать заголовок box'а по смещению @p off
  * 
  * MP4 boxes have the following structure:
  * - 4 bytes: size (big-endian)
  * - 4 bytes: type (FourCC)
  * - If size == 1: additional 8 bytes for extended size
- * - If size == 0: box extends to end of file
+ * - If size == 0: box extends to end of file (or of the parent)
  * 
  * Структура MP4 box'ов:
  * - 4 байта: размер (big-endian)
  * - 4 байта: тип (FourCC)
  * - Если size == 1: дополнительные 8 байт для расширенного размера
- * - Если size == 0: box занимает весь файл до конца
- * 
- * @param f File handle / Дескриптор файла
- * @param off Offset to box start / Смещение начала box'а
- * @param limit Maximum file position / Максимальная позиция в файле
- * @param outSize [out] Total box size including header / Полный размер box'а с заголовком
- * @param outType [out] Box type (FourCC) / Тип box'а (FourCC)
- * @param outPayloadOff [out] Offset to payload data / Смещение данных payload
- * @return TRUE on success / TRUE при успехе
+ * - Если size == 0: box занимает всё до конца файла (или родителя)
+ *
+ * @param limit End of the parent / Конец родителя
  */
-static BOOL ReadBoxHeader(FileHandle& f, U64 off, U64 limit, U64* outSize, DWORD* outType, U64* outPayloadOff) {
-    BYTE hdr[8];
-    
-    // Validate we can read minimum header (8 bytes)
-    // Проверяем возможность чтения минимального заголовка (8 байт)
+static BOOL Mp4_Header(FileWindow* r, U64 off, U64 limit, Mp4Box* b)
+{
     if (off + 8 > limit) return FALSE;
-    if (!f.ReadAt(off, hdr, 8)) return FALSE;
-
-    // Parse basic header: size (4 bytes) + type (4 bytes)
-    // Парсим базовый заголовок: размер (4 байта) + тип (4 байта)
-    U64 size = (U64)BE32(hdr);        // Big-endian 32-bit size
-    DWORD type = BE32(hdr + 4);       // FourCC type identifier
-    U64 payload = off + 8;            // Default payload offset
+    DWORD need = (limit - off >= 16) ? 16 : 8;
+    const BYTE* p = FileWindow_View(r, off, need);
+    if (!p) return FALSE;
+    s_stats.boxes++;
 
-    // Handle extended size (size == 1 means 64-bit size follows)
-    // Обработка расширенного размера (size == 1 означает 64-битный размер)
+    U64 size = (U64)BE32(p);
+    b->type    = BE32(p + 4);
+    b->payload = off + 8;
     if (size == 1) {
-        BYTE ex[8];
-        if (off + 16 > limit) return FALSE;
-        if (!f.ReadAt(off + 8, ex, 8)) return FALSE;
-        size = BE64(ex);              // Read 64-bit extended size
-        payload = off + 16;           // Payload starts after extended header
-    } 
-    // Handle "to end of file" marker (size == 0)
-    // Обработка маркера "до конца файла" (size == 0)
-    else if (size == 0) {
+        if (need < 16) return FALSE;
+        size = BE64(p + 8);
+        b->payload = off + 16;
+    } else if (size == 0) {
         size = limit - off;
     }
+    if (size < b->payload - off || size > limit - off) return FALSE;
+    b->off  = off;
+    b->size = size;
+    return TRUE;
+}
 
-    // Validate box size integrity
-    // Проверка целостности размера box'а
-    if (size < (payload - off)) return FALSE;  // Size can't be less than header
-    if (off + size > limit) return FALSE;      // Box can't exceed file bounds
+/**
+ * @brief Where the children of a container box start
+ * @brief Где начинаются потомки контейнерного box'а
+ *
+ * Full boxes carry version/flags (and 'stsd' an entry count) before their
+ * children. 'meta' is a full box in ISO files but a plain one in QuickTime,
+ * so the first child header tells which.
+ * Full box'ы несут версию/флаги (а 'stsd' ещё и число записей) перед потомками.
+ * 'meta' - full box в файлах ISO, но обычный в QuickTime, поэтому это определяется
+ * по заголовку первого потомка.
+ */
+static U64 Mp4_ChildStart(FileWindow* r, const Mp4Box* b)
+{
+    U64 at = b->payload;
+    switch (b->type) {
+    case MP4_FCC('m', 'e', 't', 'a'): {
+        const BYTE* p = FileWindow_View(r, at, 8);
+        if (p && BE32(p + 4) == MP4_FCC('h', 'd', 'l', 'r')) return at;   // QuickTime
+        return at + 4;
+    }
+    case MP4_FCC('s', 't', 's', 'd'):
+        return at + 8;
+    default:
+        return at;
+    }
+}
 
-    // Return parsed values
-    // Возврат распарсенных значений
-    if (outSize) *outSize = size;
-    if (outType) *outType = type;
-    if (outPayloadOff) *outPayloadOff = payload;
+/**
+ * @brief First box of type @p type among the siblings in [start, limit)
+ * @brief Первый box типа @p type среди соседей в [start, limit)
+ */
+static BOOL Mp4_Find(FileWindow* r, U64 start, U64 limit, DWORD type, Mp4Box* out)
+{
+    for (U64 pos = start; pos + 8 <= limit; pos += out->size) {
+        if (!Mp4_Header(r, pos, limit, out)) return FALSE;
+        if (out->type == type) return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Follow a box path, e.g. moov/udta/meta/ilst/covr
+ * @brief Пройти путь box'ов, например moov/udta/meta/ilst/covr
+ *
+ * A box of the path small enough is read whole when found, so its subtree
+ * costs no further reads.
+ * Достаточно маленький box пути читается целиком при нахождении, поэтому его
+ * поддерево не стоит дальнейших чтений.
+ *
+ * @param from Box the path starts in, NULL = top level / Box, в котором начинается путь, NULL = верхний уровень
+ * @param path FourCCs from the outer box inward, 0-terminated / FourCC от внешнего box'а внутрь, с 0 в конце
+ * @param out  [out] Last box of the path / Последний box пути
+ */
+static BOOL Mp4_Query(FileWindow* r, const Mp4Box* from, const DWORD* path, Mp4Box* out)
+{
+    U64 start = from ? Mp4_ChildStart(r, from) : 0;
+    U64 limit = from ? from->off + from->size : r->end;
+    for (; *path; ++path) {
+        if (!Mp4_Find(r, start, limit, *path, out)) return FALSE;
+        if (out->size <= MP4_TAIL) FileWindow_View(r, out->off, (DWORD)out->size);
+        start = Mp4_ChildStart(r, out);
+        limit = out->off + out->size;
+        if (start > limit) return FALSE;
+    }
     return TRUE;
 }
 
+/// iTunes cover art: under moov/udta/meta, or directly under moov/meta
+/// Обложка iTunes: в moov/udta/meta или прямо в moov/meta
+static const DWORD kPathCovr[] = {
+    MP4_FCC('m','o','o','v'), MP4_FCC('u','d','t','a'), MP4_FCC('m','e','t','a'),
+    MP4_FCC('i','l','s','t'), MP4_FCC('c','o','v','r'), 0
+};
+static const DWORD kPathMetaCovr[] = {
+    MP4_FCC('m','o','o','v'), MP4_FCC('m','e','t','a'), MP4_FCC('i','l','s','t'),
+    MP4_FCC('c','o','v','r'), 0
+};
+
+/// ISO/QuickTime audio and video brands; HEIF, AVIF, CR3 and other 'ftyp' users are not covers
+/// Бренды аудио и видео ISO/QuickTime; HEIF, AVIF, CR3 и прочие пользователи 'ftyp' - не обложки
+static const struct { DWORD brand, mask; } kBrands[] = {
+    { MP4_FCC('M','4', 0 , 0 ), 0xFFFF0000 },   // M4A, M4B, M4P, M4V (iTunes)
+    { MP4_FCC('m','p','4', 0 ), 0xFFFFFF00 },   // mp41, mp42, mp71
+    { MP4_FCC('i','s','o', 0 ), 0xFFFFFF00 },   // isom, iso2..iso9
+    { MP4_FCC('3','g', 0 , 0 ), 0xFFFF0000 },   // 3gp*, 3g2*
+    { MP4_FCC('f','4', 0 , 0 ), 0xFFFF0000 },   // f4v, f4a, f4b (Flash)
+    { MP4_FCC('q','t',' ',' '), 0xFFFFFFFF },
+    { MP4_FCC('a','v','c','1'), 0xFFFFFFFF },
+    { MP4_FCC('d','a','s','h'), 0xFFFFFFFF },
+    { MP4_FCC('M','S','N','V'), 0xFFFFFFFF },   // Sony PSP
+    { MP4_FCC('m','m','p','4'), 0xFFFFFFFF },
+};
+
+// Whether the first box @p b names a known brand
+// Называет ли первый box @p b известный бренд
+static BOOL Mp4_HasBrand(FileWindow* r, const Mp4Box* b, const char* path)
+{
+    switch (b->type) {
+    case MP4_FCC('f', 't', 'y', 'p'):
+        break;
+    case MP4_FCC('m', 'o', 'o', 'v'): case MP4_FCC('m', 'd', 'a', 't'):
+    case MP4_FCC('w', 'i', 'd', 'e'): case MP4_FCC('f', 'r', 'e', 'e'):
+    case MP4_FCC('s', 'k', 'i', 'p'):
+        return HasMp4Ext(path);
+    default:
+        return FALSE;
+    }
+
+    // Major brand, minor version, compatible brands
+    // Основной бренд, младшая версия, совместимые бренды
+    U64 cb = b->off + b->size - b->payload;
+    if (cb < 4) return FALSE;
+    if (cb > 8 + 4 * MP4_MAX_BRANDS) cb = 8 + 4 * MP4_MAX_BRANDS;
+    const BYTE* p = FileWindow_View(r, b->payload, (DWORD)cb);
+    if (!p) return FALSE;
+
+    for (DWORD i = 0; i + 4 <= (DWORD)cb; i += (i ? 4 : 8)) {
+        DWORD brand = BE32(p + i);
+        for (int k = 0; k < (int)(sizeof(kBrands) / sizeof(kBrands[0])); k++) {
+            if ((brand & kBrands[k].mask) == kBrands[k].brand) return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 /**
- * @brief Find the first occurrence of a box with specified FourCC
- * @brief Поиск первого вхождения box'а с указанным FourCC
- * 
- * Sequentially scans boxes in the specified range until finding
- * a box matching the requested FourCC type.
- * 
- * Последовательно сканирует box'ы в указанном диапазоне до нахождения
- * box'а с запрошенным типом FourCC.
- * 
- * @param f File handle / Дескриптор файла
- * @param start Start offset for search / Начальное смещение для поиска
- * @param limit End boundary for search / Конечная граница поиска
- * @param fourcc Target box type (FourCC) / Искомый тип box'а (FourCC)
- * @param outOff [out] Offset where box was found / Смещение найденного box'а
- * @param outSize [out] Size of found box / Размер найденного box'а
- * @return TRUE if box found / TRUE если box найден
+ * @brief Recognise an MP4 file by its content rather than its extension
+ * @brief Распознать файл MP4 по содержимому, а не по расширению
+ *
+ * The first box must be 'ftyp' with a known major or compatible brand; old
+ * QuickTime files without 'ftyp' fall back to the extension. For an MP4 name
+ * the bytes come from the first block, which the box walk needs anyway; any
+ * other file is sniffed with a small read first.
+ * Первый box должен быть 'ftyp' с известным основным или совместимым брендом;
+ * для старых файлов QuickTime без 'ftyp' проверяется расширение. Для имени MP4
+ * байты берутся из первого блока, который всё равно нужен обходу box'ов; любой
+ * другой файл сначала проверяется маленьким чтением.
  */
-static BOOL FindFirstBox(FileHandle& f, U64 start, U64 limit, DWORD fourcc, U64* outOff, U64* outSize) {
-    U64 pos = start;
-    
-    // Iterate through all boxes in range
-    // Итерация по всем box'ам в диапазоне
-    while (pos + 8 <= limit) {
-        U64 size = 0, payload = 0;
-        DWORD type = 0;
-        
-        // Read current box header
-        // Чтение заголовка текущего box'а
-        if (!ReadBoxHeader(f, pos, limit, &size, &type, &payload)) return FALSE;
-        
-        // Check if this is the box we're looking for
-        // Проверка, является ли это искомым box'ом
-        if (type == fourcc) {
-            if (outOff) *outOff = pos;
-            if (outSize) *outSize = size;
-            return TRUE;
+static BOOL Mp4_IsMp4(FileWindow* r, const char* path)
+{
+    Mp4Box b;
+    if (!HasMp4Ext(path)) {
+        r->block = MP4_SNIFF;
+        r->tail  = 0;
+    }
+    BOOL ok = Mp4_Header(r, 0, r->end, &b) && Mp4_HasBrand(r, &b, path);
+    r->block = MP4_WINDOW;
+    r->tail  = MP4_TAIL;
+    return ok;
+}
+
+static BOOL Mp4_FindCovr(FileWindow* r, const char* path, Mp4Box* covr)
+{
+    if (!Mp4_IsMp4(r, path)) return FALSE;
+    return Mp4_Query(r, NULL, kPathCovr, covr) || Mp4_Query(r, NULL, kPathMetaCovr, covr);
+}
+
+#define MP4_MAX_PICTURES 16    ///< 'data' boxes of 'covr' considered / Рассматриваемых 'data' box'ов в 'covr'
+#define MP4_PROBE        1024  ///< Image bytes probed for format and size / Байт изображения для определения формата и размера
+
+/// Type indicators of a 'data' box / Индикаторы типа 'data' box'а
+#define MP4_DATA_IMPLICIT 0
+#define MP4_DATA_JPEG     13
+#define MP4_DATA_PNG      14
+#define MP4_DATA_BMP      27
+#define MP4_DATA_NONE     ((DWORD)-1)   ///< Not an image / Не изображение
+
+/**
+ * @brief One 'data' box of 'covr' / Один 'data' box в 'covr'
+ */
+typedef struct {
+    PictureCandidate cand;   ///< Type from the first bytes, tie from the type indicator / Тип по первым байтам, tie по индикатору типа
+    U64   pos;       ///< Image bytes / Байты изображения
+    DWORD len;
+} Mp4Picture;
+
+// Type indicator the first bytes call for: JPEG, PNG or BMP, implicit for GIF
+// Индикатор типа, которого требуют первые байты: JPEG, PNG или BMP, неявный для GIF
+static DWORD Mp4_ImageCode(const BYTE* p, DWORD cb)
+{
+    if (cb < 4) return MP4_DATA_NONE;
+    if (p[0] == 0xFF && p[1] == 0xD8) return MP4_DATA_JPEG;
+    if (p[0] == 0x89 && p[1] == 'P' && p[2] == 'N' && p[3] == 'G') return MP4_DATA_PNG;
+    if (p[0] == 'B' && p[1] == 'M') return MP4_DATA_BMP;
+    if (p[0] == 'G' && p[1] == 'I' && p[2] == 'F') return MP4_DATA_IMPLICIT;
+    return MP4_DATA_NONE;
+}
+
+/**
+ * @brief Describe every 'data' box of 'covr' without reading the whole images
+ * @brief Описать все 'data' box'ы в 'covr', не читая изображения целиком
+ *
+ * 'data' box structure: type indicator (4: 13 = JPEG, 14 = PNG, 27 = BMP),
+ * locale (4), image bytes. Boxes marked as text or numbers are skipped; the
+ * format and size of the others come from their first bytes, which are
+ * usually already held since 'covr' itself was read whole. 'covr' has no
+ * picture types: bytes the decoder recognises rank as front covers, the rest
+ * after them. Between equals the right format wins: a type indicator the
+ * bytes agree with, then untyped bytes, then an indicator they contradict.
+ * Структура 'data' box'а: индикатор типа (4: 13 = JPEG, 14 = PNG, 27 = BMP),
+ * локаль (4), байты изображения. Box'ы, помеченные как текст или числа,
+ * пропускаются; формат и размер остальных берутся из первых байт, которые
+ * обычно уже в памяти, так как 'covr' прочитан целиком. В 'covr' нет типов
+ * изображений: байты, которые распознаёт декодер, ранжируются как лицевые
+ * обложки, остальные - после них. Среди равных побеждает верный формат:
+ * индикатор типа, с которым согласны байты, затем нетипизированные байты,
+ * затем индикатор, которому байты противоречат.
+ *
+ * @return Number of pictures / Количество изображений
+ */
+static int Mp4_CollectPictures(FileWindow* r, const Mp4Box* covr, Mp4Picture* pics, int max)
+{
+    U64 limit = covr->off + covr->size;
+    U64 pos = Mp4_ChildStart(r, covr);
+    int n = 0;
+    Mp4Box d;
+    while (n < max && pos + 8 <= limit && Mp4_Header(r, pos, limit, &d)) {
+        pos += d.size;
+        U64 end = d.off + d.size;
+        if (d.type != MP4_FCC('d', 'a', 't', 'a') || d.payload + 8 >= end) continue;
+
+        U64 len = end - (d.payload + 8);
+        if (len >= MP4_MAX_IMAGE) continue;   // prevent memory exhaustion / защита памяти
+        const BYTE* p = FileWindow_View(r, d.payload, 8);
+        if (!p) break;
+        DWORD code = BE32(p) & 0x00FFFFFF;    // high byte: type set / старший байт: набор типов
+        if (code != MP4_DATA_IMPLICIT && code != MP4_DATA_JPEG &&
+            code != MP4_DATA_PNG && code != MP4_DATA_BMP) continue;
+
+        Mp4Picture* pic = &pics[n];
+        ZeroMemory(pic, sizeof(*pic));
+        pic->pos = d.payload + 8;
+        pic->len = (DWORD)len;
+
+        DWORD cb = (pic->len < MP4_PROBE) ? pic->len : MP4_PROBE;
+        const BYTE* img = FileWindow_View(r, pic->pos, cb);
+        DWORD fits = MP4_DATA_NONE;
+        if (img) {
+            fits = Mp4_ImageCode(img, cb);
+            if (!Img_ProbeSize(img, cb, &pic->cand.dim)) pic->cand.dim.cx = pic->cand.dim.cy = 0;
         }
-        
-        // Move to next box
-        // Переход к следующему box'у
-        pos += size;
+        // Untyped bytes must at least look like an image
+        // Нетипизированные байты должны хотя бы выглядеть как изображение
+        if (code == MP4_DATA_IMPLICIT && fits == MP4_DATA_NONE) continue;
+        pic->cand.type = (fits != MP4_DATA_NONE) ? PIC_TYPE_FRONT : PIC_TYPE_OTHER;
+        pic->cand.tie  = (code == fits) ? 0 : (code == MP4_DATA_IMPLICIT) ? 1 : 2;
+        ++n;
     }
-    
-    return FALSE;  // Box not found / Box не найден
+    s_stats.pictures += n;
+    return n;
+}
+
+// ============================================================================
+// Chapter Images / Изображения глав
+// ============================================================================
+
+#define MP4_MAX_CHAPTERS 1024   ///< Chapter images indexed per file / Индексируемых изображений глав на файл
+#define MP4_MAX_CHAPREFS 8      ///< Chapter tracks referenced / Ссылок на треки глав
+#define MP4_MAX_TABLE    (16 + 12 * MP4_MAX_CHAPTERS)   ///< Sample table bytes used / Используемых байт таблицы сэмплов
+
+static const DWORD kPathMoov[] = { MP4_FCC('m','o','o','v'), 0 };
+static const DWORD kPathChap[] = { MP4_FCC('t','r','e','f'), MP4_FCC('c','h','a','p'), 0 };
+static const DWORD kPathTkhd[] = { MP4_FCC('t','k','h','d'), 0 };
+static const DWORD kPathHdlr[] = { MP4_FCC('m','d','i','a'), MP4_FCC('h','d','l','r'), 0 };
+static const DWORD kPathMdhd[] = { MP4_FCC('m','d','i','a'), MP4_FCC('m','d','h','d'), 0 };
+static const DWORD kPathStbl[] = { MP4_FCC('m','d','i','a'), MP4_FCC('m','i','n','f'), MP4_FCC('s','t','b','l'), 0 };
+
+// Chapter image index of the last file asked for / Индекс изображений глав последнего запрошенного файла
+static struct {
+    BOOL             valid;
+    char             path[MAX_PATH];
+    U64              size;
+    FILETIME         time;
+    int              count;
+    MP4ChapterImage* items;
+} s_chap = {0};
+
+/**
+ * @brief Copy of a sample table of 'stbl' (full box: version/flags first)
+ * @brief Копия таблицы сэмплов из 'stbl' (full box: сначала версия/флаги)
+ *
+ * Tables beyond MP4_MAX_TABLE are cut; their entry counts are clamped by the caller.
+ * Таблицы больше MP4_MAX_TABLE обрезаются; число записей ограничивает вызывающий.
+ *
+ * @param len [out] Bytes copied / Скопировано байт
+ * @return Buffer to GlobalFree, or NULL / Буфер для GlobalFree, или NULL
+ */
+static BYTE* Mp4_CopyTable(FileWindow* r, const Mp4Box* stbl, DWORD type, DWORD* len)
+{
+    Mp4Box b;
+    if (!Mp4_Find(r, stbl->payload, stbl->off + stbl->size, type, &b)) return NULL;
+    U64 cb = b.off + b.size - b.payload;
+    if (cb < 8) return NULL;
+    if (cb > MP4_MAX_TABLE) cb = MP4_MAX_TABLE;
+
+    const BYTE* p = FileWindow_View(r, b.payload, (DWORD)cb);
+    BYTE* copy = p ? (BYTE*)GlobalAlloc(GMEM_FIXED, (DWORD)cb) : NULL;
+    if (copy) CopyMemory(copy, p, (DWORD)cb);
+    *len = (DWORD)cb;
+    return copy;
+}
+
+// Entries a table declares, clamped to what was copied
+// Объявленное таблицей число записей, ограниченное скопированным
+static DWORD Mp4_Entries(const BYTE* t, DWORD len, DWORD head, DWORD entry)
+{
+    DWORD n = BE32(t + 4);
+    DWORD fit = (len > head) ? (len - head) / entry : 0;
+    return (n < fit) ? n : fit;
 }
 
 /**
- * @brief Find a child box within a parent box
- * @brief Поиск дочернего box'а внутри родительского
- * 
- * Searches for a child box within the payload of a parent box.
- * Special handling for 'meta' boxes which have 4 bytes of version/flags
- * before the child boxes begin.
- * 
- * Ищет дочерний box внутри payload родительского box'а.
- * Специальная обработка для 'meta' box'ов, у которых есть 4 байта
- * версии/флагов перед началом дочерних box'ов.
- * 
- * @param f File handle / Дескриптор файла
- * @param parentOff Parent box offset / Смещение родительского box'а
- * @param parentSize Parent box size / Размер родительского box'а
- * @param childFCC Child box FourCC to find / FourCC искомого дочернего box'а
- * @param outOff [out] Offset of found child box / Смещение найденного дочернего box'а
- * @param outSize [out] Size of found child box / Размер найденного дочернего box'а
- * @return TRUE if child box found / TRUE если дочерний box найден
+ * @brief Time and file range of every sample of a track
+ * @brief Время и диапазон в файле каждого сэмпла трека
+ *
+ * stsz gives the sizes, stts the durations (in @p timescale units), stsc
+ * the samples per chunk and stco/co64 the chunk offsets; samples of a chunk
+ * are stored back to back. Edit lists are not applied.
+ * stsz даёт размеры, stts - длительности (в единицах @p timescale), stsc -
+ * сэмплы на чанк, stco/co64 - смещения чанков; сэмплы чанка лежат подряд.
+ * Списки правок не применяются.
+ *
+ * @return Number of samples in @p out (GlobalFree) / Количество сэмплов в @p out (GlobalFree)
  */
-static BOOL FindChildBox(FileHandle& f, U64 parentOff, U64 parentSize, DWORD childFCC, U64* outOff, U64* outSize) {
-    U64 pLimit = parentOff + parentSize;
-    U64 payload = 0, tmp = 0; 
-    DWORD pType = 0;
-
-    // Read parent box header to get payload offset
-    // Чтение заголовка родительского box'а для получения смещения payload
-    if (!ReadBoxHeader(f, parentOff, pLimit, &tmp, &pType, &payload)) return FALSE;
-
-    // Special case: 'meta' box has 4 bytes (version + flags) before children
-    // Специальный случай: 'meta' box имеет 4 байта (версия + флаги) перед потомками
-    if (pType == FCC('m', 'e', 't', 'a')) {
-        if (payload + 4 > pLimit) return FALSE;
-        payload += 4;  // Skip version (1 byte) + flags (3 bytes)
+static int Mp4_SampleTable(FileWindow* r, const Mp4Box* stbl, DWORD timescale, MP4ChapterImage** out)
+{
+    DWORD cbSz = 0, cbTs = 0, cbSc = 0, cbCo = 0;
+    BOOL  co64 = FALSE;
+    BYTE* stsz = Mp4_CopyTable(r, stbl, MP4_FCC('s','t','s','z'), &cbSz);
+    BYTE* stts = Mp4_CopyTable(r, stbl, MP4_FCC('s','t','t','s'), &cbTs);
+    BYTE* stsc = Mp4_CopyTable(r, stbl, MP4_FCC('s','t','s','c'), &cbSc);
+    BYTE* stco = Mp4_CopyTable(r, stbl, MP4_FCC('s','t','c','o'), &cbCo);
+    if (!stco) {
+        stco = Mp4_CopyTable(r, stbl, MP4_FCC('c','o','6','4'), &cbCo);
+        co64 = TRUE;
     }
-    
-    // Search for child box in parent's payload
-    // Поиск дочернего box'а в payload родителя
-    return FindFirstBox(f, payload, pLimit, childFCC, outOff, outSize);
+
+    MP4ChapterImage* items = NULL;
+    DWORD n = 0;
+    if (stsz && stts && stsc && stco && cbSz >= 12) {
+        DWORD fixed = BE32(stsz + 4);
+        n = BE32(stsz + 8);
+        if (!fixed && n > (cbSz - 12) / 4) n = (cbSz - 12) / 4;
+        if (n > MP4_MAX_CHAPTERS) n = MP4_MAX_CHAPTERS;
+        items = n ? (MP4ChapterImage*)GlobalAlloc(GPTR, n * sizeof(MP4ChapterImage)) : NULL;
+    }
+
+    if (items) {
+        DWORD fixed = BE32(stsz + 4), i, e;
+        for (i = 0; i < n; ++i) items[i].length = fixed ? fixed : BE32(stsz + 12 + 4 * i);
+
+        // Start times / Времена начала
+        U64 t = 0;
+        DWORD nt = Mp4_Entries(stts, cbTs, 8, 8);
+        for (i = 0, e = 0; e < nt && i < n; ++e) {
+            DWORD cnt = BE32(stts + 8 + 8 * e), delta = BE32(stts + 12 + 8 * e);
+            for (DWORD k = 0; k < cnt && i < n; ++k, ++i, t += delta) {
+                items[i].startMs = (DWORD)(t * 1000 / timescale);
+            }
+        }
+        if (i < n) n = i;
+
+        // Offsets: chunk by chunk / Смещения: чанк за чанком
+        DWORD nc = Mp4_Entries(stco, cbCo, 8, co64 ? 8 : 4);
+        DWORD ns = Mp4_Entries(stsc, cbSc, 8, 12);
+        for (i = 0, e = 0; e < ns && i < n; ++e) {
+            DWORD first = BE32(stsc + 8 + 12 * e), per = BE32(stsc + 12 + 12 * e);
+            DWORD last  = (e + 1 < ns) ? BE32(stsc + 20 + 12 * e) - 1 : nc;
+            for (DWORD c = first; c >= 1 && c <= last && c <= nc && i < n; ++c) {
+                U64 off = co64 ? BE64(stco + 8 + 8 * (c - 1)) : (U64)BE32(stco + 8 + 4 * (c - 1));
+                for (DWORD k = 0; k < per && i < n; ++k, ++i) {
+                    items[i].offset = off;
+                    off += items[i].length;
+                }
+            }
+        }
+        if (i < n) n = i;
+    }
+
+    if (stsz) GlobalFree(stsz);
+    if (stts) GlobalFree(stts);
+    if (stsc) GlobalFree(stsc);
+    if (stco) GlobalFree(stco);
+    if (items && !n) { GlobalFree(items); items = NULL; }
+    *out = items;
+    return (int)n;
+}
+
+/**
+ * @brief Build the chapter image index: the video track a 'tref/chap' points to
+ * @brief Построить индекс изображений глав: видеотрек, на который указывает 'tref/chap'
+ *
+ * Audiobooks reference a text track (chapter titles) and, when chapters have
+ * artwork, a video track whose samples are JPEG/PNG images, one per chapter.
+ * Аудиокниги ссылаются на текстовый трек (названия глав) и, если у глав есть
+ * изображения, на видеотрек, сэмплы которого - изображения JPEG/PNG, по одному на главу.
+ */
+static int Mp4_BuildChapters(FileWindow* r, MP4ChapterImage** out)
+{
+    *out = NULL;
+    Mp4Box moov, trak, b;
+    if (!Mp4_Query(r, NULL, kPathMoov, &moov)) return 0;
+    U64 limit = moov.off + moov.size;
+
+    // Track IDs referenced as chapters / ID треков, на которые ссылаются как на главы
+    DWORD refs[MP4_MAX_CHAPREFS];
+    int nRefs = 0;
+    U64 pos;
+    for (pos = moov.payload; nRefs < MP4_MAX_CHAPREFS && Mp4_Find(r, pos, limit, MP4_FCC('t','r','a','k'), &trak);
+         pos = trak.off + trak.size) {
+        if (!Mp4_Query(r, &trak, kPathChap, &b)) continue;
+        // Only the first IDs are used, however large the box claims to be
+        // Используются только первые ID, каким бы большим ни объявлял себя box
+        U64 cb = b.off + b.size - b.payload;
+        if (cb > MP4_MAX_CHAPREFS * 4) cb = MP4_MAX_CHAPREFS * 4;
+        const BYTE* p = FileWindow_View(r, b.payload, (DWORD)cb);
+        for (DWORD i = 0; p && i + 4 <= cb && nRefs < MP4_MAX_CHAPREFS; i += 4) refs[nRefs++] = BE32(p + i);
+    }
+    if (!nRefs) return 0;
+
+    for (pos = moov.payload; Mp4_Find(r, pos, limit, MP4_FCC('t','r','a','k'), &trak); pos = trak.off + trak.size) {
+        // Track ID: tkhd v0 [vf 4][ctime 4][mtime 4][id 4], v1 has 8-byte times
+        // ID трека: tkhd v0 [vf 4][ctime 4][mtime 4][id 4], в v1 времена по 8 байт
+        const BYTE* p;
+        if (!Mp4_Query(r, &trak, kPathTkhd, &b) || !(p = FileWindow_View(r, b.payload, 24))) continue;
+        DWORD id = BE32(p + (p[0] == 1 ? 20 : 12));
+        int k;
+        for (k = 0; k < nRefs && refs[k] != id; ++k) {}
+        if (k == nRefs) continue;
+
+        // Handler 'vide' / Обработчик 'vide'
+        if (!Mp4_Query(r, &trak, kPathHdlr, &b) || !(p = FileWindow_View(r, b.payload, 12)) ||
+            BE32(p + 8) != MP4_FCC('v','i','d','e')) continue;
+
+        // Time scale: mdhd v0 [vf 4][ctime 4][mtime 4][scale 4], v1 has 8-byte times
+        // Масштаб времени: mdhd v0 [vf 4][ctime 4][mtime 4][scale 4], в v1 времена по 8 байт
+        if (!Mp4_Query(r, &trak, kPathMdhd, &b) || !(p = FileWindow_View(r, b.payload, 24))) continue;
+        DWORD timescale = BE32(p + (p[0] == 1 ? 20 : 12));
+        if (!timescale) continue;
+
+        Mp4Box stbl;
+        if (!Mp4_Query(r, &trak, kPathStbl, &stbl)) continue;
+        int n = Mp4_SampleTable(r, &stbl, timescale, out);
+        if (n) return n;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Chapter Prefetch / Упреждающее чтение глав
+// ============================================================================
+
+// One thread reads the image bytes of the chapter that plays next, so the
+// view's timer never waits for the file. There is one queued job (the latest
+// wins), one in flight and one finished read; the critical section guards
+// only these slots, never the read. Decoding stays with the caller: the
+// image loader keeps OLE and GDI+ state that threads do not share.
+// Один поток читает байты изображения главы, которая играет следующей, поэтому
+// таймер окна никогда не ждёт файл. Одно задание в очереди (побеждает последнее),
+// одно в работе и одно готовое чтение; критическая секция защищает только эти
+// слоты, но не само чтение. Декодирование остаётся у вызывающего: загрузчик
+// изображений держит состояние OLE и GDI+, которое потоки не разделяют.
+
+typedef struct {
+    char  path[MAX_PATH];
+    U64   offset;
+    DWORD length;     ///< 0 = empty slot / 0 = пустой слот
+    BYTE* data;       ///< Bytes read, NULL if the read failed / Прочитанные байты, NULL если чтение не удалось
+} Mp4Prefetch;
+
+static CRITICAL_SECTION s_preCs;
+static HANDLE        s_preThread = NULL;
+static HANDLE        s_preWake   = NULL;   // auto-reset: a job was queued / поставлено задание
+static HANDLE        s_preIdle   = NULL;   // manual-reset: nothing queued or in flight / ничего в очереди и в работе
+static volatile LONG s_preQuit   = 0;
+static Mp4Prefetch   s_preJob    = {0};    // queued / в очереди
+static Mp4Prefetch   s_preBusy   = {0};    // in flight (no data) / в работе (без данных)
+static Mp4Prefetch   s_preDone   = {0};    // finished / готово
+static DWORD         s_preReads  = 0;      // counted under s_preCs / считаются под s_preCs
+static DWORD         s_preBytes  = 0;
+
+static BOOL Mp4_PrefetchIs(const Mp4Prefetch* p, const char* path, const MP4ChapterImage* ch)
+{
+    return p->length && p->length == ch->length && p->offset == ch->offset &&
+           lstrcmpiA(p->path, path) == 0;
+}
+
+static unsigned __stdcall Mp4_PrefetchProc(void*)
+{
+    for (;;) {
+        WaitForSingleObject(s_preWake, INFINITE);
+        if (s_preQuit) break;
+
+        Mp4Prefetch job;
+        EnterCriticalSection(&s_preCs);
+        job       = s_preJob;
+        s_preBusy = s_preJob;
+        s_preJob.length = 0;
+        LeaveCriticalSection(&s_preCs);
+        if (!job.length) continue;
+
+        BOOL ok = FALSE;
+        job.data = (BYTE*)GlobalAlloc(GMEM_FIXED, job.length);
+        if (job.data) {
+            FileHandle f(job.path);
+            ok = f.IsValid() && f.ReadAt(job.offset, job.data, job.length);
+        }
+        if (!ok && job.data) {
+            GlobalFree(job.data);
+            job.data = NULL;
+        }
+
+        EnterCriticalSection(&s_preCs);
+        BYTE* stale = s_preDone.data;
+        s_preDone = job;
+        s_preBusy.length = 0;
+        if (ok) {
+            s_preReads++;
+            s_preBytes += job.length;
+        }
+        if (!s_preJob.length) SetEvent(s_preIdle);
+        LeaveCriticalSection(&s_preCs);
+        if (stale) GlobalFree(stale);
+    }
+    return 0;
+}
+
+static BOOL Mp4_PrefetchStart(void)
+{
+    if (s_preThread) return TRUE;
+
+    InitializeCriticalSection(&s_preCs);
+    s_preWake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    s_preIdle = CreateEventA(NULL, TRUE, TRUE, NULL);
+    s_preQuit = 0;
+
+    unsigned tid = 0;
+    if (s_preWake && s_preIdle) {
+        s_preThread = (HANDLE)_beginthreadex(NULL, 0, Mp4_PrefetchProc, NULL, 0, &tid);
+    }
+    if (!s_preThread) {
+        if (s_preWake) CloseHandle(s_preWake);
+        if (s_preIdle) CloseHandle(s_preIdle);
+        s_preWake = NULL;
+        s_preIdle = NULL;
+        DeleteCriticalSection(&s_preCs);
+        return FALSE;
+    }
+
+    // Reading ahead must not starve Winamp's decoder
+    // Упреждающее чтение не должно отнимать время у декодера Winamp
+    SetThreadPriority(s_preThread, THREAD_PRIORITY_BELOW_NORMAL);
+    return TRUE;
+}
+
+static void Mp4_PrefetchStop(void)
+{
+    if (!s_preThread) return;
+
+    InterlockedExchange(&s_preQuit, 1);
+    SetEvent(s_preWake);
+    WaitForSingleObject(s_preThread, INFINITE);
+    CloseHandle(s_preThread);
+    CloseHandle(s_preWake);
+    CloseHandle(s_preIdle);
+    s_preThread = NULL;
+    s_preWake   = NULL;
+    s_preIdle   = NULL;
+
+    if (s_preDone.data) GlobalFree(s_preDone.data);
+    ZeroMemory(&s_preJob,  sizeof(s_preJob));
+    ZeroMemory(&s_preBusy, sizeof(s_preBusy));
+    ZeroMemory(&s_preDone, sizeof(s_preDone));
+    DeleteCriticalSection(&s_preCs);
+}
+
+/**
+ * @brief Take the bytes of @p ch read ahead / Забрать заранее прочитанные байты @p ch
+ *
+ * A read of @p ch still queued or under way is waited for: that costs no
+ * more than reading here, and the file is read once.
+ * Чтение @p ch, ещё стоящее в очереди или идущее, ожидается: это стоит не
+ * больше, чем чтение здесь, и файл читается один раз.
+ *
+ * @return Buffer to GlobalFree, or NULL / Буфер для GlobalFree, или NULL
+ */
+static BYTE* Mp4_PrefetchTake(const char* path, const MP4ChapterImage* ch)
+{
+    if (!s_preThread) return NULL;
+
+    EnterCriticalSection(&s_preCs);
+    BOOL pending = Mp4_PrefetchIs(&s_preJob, path, ch) || Mp4_PrefetchIs(&s_preBusy, path, ch);
+    LeaveCriticalSection(&s_preCs);
+    if (pending) WaitForSingleObject(s_preIdle, INFINITE);
+
+    BYTE* data = NULL;
+    EnterCriticalSection(&s_preCs);
+    if (Mp4_PrefetchIs(&s_preDone, path, ch)) {
+        data = s_preDone.data;
+        s_preDone.data   = NULL;
+        s_preDone.length = 0;
+    }
+    LeaveCriticalSection(&s_preCs);
+    return data;
 }
 
 // ============================================================================
@@ -242,119 +789,156 @@ static BOOL FindChildBox(FileHandle& f, U64 parentOff, U64 parentSize, DWORD chi
 extern "C" BOOL __cdecl MP4_LoadCoverToBitmapA(const char* path, HBITMAP* phbm, SIZE* psz) {
     // Validate input parameters
     // Проверка входных параметров
-    if (!path || !*path || !HasMp4Ext(path)) return FALSE;
+    if (!path || !*path) return FALSE;
 
     // Open file using RAII wrapper (automatic cleanup on scope exit)
     // Открытие файла через RAII-обёртку (автоматическая очистка при выходе из scope)
     FileHandle f(path);
     if (!f.IsValid()) return FALSE;
 
-    U64 fileLimit = (U64)f.GetSize();
-    if (fileLimit < 16) return FALSE;  // Minimum valid MP4 size
-
-    // Declare variables for box offsets and sizes
-    // Объявление переменных для смещений и размеров box'ов
-    U64 ftypOff, ftypSz, moovOff, moovSz, udtaOff, udtaSz;
-    U64 metaOff, metaSz, ilstOff, ilstSz, covrOff, covrSz;
+    FileWindow r;
+    Mp4Box covr;
+    BOOL ok = FALSE;
+    if (Mp4_Open(&r, f) && Mp4_FindCovr(&r, path, &covr)) {
+        s_stats.files++;
 
-    // Navigate through MP4 box hierarchy (chain of responsibility pattern)
-    // Навигация по иерархии MP4 box'ов (паттерн цепочки обязанностей)
-    // If any box is not found, entire chain fails and function returns FALSE
-    // Если любой box не найден, вся цепочка прерывается и функция возвращает FALSE
-    
-    // 1. Validate file type box (ftyp) - identifies file as MP4
-    // 1. Проверка типа файла (ftyp) - идентифицирует файл как MP4
-    if (!FindFirstBox(f, 0, fileLimit, FCC('f', 't', 'y', 'p'), &ftypOff, &ftypSz)) return FALSE;
-    
-    // 2. Find movie metadata container (moov)
-    // 2. Поиск контейнера метаданных фильма (moov)
-    if (!FindFirstBox(f, 0, fileLimit, FCC('m', 'o', 'o', 'v'), &moovOff, &moovSz)) return FALSE;
-    
-    // 3. Find user data box (udta) - contains custom metadata
-    // 3. Поиск box'а пользовательских данных (udta) - содержит кастомные метаданные
-    if (!FindChildBox(f, moovOff, moovSz, FCC('u', 'd', 't', 'a'), &udtaOff, &udtaSz)) return FALSE;
-    
-    // 4. Find metadata box (meta) - iTunes/QuickTime metadata
-    // 4. Поиск box'а метаданных (meta) - метаданные iTunes/QuickTime
-    if (!FindChildBox(f, udtaOff, udtaSz, FCC('m', 'e', 't', 'a'), &metaOff, &metaSz)) return FALSE;
-    
-    // 5. Find item list box (ilst) - contains metadata items
-    // 5. Поиск списка элементов (ilst) - содержит элементы метаданных
-    if (!FindChildBox(f, metaOff, metaSz, FCC('i', 'l', 's', 't'), &ilstOff, &ilstSz)) return FALSE;
-    
-    // 6. Find cover art box (covr) - contains embedded artwork
-    // 6. Поиск box'а обложки (covr) - содержит встроенную обложку
-    if (!FindChildBox(f, ilstOff, ilstSz, FCC('c', 'o', 'v', 'r'), &covrOff, &covrSz)) return FALSE;
-
-    // Parse cover art box to find image data
-    // Парсинг box'а обложки для поиска данных изображения
-    U64 covrLimit = covrOff + covrSz;
-    U64 hdrSz = 0, payload = 0; 
-    DWORD type = 0;
-    
-    // Read covr box header
-    // Чтение заголовка covr box'а
-    if (!ReadBoxHeader(f, covrOff, covrLimit, &hdrSz, &type, &payload)) return FALSE;
-    
-    // Search for 'data' box containing actual image bytes
-    // Поиск 'data' box'а, содержащего фактические байты изображения
-    U64 pos = payload;
-    while (pos + 8 <= covrLimit) {
-        U64 dSz = 0, dPay = 0; 
-        DWORD dType = 0;
-        
-        // Read potential data box header
-        // Чтение заголовка потенциального data box'а
-        if (!ReadBoxHeader(f, pos, covrLimit, &dSz, &dType, &dPay)) break;
-
-        // Check if this is a 'data' box
-        // Проверка, является ли это 'data' box'ом
-        if (dType == FCC('d', 'a', 't', 'a')) {
-            // 'data' box structure:
-            // - 4 bytes: type indicator (0x00 = reserved, 0x0D = JPEG, 0x0E = PNG)
-            // - 4 bytes: locale indicator (usually 0)
-            // - N bytes: actual image data
-            //
-            // Структура 'data' box'а:
-            // - 4 байта: индикатор типа (0x00 = зарезервировано, 0x0D = JPEG, 0x0E = PNG)
-            // - 4 байта: индикатор локали (обычно 0)
-            // - N байт: фактические данные изображения
-            
-            if (dPay + 8 <= pos + dSz) {
-                // Skip 8 bytes (Type + Locale indicators)
-                // Пропуск 8 байт (индикаторы Type + Locale)
-                U64 imgOff = dPay + 8;
-                U64 imgLen = (pos + dSz) - imgOff;
-
-                // Validate image size (prevent memory exhaustion attacks)
-                // Проверка размера изображения (защита от атак на память)
-                if (imgLen > 0 && imgLen < (32 * 1024 * 1024)) {  // Max 32 MB
-                    // Allocate buffer for image data
-                    // Выделение буфера для данных изображения
-                    BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, (SIZE_T)imgLen);
-                    if (buf) {
-                        // Read image data from file
-                        // Чтение данных изображения из файла
-                        if (f.ReadAt(imgOff, buf, (DWORD)imgLen)) {
-                            // Attempt to load image (supports JPEG, PNG, BMP, etc.)
-                            // Попытка загрузить изображение (поддержка JPEG, PNG, BMP и др.)
-                            int ok = Img_LoadFromMemoryToBitmap(buf, (DWORD)imgLen, phbm, psz);
-                            GlobalFree(buf);
-                            if (ok) return TRUE;  // Success! / Успех!
-                        } else {
-                            GlobalFree(buf);
-                        }
-                    }
-                }
+        // Only the chosen picture is read and decoded (often straight from the
+        // block holding 'covr'); the next best one only if that fails
+        // Читается и декодируется только выбранное изображение (часто прямо из
+        // блока с 'covr'); следующее - только при ошибке
+        Mp4Picture pics[MP4_MAX_PICTURES];
+        int n = Mp4_CollectPictures(&r, &covr, pics, MP4_MAX_PICTURES);
+        for (int best = PicIndex_Best(pics, n, sizeof(pics[0])); best >= 0 && !ok;
+             best = PicIndex_Best(pics, n, sizeof(pics[0]))) {
+            const BYTE* img = FileWindow_View(&r, pics[best].pos, pics[best].len);
+            if (img) {
+                s_stats.decodes++;
+                ok = Img_LoadFromMemoryToBitmap(img, pics[best].len, phbm, psz);
             }
+            pics[best].cand.failed = !ok;
         }
-        
-        // Move to next box
-        // Переход к следующему box'у
-        pos += dSz;
     }
-    
-    // No valid cover art found
-    // Валидная обложка не найдена
-    return FALSE;
+    FileWindow_Free(&r);
+    return ok;
+}
+
+extern "C" int __cdecl MP4_IndexPicturesA(const char* path, PictureIndex* idx) {
+    if (!idx || !path || !*path) return 0;
+
+    FileHandle f(path);
+    if (!f.IsValid()) return 0;
+
+    FileWindow r;
+    Mp4Box covr;
+    int added = 0;
+    if (Mp4_Open(&r, f) && Mp4_FindCovr(&r, path, &covr)) {
+        // The same types the loader ranks by, so the strip agrees on the front cover
+        // Те же типы, по которым ранжирует загрузчик, чтобы лента согласилась с лицевой обложкой
+        Mp4Picture pics[MP4_MAX_PICTURES];
+        int n = Mp4_CollectPictures(&r, &covr, pics, MP4_MAX_PICTURES);
+        for (int i = 0; i < n; ++i) {
+            if (PicIndex_Add(idx, pics[i].pos, pics[i].len, pics[i].cand.type, PIC_SRC_MP4)) ++added;
+        }
+    }
+    FileWindow_Free(&r);
+    return added;
+}
+
+extern "C" int __cdecl MP4_GetChapterImagesA(const char* path, const MP4ChapterImage** items) {
+    if (items) *items = NULL;
+    if (!items || !path || !*path) return 0;
+
+    FileHandle f(path);
+    if (!f.IsValid()) return 0;
+    U64 size = f.GetSize64();
+    FILETIME wt = {0, 0};
+    GetFileTime(f, NULL, NULL, &wt);
+
+    if (!s_chap.valid || s_chap.size != size || CompareFileTime(&s_chap.time, &wt) != 0 ||
+        lstrcmpiA(s_chap.path, path) != 0) {
+        if (s_chap.items) GlobalFree(s_chap.items);
+        ZeroMemory(&s_chap, sizeof(s_chap));
+
+        FileWindow r;
+        if (Mp4_Open(&r, f) && Mp4_IsMp4(&r, path)) {
+            s_chap.count = Mp4_BuildChapters(&r, &s_chap.items);
+            s_stats.chapterIndexes++;
+        }
+        FileWindow_Free(&r);
+
+        lstrcpynA(s_chap.path, path, MAX_PATH);
+        s_chap.size  = size;
+        s_chap.time  = wt;
+        s_chap.valid = TRUE;
+    }
+    *items = s_chap.items;
+    return s_chap.count;
+}
+
+extern "C" void __cdecl MP4_ReleaseChapters(void) {
+    Mp4_PrefetchStop();
+    if (s_chap.items) GlobalFree(s_chap.items);
+    ZeroMemory(&s_chap, sizeof(s_chap));
+}
+
+extern "C" int __cdecl MP4_FindChapter(const MP4ChapterImage* items, int count, DWORD ms) {
+    // Last chapter starting at or before ms / Последняя глава, начинающаяся не позже ms
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (items[mid].startMs <= ms) lo = mid + 1; else hi = mid;
+    }
+    return lo - 1;
+}
+
+extern "C" BOOL __cdecl MP4_LoadChapterImageA(const char* path, const MP4ChapterImage* ch, HBITMAP* phbm, SIZE* psz) {
+    if (!path || !*path || !ch || !ch->length || ch->length >= MP4_MAX_IMAGE) return FALSE;
+
+    BYTE* buf = Mp4_PrefetchTake(path, ch);
+    if (buf) {
+        s_stats.prefetched++;
+    } else {
+        FileHandle f(path);
+        if (!f.IsValid()) return FALSE;
+        buf = (BYTE*)GlobalAlloc(GMEM_FIXED, ch->length);
+        if (!buf) return FALSE;
+        FileWindow r;
+        Mp4_Open(&r, f);
+        if (!FileWindow_ReadAt(&r, ch->offset, buf, ch->length)) {
+            GlobalFree(buf);
+            return FALSE;
+        }
+    }
+    s_stats.decodes++;
+    BOOL ok = Img_LoadFromMemoryToBitmap(buf, ch->length, phbm, psz);
+    GlobalFree(buf);
+    return ok;
+}
+
+extern "C" BOOL __cdecl MP4_PrefetchChapterImageA(const char* path, const MP4ChapterImage* ch) {
+    if (!path || !*path || !ch || !ch->length || ch->length >= MP4_MAX_IMAGE) return FALSE;
+    if (!Mp4_PrefetchStart()) return FALSE;
+
+    EnterCriticalSection(&s_preCs);
+    BOOL known = Mp4_PrefetchIs(&s_preJob, path, ch) || Mp4_PrefetchIs(&s_preBusy, path, ch) ||
+                 Mp4_PrefetchIs(&s_preDone, path, ch);
+    if (!known) {
+        lstrcpynA(s_preJob.path, path, MAX_PATH);
+        s_preJob.offset = ch->offset;
+        s_preJob.length = ch->length;
+        s_preJob.data   = NULL;
+        ResetEvent(s_preIdle);
+    }
+    LeaveCriticalSection(&s_preCs);
+    if (!known) SetEvent(s_preWake);
+    return TRUE;
+}
+
+extern "C" void __cdecl MP4_GetStats(MP4Stats* out) {
+    if (!out) return;
+    *out = s_stats;
+    if (s_preThread) EnterCriticalSection(&s_preCs);
+    out->reads     += s_preReads;
+    out->bytesRead += s_preBytes;
+    if (s_preThread) LeaveCriticalSection(&s_preCs);
 }
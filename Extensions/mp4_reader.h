@@ -4,23 +4,59 @@
  * @brief Экстрактор встроенных обложек MP4/M4A
  * * Designed for iTunes-style metadata (covr atom) within ISO Base Media File Format.
  * * Предназначен для метаданных в стиле iTunes (атом covr) внутри формата ISO Base Media File Format.
+ * * Box paths are walked through a block-sized read window, so the headers of
+ * * one tree level cost a single read; 64-bit and to-end box sizes, and both
+ * * ISO (full box) and QuickTime (plain) 'meta' layouts are understood.
+ * * Пути box'ов обходятся через окно чтения размером с блок, поэтому заголовки
+ * * одного уровня дерева стоят одного чтения; понимаются 64-битные размеры и размер
+ * * "до конца", а также раскладки 'meta' ISO (full box) и QuickTime (обычный box).
  * * Supported Containers / Поддерживаемые контейнеры:
  * - .m4a, .m4b (Audiobooks), .mp4, .m4v, .mov
+ * - Any name, e.g. .3gp or MP4-wrapped .aac: files are recognised by the 'ftyp' brand
+ *   Любое имя, например .3gp или .aac в MP4: файлы распознаются по бренду 'ftyp'
+ * * A 'moov' written after 'mdat' is reached by jumping over 'mdat' from its
+ * * header; the remaining tail (up to 256 KB) then comes in one read.
+ * * До 'moov', записанного после 'mdat', добираемся прыжком через 'mdat' по его
+ * * заголовку; оставшийся хвост (до 256 КБ) затем приходит одним чтением.
  * * @author [Your Name]
  * @version 1.0
  */
 
 #pragma once
 #include <windows.h>
+#include "picture_index.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Reader statistics / Статистика ридера
+ */
+typedef struct {
+    DWORD files;       ///< Files with a 'covr' box / Файлов с box'ом 'covr'
+    DWORD reads;       ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;   ///< Bytes read / Прочитано байт
+    DWORD boxes;       ///< Box headers parsed / Разобрано заголовков box'ов
+    DWORD pictures;    ///< 'covr' images described / Описано изображений 'covr'
+    DWORD chapterIndexes; ///< Chapter image indexes built / Построено индексов изображений глав
+    DWORD prefetched;  ///< Chapter images decoded from bytes read ahead / Изображений глав из заранее прочитанных байт
+    DWORD decodes;     ///< Pictures handed to the decoder / Изображений передано декодеру
+} MP4Stats;
+
 /**
  * @brief Load cover art from MP4 file
  * @brief Загрузить обложку из MP4 файла
  * * Navigates atom tree: moov -> udta -> meta -> ilst -> covr -> data
+ * * (or moov -> meta -> ilst -> covr -> data)
+ * * Every image 'data' box is described from its type indicator and first
+ * * bytes (format, width, height); only the one PicIndex_Prefer() ranks best
+ * * is read and decoded, the next best only if that fails. Between equals a
+ * * type indicator that matches the bytes wins.
+ * * Каждый 'data' box с изображением описывается по индикатору типа и первым
+ * * байтам (формат, ширина, высота); читается и декодируется только лучший по
+ * * PicIndex_Prefer(), следующий - только при ошибке. Среди равных побеждает
+ * * индикатор типа, совпадающий с байтами.
  * * @param audioPath Path to MP4 file / Путь к MP4 файлу
  * @param phbm [out] Result bitmap / Результирующий bitmap
  * @param psz [out] Result dimensions / Результирующие размеры
@@ -28,6 +64,92 @@ extern "C" {
  */
 BOOL __cdecl MP4_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz);
 
+/**
+ * @brief Index every 'data' box of 'covr' without reading the image bytes
+ * @brief Проиндексировать все 'data' box'ы в 'covr', не читая байты изображений
+ *
+ * Images the decoder recognises are reported as front covers, the rest as
+ * PIC_TYPE_OTHER - the types MP4_LoadCoverToBitmapA() ranks by.
+ * Изображения, которые распознаёт декодер, считаются лицевыми обложками,
+ * остальные - PIC_TYPE_OTHER: это типы, по которым ранжирует MP4_LoadCoverToBitmapA().
+ *
+ * @param audioPath Path to MP4 file / Путь к MP4 файлу
+ * @param idx [in,out] Index to append to / Индекс для дополнения
+ * @return Number of pictures added / Количество добавленных изображений
+ */
+int __cdecl MP4_IndexPicturesA(const char* audioPath, PictureIndex* idx);
+
+/**
+ * @brief One chapter image of an audiobook / Одно изображение главы аудиокниги
+ */
+typedef struct {
+    DWORD            startMs;   ///< Chapter start in track time / Начало главы во времени трека
+    DWORD            length;    ///< Image bytes / Байт изображения
+    unsigned __int64 offset;    ///< Image position in the file / Позиция изображения в файле
+} MP4ChapterImage;
+
+/**
+ * @brief Chapter images of an M4B/MP4 file, in time order
+ * @brief Изображения глав файла M4B/MP4 в порядке времени
+ *
+ * Built from the sample tables (stts, stsc, stco/co64, stsz) of the video
+ * track 'tref/chap' points to, without reading any image. The index of the
+ * last file asked for is kept: asking again costs no box reads while the
+ * file size and write time are unchanged.
+ * Строится по таблицам сэмплов (stts, stsc, stco/co64, stsz) видеотрека, на
+ * который указывает 'tref/chap', без чтения изображений. Индекс последнего
+ * запрошенного файла сохраняется: повторный запрос не читает box'ы, пока
+ * размер и время записи файла не изменились.
+ *
+ * @param audioPath Path to MP4 file / Путь к MP4 файлу
+ * @param items [out] Index owned by the reader, valid until the next call or
+ *                    MP4_ReleaseChapters(); callers that keep it take a copy
+ *                    Индекс принадлежит ридеру, действителен до следующего вызова
+ *                    или MP4_ReleaseChapters(); кто хранит его, делает копию
+ * @return Number of chapter images, 0 if none / Количество изображений глав, 0 если нет
+ */
+int __cdecl MP4_GetChapterImagesA(const char* audioPath, const MP4ChapterImage** items);
+
+/**
+ * @brief Stop the prefetch thread and free the cached chapter image index (on unload)
+ * @brief Остановить поток упреждающего чтения и освободить кэшированный индекс изображений глав (при выгрузке)
+ */
+void __cdecl MP4_ReleaseChapters(void);
+
+/**
+ * @brief Chapter playing at @p ms / Глава, играющая в момент @p ms
+ * @return Index into @p items, -1 before the first chapter / Индекс в @p items, -1 до первой главы
+ */
+int __cdecl MP4_FindChapter(const MP4ChapterImage* items, int count, DWORD ms);
+
+/**
+ * @brief Read the bytes of a chapter image ahead on a background thread
+ * @brief Заранее прочитать байты изображения главы в фоновом потоке
+ *
+ * Only the read happens there. MP4_LoadChapterImageA() for the same chapter
+ * then decodes the bytes without touching the file, and waits for a read
+ * still under way rather than issuing a second one. The latest request wins.
+ * Там выполняется только чтение. MP4_LoadChapterImageA() для той же главы
+ * затем декодирует байты, не обращаясь к файлу, и ждёт ещё идущее чтение
+ * вместо второго. Побеждает последний запрос.
+ *
+ * @return TRUE if queued or already read / TRUE если поставлено или уже прочитано
+ */
+BOOL __cdecl MP4_PrefetchChapterImageA(const char* audioPath, const MP4ChapterImage* ch);
+
+/**
+ * @brief Read and decode one chapter image / Прочитать и декодировать одно изображение главы
+ *
+ * Uses the bytes MP4_PrefetchChapterImageA() read ahead when they match.
+ * Использует байты, заранее прочитанные MP4_PrefetchChapterImageA(), если они совпадают.
+ */
+BOOL __cdecl MP4_LoadChapterImageA(const char* audioPath, const MP4ChapterImage* ch, HBITMAP* phbm, SIZE* psz);
+
+/**
+ * @brief Copy reader statistics / Скопировать статистику ридера
+ */
+void __cdecl MP4_GetStats(MP4Stats* out);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
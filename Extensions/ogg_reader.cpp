@@ -0,0 +1,812 @@
+/**
+ * @file ogg_reader.cpp
+ * @brief Ogg cover art extractor implementation
+ * @brief Реализация экстрактора обложек Ogg
+ *
+ * Page layout / Структура страницы:
+ * "OggS" version(1) flags(1) granule(8) serial(4) sequence(4) crc(4) segments(1)
+ * lacing[segments] body. A packet is a run of lacing values ending with one
+ * below 255; a run reaching the end of the table continues on the next page
+ * (flag 0x01).
+ * Пакет - последовательность значений lacing, заканчивающаяся значением меньше
+ * 255; последовательность, дошедшая до конца таблицы, продолжается на следующей
+ * странице (флаг 0x01).
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <string.h>
+#include "ogg_reader.h"
+#include "flac_reader.h"
+#include "..\image_loader.h"
+#include "..\utils_common.h"
+#include "..\pixel_ops.h"
+#include <emmintrin.h>
+
+typedef unsigned __int64 U64;  ///< 64-bit unsigned integer for file offsets
+
+#define OGG_PAGE_HEADER  27                   ///< Fixed part of a page header / Фиксированная часть заголовка страницы
+#define OGG_HEADER_MAX   (OGG_PAGE_HEADER + 255) ///< Page header with a full lacing table / Заголовок страницы с полной таблицей
+#define OGG_BODY_MAX     (255 * 255)          ///< Largest page body / Наибольшее тело страницы
+#define OGG_MAX_PAGES    4096                 ///< Pages walked per call at most / Не более страниц за вызов
+#define OGG_MAX_PICTURES 32
+#define OGG_MAX_PICTURE  (16 * 1024 * 1024)   ///< Same limit as FLAC / Тот же предел, что у FLAC
+#define OGG_HEAD_BYTES   1023                 ///< Decoded to describe a picture (multiple of 3) / Декодируется для описания (кратно 3)
+
+#define OGG_FLAG_CONTINUED 0x01
+#define OGG_FLAG_BOS       0x02
+
+/// Codec of the chosen logical stream / Кодек выбранного логического потока
+#define OGG_NONE   0
+#define OGG_VORBIS 1
+#define OGG_OPUS   2
+#define OGG_FLAC   3
+
+static OGGStats s_stats = {0};
+
+static BOOL Ogg_ReadAt(FileHandle& f, U64 pos, void* buf, DWORD size)
+{
+    s_stats.reads++;
+    s_stats.bytesRead += size;
+    return f.ReadAt(pos, buf, size);
+}
+
+// ============================================================================
+// Page Cursor / Курсор по страницам
+// ============================================================================
+
+/**
+ * @brief Read position inside the packets of one logical stream
+ * @brief Позиция чтения внутри пакетов одного логического потока
+ *
+ * Only one page body is held at a time. It is read together with the fixed
+ * header of the following page; the lacing table of that page is read on its
+ * own, so no byte of a body is read before the page is known to be wanted.
+ * В памяти хранится тело только одной страницы. Оно читается вместе с
+ * фиксированным заголовком следующей; таблица lacing той страницы читается
+ * отдельно, поэтому ни один байт тела не читается, пока страница не нужна.
+ */
+typedef struct {
+    FileHandle* f;
+    U64   fileSize;
+    BYTE* buf;        ///< Page body, then the next page header / Тело страницы, затем заголовок следующей
+    DWORD body;       ///< Body bytes in buf / Байт тела в buf
+    DWORD ahead;      ///< Header bytes after the body / Байт заголовка после тела
+    U64   page;       ///< File offset of the page / Смещение страницы в файле
+    U64   next;       ///< File offset of the next page / Смещение следующей страницы
+    DWORD serial;
+    BOOL  started;    ///< Serial chosen; other streams are skipped / Serial выбран; другие потоки пропускаются
+    BYTE  flags;
+    BYTE  lace[255];
+    int   segs, seg;  ///< Lacing table and next entry / Таблица lacing и следующий элемент
+    DWORD off;        ///< Read position in the body / Позиция чтения в теле
+    DWORD avail;      ///< Bytes of the current packet left on this page / Байт текущего пакета на этой странице
+    BOOL  ends;       ///< The current packet ends on this page / Текущий пакет заканчивается на этой странице
+} OggCursor;
+
+static BOOL Ogg_InitCursor(OggCursor* c, FileHandle& f)
+{
+    ZeroMemory(c, sizeof(*c));
+    c->f = &f;
+    c->fileSize = f.GetSize64();
+    c->buf = (BYTE*)GlobalAlloc(GMEM_FIXED, OGG_BODY_MAX + OGG_PAGE_HEADER);
+    return c->buf != NULL;
+}
+
+static void Ogg_FreeCursor(OggCursor* c)
+{
+    if (c->buf) GlobalFree(c->buf);
+    c->buf = NULL;
+}
+
+/**
+ * @brief Load the first page of the stream at or after @p at
+ * @brief Загрузить первую страницу потока, начиная с @p at
+ *
+ * Pages of other logical streams are stepped over by their headers alone.
+ * Страницы других логических потоков перешагиваются только по заголовкам.
+ */
+static BOOL Ogg_LoadPage(OggCursor* c, U64 at)
+{
+    for (int guard = 0; guard < OGG_MAX_PAGES; ++guard) {
+        BYTE hdr[OGG_HEADER_MAX];
+        BOOL held = (c->ahead == OGG_PAGE_HEADER && at == c->next);
+        if (held) CopyMemory(hdr, c->buf + c->body, OGG_PAGE_HEADER);
+        c->body = c->ahead = c->avail = 0;
+        c->segs = c->seg = 0;
+        c->ends = TRUE;   // no packet open / пакет не открыт
+
+        if (at >= c->fileSize || c->fileSize - at < OGG_PAGE_HEADER) return FALSE;
+        if (!held && !Ogg_ReadAt(*c->f, at, hdr, OGG_PAGE_HEADER)) return FALSE;
+        if (memcmp(hdr, "OggS", 4) != 0 || hdr[4] != 0) return FALSE;
+
+        // The lacing table alone: it gives the body size
+        // Только таблица lacing: она даёт размер тела
+        int   segs = hdr[26];
+        DWORD hlen = OGG_PAGE_HEADER + segs, body = 0;
+        if (c->fileSize - at < hlen) return FALSE;
+        if (segs && !Ogg_ReadAt(*c->f, at + OGG_PAGE_HEADER, hdr + OGG_PAGE_HEADER, segs)) return FALSE;
+        for (int i = 0; i < segs; ++i) body += hdr[OGG_PAGE_HEADER + i];
+        U64 start = at + hlen;
+        if (body > c->fileSize - start) return FALSE;
+        s_stats.pages++;
+
+        DWORD serial = LE32(hdr + 14);
+        if (c->started && serial != c->serial) {
+            at = start + body;
+            c->next = at;
+            continue;
+        }
+
+        // The body and the fixed header of the next page in one read
+        // Тело и фиксированный заголовок следующей страницы одним чтением
+        DWORD ahead = (c->fileSize - (start + body) >= OGG_PAGE_HEADER) ? OGG_PAGE_HEADER : 0;
+        if (body + ahead && !Ogg_ReadAt(*c->f, start, c->buf, body + ahead)) return FALSE;
+
+        c->started = TRUE;
+        c->serial  = serial;
+        c->flags   = hdr[5];
+        c->segs    = segs;
+        CopyMemory(c->lace, hdr + 27, segs);
+        c->page    = at;
+        c->next    = start + body;
+        c->body    = body;
+        c->ahead   = ahead;
+        c->off     = 0;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// Take lacing values up to the end of the packet or of the page
+// Взять значения lacing до конца пакета или страницы
+static void Ogg_Run(OggCursor* c)
+{
+    c->avail = 0;
+    c->ends  = FALSE;
+    while (c->seg < c->segs) {
+        BYTE v = c->lace[c->seg++];
+        c->avail += v;
+        if (v < 255) {
+            c->ends = TRUE;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Next contiguous bytes of the current packet, loading a continuation page if needed
+ * @brief Следующие непрерывные байты текущего пакета, с загрузкой страницы-продолжения при необходимости
+ *
+ * @return Byte count, 0 at the end of the packet / Количество байт, 0 в конце пакета
+ */
+static DWORD Ogg_Chunk(OggCursor* c, const BYTE** p)
+{
+    while (c->avail == 0) {
+        if (c->ends) return 0;
+        if (!Ogg_LoadPage(c, c->next) || !(c->flags & OGG_FLAG_CONTINUED)) {
+            c->ends = TRUE;   // truncated packet / обрезанный пакет
+            return 0;
+        }
+        Ogg_Run(c);
+    }
+    *p = c->buf + c->off;
+    return c->avail;
+}
+
+static void Ogg_Consume(OggCursor* c, DWORD n)
+{
+    c->off   += n;
+    c->avail -= n;
+}
+
+static DWORD Ogg_Read(OggCursor* c, void* dst, DWORD n)
+{
+    DWORD done = 0;
+    while (done < n) {
+        const BYTE* p;
+        DWORD k = Ogg_Chunk(c, &p);
+        if (!k) break;
+        if (k > n - done) k = n - done;
+        CopyMemory((BYTE*)dst + done, p, k);
+        Ogg_Consume(c, k);
+        done += k;
+    }
+    return done;
+}
+
+static BOOL Ogg_Skip(OggCursor* c, DWORD n)
+{
+    while (n) {
+        const BYTE* p;
+        DWORD k = Ogg_Chunk(c, &p);
+        if (!k) return FALSE;
+        if (k > n) k = n;
+        Ogg_Consume(c, k);
+        n -= k;
+    }
+    return TRUE;
+}
+
+static BOOL Ogg_ReadLE32(OggCursor* c, DWORD* v)
+{
+    BYTE b[4];
+    if (Ogg_Read(c, b, 4) != 4) return FALSE;
+    *v = LE32(b);
+    return TRUE;
+}
+
+/**
+ * @brief Drop the rest of the current packet and open the next one
+ * @brief Отбросить остаток текущего пакета и открыть следующий
+ */
+static BOOL Ogg_NextPacket(OggCursor* c)
+{
+    const BYTE* p;
+    DWORD n;
+    while ((n = Ogg_Chunk(c, &p)) != 0) Ogg_Consume(c, n);
+
+    if (c->seg >= c->segs) {
+        if (!Ogg_LoadPage(c, c->next) || (c->flags & OGG_FLAG_CONTINUED)) return FALSE;
+    }
+    Ogg_Run(c);
+    return TRUE;
+}
+
+/**
+ * @brief Position the cursor at byte @p off of the body of the page at @p page
+ * @brief Поставить курсор на байт @p off тела страницы по смещению @p page
+ */
+static BOOL Ogg_Seek(OggCursor* c, U64 page, DWORD off)
+{
+    c->started = FALSE;
+    c->ahead   = 0;
+    if (!Ogg_LoadPage(c, page) || off >= c->body) return FALSE;
+
+    DWORD end = 0;
+    while (c->seg < c->segs) {
+        Ogg_Run(c);
+        end += c->avail;
+        if (off < end) {
+            c->off   = off;
+            c->avail = end - off;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// ============================================================================
+// Base64 / Base64
+// ============================================================================
+
+/**
+ * @brief Destination of stored picture bytes: base64-decoded or copied as is
+ * @brief Приёмник хранимых байтов изображения: декодированных из base64 или скопированных
+ */
+typedef struct {
+    BYTE* out;
+    DWORD len, max;
+    BOOL  base64;
+    BYTE  quad[4];    ///< Characters of an unfinished group / Символы незавершённой группы
+    int   nq;
+    BOOL  done;       ///< Padding seen / Встречено дополнение
+    BOOL  bad;
+} OggSink;
+
+#define B64_PAD 64
+
+static signed char s_b64[256];
+static BOOL        s_b64Ready = FALSE;
+
+static void Sink_Init(OggSink* k, BYTE* out, DWORD max, BOOL base64)
+{
+    ZeroMemory(k, sizeof(*k));
+    k->out    = out;
+    k->max    = max;
+    k->base64 = base64;
+
+    if (base64 && !s_b64Ready) {
+        const char* abc = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        FillMemory(s_b64, sizeof(s_b64), (BYTE)-1);
+        for (int i = 0; i < 64; ++i) s_b64[(BYTE)abc[i]] = (signed char)i;
+        s_b64Ready = TRUE;
+    }
+}
+
+/**
+ * @brief Decode whole 16-character blocks of the plain alphabet
+ * @brief Декодировать целые блоки из 16 символов основного алфавита
+ *
+ * Stops at the first block holding anything else (padding, line breaks) and
+ * leaves it to the scalar loop.
+ * Останавливается на первом блоке с чем-то ещё (дополнение, переводы строк) и
+ * оставляет его скалярному циклу.
+ *
+ * @return Characters consumed (multiple of 16); 12 bytes written per block
+ * @return Потреблено символов (кратно 16); 12 байт записано на блок
+ */
+static DWORD B64_BlocksSSE2(const BYTE* s, DWORD n, BYTE* d, DWORD room)
+{
+    // Character classes by signed range compares: bytes >= 0x80 fall in none
+    // Классы символов сравнениями со знаком: байты >= 0x80 не попадают ни в один
+    const __m128i upA = _mm_set1_epi8('A' - 1), upZ = _mm_set1_epi8('Z' + 1);
+    const __m128i loA = _mm_set1_epi8('a' - 1), loZ = _mm_set1_epi8('z' + 1);
+    const __m128i dg0 = _mm_set1_epi8('0' - 1), dg9 = _mm_set1_epi8('9' + 1);
+    const __m128i plus = _mm_set1_epi8('+'), slash = _mm_set1_epi8('/');
+    const __m128i lo8  = _mm_set1_epi16(0x00FF), lo16 = _mm_set1_epi32(0xFFFF);
+
+    DWORD used = 0;
+    while (n - used >= 16 && room >= 12) {
+        __m128i v  = _mm_loadu_si128((const __m128i*)(s + used));
+        __m128i up = _mm_and_si128(_mm_cmpgt_epi8(v, upA), _mm_cmplt_epi8(v, upZ));
+        __m128i lo = _mm_and_si128(_mm_cmpgt_epi8(v, loA), _mm_cmplt_epi8(v, loZ));
+        __m128i dg = _mm_and_si128(_mm_cmpgt_epi8(v, dg0), _mm_cmplt_epi8(v, dg9));
+        __m128i pl = _mm_cmpeq_epi8(v, plus);
+        __m128i sl = _mm_cmpeq_epi8(v, slash);
+        __m128i ok = _mm_or_si128(_mm_or_si128(up, lo), _mm_or_si128(dg, _mm_or_si128(pl, sl)));
+        if (_mm_movemask_epi8(ok) != 0xFFFF) break;
+
+        // Character -> 6-bit value: add the offset of its class
+        // Символ -> 6-битное значение: прибавить смещение его класса
+        __m128i delta = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(up, _mm_set1_epi8(-65)), _mm_and_si128(lo, _mm_set1_epi8(-71))),
+            _mm_or_si128(_mm_and_si128(dg, _mm_set1_epi8(4)),
+                         _mm_or_si128(_mm_and_si128(pl, _mm_set1_epi8(19)), _mm_and_si128(sl, _mm_set1_epi8(16)))));
+        v = _mm_add_epi8(v, delta);
+
+        // a b c d -> (a << 6 | b) per 16 bits -> (ab << 12 | cd) per 32 bits
+        // a b c d -> (a << 6 | b) на 16 бит -> (ab << 12 | cd) на 32 бита
+        __m128i t = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, lo8), 6), _mm_srli_epi16(v, 8));
+        t = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, lo16), 12), _mm_srli_epi32(t, 16));
+
+        DWORD q[4];
+        _mm_storeu_si128((__m128i*)q, t);
+        for (int i = 0; i < 4; ++i) {
+            d[0] = (BYTE)(q[i] >> 16);
+            d[1] = (BYTE)(q[i] >> 8);
+            d[2] = (BYTE)q[i];
+            d += 3;
+        }
+        used += 16;
+        room -= 12;
+    }
+    return used;
+}
+
+// Write out one complete group of four characters
+// Вывести одну полную группу из четырёх символов
+static void B64_Quad(OggSink* k)
+{
+    const BYTE* q = k->quad;
+    k->nq = 0;
+    if (q[0] == B64_PAD || q[1] == B64_PAD || (q[2] == B64_PAD && q[3] != B64_PAD)) {
+        k->bad = TRUE;
+        return;
+    }
+    DWORD bytes = (q[2] == B64_PAD) ? 1 : (q[3] == B64_PAD) ? 2 : 3;
+    if (k->max - k->len < bytes) {
+        k->bad = TRUE;
+        return;
+    }
+    DWORD x = ((DWORD)q[0] << 18) | ((DWORD)q[1] << 12) | ((DWORD)(q[2] & 63) << 6) | (q[3] & 63);
+    BYTE* d = k->out + k->len;
+    d[0] = (BYTE)(x >> 16);
+    if (bytes > 1) d[1] = (BYTE)(x >> 8);
+    if (bytes > 2) d[2] = (BYTE)x;
+    k->len += bytes;
+    if (bytes < 3) k->done = TRUE;
+}
+
+static void Sink_Feed(OggSink* k, const BYTE* s, DWORD n)
+{
+    if (k->bad) return;
+    if (!k->base64) {
+        if (n > k->max - k->len) {
+            k->bad = TRUE;
+            return;
+        }
+        CopyMemory(k->out + k->len, s, n);
+        k->len += n;
+        return;
+    }
+
+    const BOOL sse2 = Pix_HasSSE2();
+    DWORD before = k->len;
+    while (n && !k->bad) {
+        if (sse2 && k->nq == 0 && !k->done && n >= 16) {
+            DWORD used = B64_BlocksSSE2(s, n, k->out + k->len, k->max - k->len);
+            k->len += used / 16 * 12;
+            s += used;
+            n -= used;
+            if (!n) break;
+        }
+
+        BYTE ch = *s++;
+        --n;
+        if (k->done) continue;   // nothing follows the padding / после дополнения ничего нет
+
+        int v = (ch == '=') ? B64_PAD : s_b64[ch];
+        if (v < 0) {
+            if (ch == '\r' || ch == '\n' || ch == ' ' || ch == '\t') continue;
+            k->bad = TRUE;
+            break;
+        }
+        k->quad[k->nq++] = (BYTE)v;
+        if (k->nq == 4) B64_Quad(k);
+    }
+    s_stats.base64Bytes += k->len - before;
+}
+
+// Finish a group left without padding / Завершить группу, оставшуюся без дополнения
+static BOOL Sink_Finish(OggSink* k)
+{
+    if (k->base64 && k->nq && !k->bad) {
+        if (k->nq == 1) k->bad = TRUE;
+        else {
+            DWORD before = k->len;
+            while (k->nq < 4) k->quad[k->nq++] = B64_PAD;
+            B64_Quad(k);
+            s_stats.base64Bytes += k->len - before;
+        }
+    }
+    return !k->bad;
+}
+
+/**
+ * @brief Feed @p n stored bytes of the current packet into a sink
+ * @brief Передать @p n хранимых байт текущего пакета в приёмник
+ *
+ * All @p n bytes are consumed even if the sink fails, so the walk stays in step.
+ * Все @p n байт потребляются, даже если приёмник ошибся, чтобы обход не сбился.
+ *
+ * @return FALSE if the packet ended first / FALSE если пакет закончился раньше
+ */
+static BOOL Ogg_Decode(OggCursor* c, DWORD n, OggSink* k)
+{
+    while (n) {
+        const BYTE* p;
+        DWORD got = Ogg_Chunk(c, &p);
+        if (!got) {
+            k->bad = TRUE;
+            return FALSE;
+        }
+        if (got > n) got = n;
+        Sink_Feed(k, p, got);
+        Ogg_Consume(c, got);
+        n -= got;
+    }
+    return TRUE;
+}
+
+// Upper bound of the decoded size / Верхняя граница декодированного размера
+static DWORD Ogg_DecodedMax(DWORD stored, BYTE coding)
+{
+    return (coding & PIC_CODING_BASE64) ? (stored / 4 + 1) * 3 : stored;
+}
+
+// ============================================================================
+// Picture Scan / Поиск изображений
+// ============================================================================
+
+/**
+ * @brief One picture, described from its first bytes
+ * @brief Одно изображение, описанное по первым байтам
+ */
+typedef struct {
+    PictureCandidate cand;   ///< Type and size from the picture header / Тип и размер по заголовку изображения
+    U64   page;       ///< Page the stored bytes start on / Страница, где начинаются хранимые байты
+    DWORD off;        ///< Their offset in its body / Их смещение в её теле
+    DWORD stored;     ///< Stored bytes (base64 characters or raw) / Хранимых байт (символов base64 или как есть)
+    BYTE  coding;     ///< PIC_CODING_OGG [| PIC_CODING_BASE64]
+    DWORD skip, len;  ///< Image inside the decoded bytes / Изображение внутри декодированных байт
+} OggPicture;
+
+typedef struct {
+    OggPicture pics[OGG_MAX_PICTURES];
+    int   n;
+    BOOL  keep;       ///< Decode the best picture so far during the walk / Декодировать лучшее изображение по ходу обхода
+    int   best;       ///< Picture held in @data, or -1 / Изображение в @data, или -1
+    BYTE* data;
+    DWORD dataLen;
+} OggScan;
+
+/**
+ * @brief Describe the picture whose @p stored bytes start at the cursor, then step over it
+ * @brief Описать изображение, чьи @p stored байт начинаются у курсора, и перешагнуть его
+ *
+ * @param legacy COVERART: a bare image, no PICTURE structure / COVERART: голое изображение, без структуры PICTURE
+ */
+static void Ogg_Picture(OggCursor* c, OggScan* s, DWORD stored, BYTE coding, BOOL legacy)
+{
+    const BYTE* p;
+    if (s->n >= OGG_MAX_PICTURES || !stored || !Ogg_Chunk(c, &p)) {
+        Ogg_Skip(c, stored);
+        return;
+    }
+
+    OggPicture* pic = &s->pics[s->n];
+    ZeroMemory(pic, sizeof(*pic));
+    pic->page   = c->page;
+    pic->off    = c->off;
+    pic->stored = stored;
+    pic->coding = coding;
+
+    BYTE  head[OGG_HEAD_BYTES];
+    DWORD first = (coding & PIC_CODING_BASE64) ? OGG_HEAD_BYTES / 3 * 4 : OGG_HEAD_BYTES;
+    if (first > stored) first = stored;
+    OggSink k;
+    Sink_Init(&k, head, sizeof(head), (coding & PIC_CODING_BASE64) != 0);
+    Ogg_Decode(c, first, &k);
+
+    DWORD max = Ogg_DecodedMax(stored, coding);
+    BOOL  ok  = !k.bad && max <= OGG_MAX_PICTURE + OGG_HEAD_BYTES;
+    if (ok && legacy) {
+        pic->cand.type = PIC_TYPE_OTHER;
+        pic->len  = max;   // trimmed to the decoded size on load / обрезается по декодированному размеру при загрузке
+        if (!Img_ProbeSize(head, k.len, &pic->cand.dim)) pic->cand.dim.cx = pic->cand.dim.cy = 0;
+    } else if (ok) {
+        ok = FLAC_DescribePicture(head, k.len, max, &pic->cand.type, &pic->cand.dim, &pic->skip, &pic->len);
+    }
+    DWORD rest = stored - first;
+    if (!ok) {
+        Ogg_Skip(c, rest);
+        return;
+    }
+    s->n++;
+    s_stats.pictures++;
+
+    // The loader keeps decoding a picture that beats the best so far, so the
+    // usual single cover is ready when the walk ends, without a second pass
+    // Загрузчик продолжает декодировать изображение, лучшее на данный момент,
+    // поэтому обычная единственная обложка готова к концу обхода, без второго прохода
+    if (!s->keep || (s->best >= 0 && !PicIndex_Prefer(pic->cand.type, pic->cand.dim,
+                                                       s->pics[s->best].cand.type, s->pics[s->best].cand.dim))) {
+        Ogg_Skip(c, rest);
+        return;
+    }
+    BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, max);
+    if (!buf) {
+        Ogg_Skip(c, rest);
+        return;
+    }
+    CopyMemory(buf, head, k.len);
+    k.out = buf;
+    k.max = max;
+    if (Ogg_Decode(c, rest, &k) && Sink_Finish(&k)) {
+        if (s->data) GlobalFree(s->data);
+        s->data    = buf;
+        s->dataLen = k.len;
+        s->best    = s->n - 1;
+    } else {
+        GlobalFree(buf);
+        pic->cand.failed = TRUE;
+    }
+}
+
+/**
+ * @brief Walk a Vorbis comment list: vendor, count, then "NAME=value" fields
+ * @brief Обойти список комментариев Vorbis: вендор, количество, затем поля "ИМЯ=значение"
+ */
+static void Ogg_ScanComments(OggCursor* c, OggScan* s)
+{
+    DWORD vendor, count;
+    if (!Ogg_ReadLE32(c, &vendor) || !Ogg_Skip(c, vendor) || !Ogg_ReadLE32(c, &count)) return;
+
+    for (DWORD i = 0; i < count; ++i) {
+        DWORD len;
+        if (!Ogg_ReadLE32(c, &len)) return;
+
+        // Field name up to '=', compared ASCII case-insensitively
+        // Имя поля до '=', сравнивается без учёта регистра ASCII
+        char  name[24];
+        DWORD used = 0, nlen = 0;
+        BOOL  eq = FALSE;
+        while (used < len && nlen < sizeof(name)) {
+            BYTE ch;
+            if (Ogg_Read(c, &ch, 1) != 1) return;
+            ++used;
+            if (ch == '=') {
+                eq = TRUE;
+                break;
+            }
+            name[nlen++] = (char)((ch >= 'a' && ch <= 'z') ? ch - 32 : ch);
+        }
+
+        DWORD rest = len - used;
+        if (eq && nlen == 22 && memcmp(name, "METADATA_BLOCK_PICTURE", 22) == 0) {
+            Ogg_Picture(c, s, rest, PIC_CODING_OGG | PIC_CODING_BASE64, FALSE);
+        } else if (eq && nlen == 8 && memcmp(name, "COVERART", 8) == 0) {
+            Ogg_Picture(c, s, rest, PIC_CODING_OGG | PIC_CODING_BASE64, TRUE);
+        } else if (!Ogg_Skip(c, rest)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Find the first Vorbis, Opus or FLAC stream among the beginning-of-stream pages
+ * @brief Найти первый поток Vorbis, Opus или FLAC среди начальных страниц потоков
+ *
+ * @param headers [out] Ogg FLAC header packet count, 0 = unknown / Число пакетов заголовка Ogg FLAC, 0 = неизвестно
+ * @return OGG_* codec / Кодек OGG_*
+ */
+static int Ogg_Open(OggCursor* c, int* headers)
+{
+    U64 at = 0;
+    *headers = 0;
+    for (int guard = 0; guard < 16; ++guard) {
+        c->started = FALSE;
+        if (!Ogg_LoadPage(c, at) || !(c->flags & OGG_FLAG_BOS)) return OGG_NONE;
+        Ogg_Run(c);
+
+        // Identification packet / Пакет идентификации
+        BYTE  id[9];
+        DWORD n = Ogg_Read(c, id, sizeof(id));
+        if (n >= 7 && id[0] == 1 && memcmp(id + 1, "vorbis", 6) == 0) return OGG_VORBIS;
+        if (n >= 8 && memcmp(id, "OpusHead", 8) == 0) return OGG_OPUS;
+        if (n >= 9 && id[0] == 0x7F && memcmp(id + 1, "FLAC", 4) == 0) {
+            *headers = (id[7] << 8) | id[8];
+            return OGG_FLAC;
+        }
+        at = c->next;
+    }
+    return OGG_NONE;
+}
+
+/**
+ * @brief Describe every picture of the header packets
+ * @brief Описать все изображения пакетов заголовка
+ *
+ * @return Number of pictures / Количество изображений
+ */
+static int Ogg_Scan(FileHandle& f, OggScan* s, BOOL keep)
+{
+    ZeroMemory(s, sizeof(*s));
+    s->keep = keep;
+    s->best = -1;
+
+    OggCursor c;
+    if (!Ogg_InitCursor(&c, f)) return 0;
+
+    int headers = 0;
+    int codec = Ogg_Open(&c, &headers);
+    if (codec != OGG_NONE) s_stats.files++;
+
+    if (codec == OGG_VORBIS || codec == OGG_OPUS) {
+        // The comment header is the second packet / Заголовок комментариев - второй пакет
+        BYTE  sig[8];
+        DWORD need = (codec == OGG_VORBIS) ? 7 : 8;
+        if (Ogg_NextPacket(&c) && Ogg_Read(&c, sig, need) == need) {
+            if (codec == OGG_VORBIS ? (sig[0] == 3 && memcmp(sig + 1, "vorbis", 6) == 0)
+                                    : (memcmp(sig, "OpusTags", 8) == 0)) {
+                Ogg_ScanComments(&c, s);
+            }
+        }
+    } else if (codec == OGG_FLAC) {
+        // Every header packet is one metadata block / Каждый пакет заголовка - один блок метаданных
+        for (int i = 0; headers == 0 || i < headers; ++i) {
+            BYTE b[4];
+            if (i >= OGG_MAX_PAGES || !Ogg_NextPacket(&c) || Ogg_Read(&c, b, 4) != 4) break;
+            DWORD len = (b[1] << 16) | (b[2] << 8) | b[3];
+            BYTE  type = b[0] & 0x7F;
+            if (type == 6) Ogg_Picture(&c, s, len, PIC_CODING_OGG, FALSE);
+            else if (type == 4) Ogg_ScanComments(&c, s);
+            if (b[0] & 0x80) break;   // last metadata block / последний блок метаданных
+        }
+    }
+    Ogg_FreeCursor(&c);
+    return s->n;
+}
+
+/**
+ * @brief Read and decode the stored bytes of one picture again
+ * @brief Снова прочитать и декодировать хранимые байты одного изображения
+ *
+ * @return Decoded bytes (GlobalFree) or NULL / Декодированные байты (GlobalFree) или NULL
+ */
+static BYTE* Ogg_LoadStored(FileHandle& f, U64 page, DWORD off, DWORD stored, BYTE coding, DWORD* len)
+{
+    DWORD max = Ogg_DecodedMax(stored, coding);
+    if (!stored || max > OGG_MAX_PICTURE + OGG_HEAD_BYTES) return NULL;
+
+    OggCursor c;
+    if (!Ogg_InitCursor(&c, f)) return NULL;
+    BYTE* buf = NULL;
+    if (Ogg_Seek(&c, page, off)) buf = (BYTE*)GlobalAlloc(GMEM_FIXED, max);
+    if (buf) {
+        OggSink k;
+        Sink_Init(&k, buf, max, (coding & PIC_CODING_BASE64) != 0);
+        if (Ogg_Decode(&c, stored, &k) && Sink_Finish(&k)) {
+            *len = k.len;
+        } else {
+            GlobalFree(buf);
+            buf = NULL;
+        }
+    }
+    Ogg_FreeCursor(&c);
+    return buf;
+}
+
+// Decode the image inside the decoded bytes / Декодировать изображение внутри декодированных байт
+static BOOL Ogg_Show(const BYTE* data, DWORD n, DWORD skip, DWORD len, HBITMAP* phbm, SIZE* psz)
+{
+    if (!data || skip >= n) return FALSE;
+    if (len > n - skip) len = n - skip;   // COVERART length is an upper bound / длина COVERART - верхняя граница
+    s_stats.decodes++;
+    return Img_LoadFromMemoryToBitmap(data + skip, len, phbm, psz);
+}
+
+// ============================================================================
+// Main Functions / Главные функции
+// ============================================================================
+
+BOOL OGG_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz)
+{
+    if (phbm) *phbm = NULL;
+    if (psz) { psz->cx = 0; psz->cy = 0; }
+
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return FALSE;
+
+    OggScan* s = (OggScan*)GlobalAlloc(GMEM_FIXED, sizeof(OggScan));
+    if (!s) return FALSE;
+    Ogg_Scan(f, s, TRUE);
+
+    // The walk already decoded its best picture; the next best is read again only if that fails
+    // Обход уже декодировал лучшее изображение; следующее читается заново, только если оно не удалось
+    BOOL  ok   = FALSE;
+    int   i    = s->best;
+    BYTE* data = s->data;
+    DWORD n    = s->dataLen;
+    if (i < 0) i = PicIndex_Best(s->pics, s->n, sizeof(s->pics[0]));
+    while (i >= 0 && !ok) {
+        OggPicture* pic = &s->pics[i];
+        if (!data) data = Ogg_LoadStored(f, pic->page, pic->off, pic->stored, pic->coding, &n);
+        ok = Ogg_Show(data, n, pic->skip, pic->len, phbm, psz);
+        if (data) GlobalFree(data);
+        data = NULL;
+        pic->cand.failed = !ok;
+        if (!ok) i = PicIndex_Best(s->pics, s->n, sizeof(s->pics[0]));
+    }
+    GlobalFree(s);
+    return ok;
+}
+
+int OGG_IndexPicturesA(const char* audioPath, PictureIndex* idx)
+{
+    if (!idx) return 0;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return 0;
+
+    OggScan* s = (OggScan*)GlobalAlloc(GMEM_FIXED, sizeof(OggScan));
+    if (!s) return 0;
+    int n = Ogg_Scan(f, s, FALSE);
+
+    int added = 0;
+    for (int i = 0; i < n; ++i) {
+        const OggPicture* pic = &s->pics[i];
+        if (PicIndex_AddCoded(idx, pic->page, pic->stored, pic->cand.type, PIC_SRC_OGG,
+                              pic->coding, pic->off, pic->skip, pic->len)) ++added;
+    }
+    GlobalFree(s);
+    return added;
+}
+
+BOOL OGG_LoadEntryA(const char* audioPath, const PictureEntry* e, HBITMAP* phbm, SIZE* psz)
+{
+    if (!e || !(e->coding & PIC_CODING_OGG)) return FALSE;
+    FileHandle f(audioPath);
+    if (!f.IsValid()) return FALSE;
+
+    DWORD n = 0;
+    BYTE* data = Ogg_LoadStored(f, e->offset, e->zpos, e->length, e->coding, &n);
+    BOOL ok = Ogg_Show(data, n, e->skip, e->size, phbm, psz);
+    if (data) GlobalFree(data);
+    return ok;
+}
+
+void OGG_GetStats(OGGStats* out)
+{
+    if (out) *out = s_stats;
+}
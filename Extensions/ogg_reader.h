@@ -0,0 +1,105 @@
+/**
+ * @file ogg_reader.h
+ * @brief Ogg Vorbis / Opus / Ogg FLAC embedded cover art extractor
+ * @brief Экстрактор встроенных обложек Ogg Vorbis / Opus / Ogg FLAC
+ *
+ * Vorbis and Opus keep pictures in the comment header as base64-encoded
+ * METADATA_BLOCK_PICTURE fields (the FLAC PICTURE structure), or as a bare
+ * image in the legacy COVERART field. Ogg FLAC stores native PICTURE blocks as
+ * header packets. Either way a picture may span many Ogg pages.
+ *
+ * Vorbis и Opus хранят изображения в заголовке комментариев как поля
+ * METADATA_BLOCK_PICTURE в base64 (структура FLAC PICTURE) или как голое
+ * изображение в устаревшем поле COVERART. Ogg FLAC хранит обычные блоки PICTURE
+ * как пакеты заголовка. В обоих случаях изображение может занимать много страниц Ogg.
+ *
+ * Reading / Чтение:
+ * - Only the header packets of the first logical stream are walked; each page
+ *   body is read together with the fixed header of the next page, whose lacing
+ *   table is then read on its own, so the walk stops before the first audio
+ *   page body.
+ *   Обходятся только пакеты заголовка первого логического потока; тело каждой
+ *   страницы читается вместе с фиксированным заголовком следующей, чья таблица
+ *   lacing затем читается отдельно, поэтому обход останавливается до тела
+ *   первой аудиостраницы.
+ * - Packets are never reassembled: fields are consumed page by page, and the
+ *   base64 text of a picture is decoded (SSE2 when available) straight into
+ *   the buffer handed to the image decoder.
+ *   Пакеты не собираются целиком: поля потребляются постранично, а base64-текст
+ *   изображения декодируется (SSE2, если доступно) прямо в буфер декодера изображений.
+ * - Each picture is described from its first bytes; the full decode happens
+ *   only for a picture PicIndex_Prefer() ranks best so far.
+ *   Каждое изображение описывается по первым байтам; полное декодирование -
+ *   только для изображения, лучшего на данный момент по PicIndex_Prefer().
+ *
+ * Supported Containers / Поддерживаемые контейнеры:
+ * - .ogg, .oga (Vorbis, FLAC), .opus
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+#include "picture_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reader statistics / Статистика ридера
+ */
+typedef struct {
+    DWORD files;        ///< Ogg streams opened / Открыто потоков Ogg
+    DWORD pages;        ///< Pages walked / Пройдено страниц
+    DWORD reads;        ///< File reads issued / Выполнено чтений файла
+    DWORD bytesRead;    ///< Bytes read / Прочитано байт
+    DWORD pictures;     ///< Pictures described / Описано изображений
+    DWORD base64Bytes;  ///< Bytes produced by the base64 decoder / Байт выдано декодером base64
+    DWORD decodes;      ///< Pictures handed to the decoder / Изображений передано декодеру
+} OGGStats;
+
+/**
+ * @brief Load the best embedded picture of an Ogg file
+ * @brief Загрузить лучшее встроенное изображение файла Ogg
+ *
+ * @param audioPath Path to Ogg file / Путь к файлу Ogg
+ * @param phbm [out] Result bitmap, owned by the caller / Результирующий bitmap, принадлежит вызывающему
+ * @param psz  [out] Result dimensions / Результирующие размеры
+ * @return TRUE on success / TRUE при успехе
+ */
+BOOL OGG_LoadCoverToBitmapA(const char* audioPath, HBITMAP* phbm, SIZE* psz);
+
+/**
+ * @brief Index every picture of the header packets without decoding them
+ * @brief Проиндексировать все изображения пакетов заголовка, не декодируя их
+ *
+ * Entries are PIC_CODING_OGG: offset is the page the picture starts on and
+ * zpos its offset in that page's body; PicIndex_LoadA() hands them back to
+ * OGG_LoadEntryA().
+ * Записи имеют PIC_CODING_OGG: offset - страница, с которой начинается
+ * изображение, zpos - смещение в теле этой страницы; PicIndex_LoadA() передаёт
+ * их обратно в OGG_LoadEntryA().
+ *
+ * @param audioPath Path to Ogg file / Путь к файлу Ogg
+ * @param idx [in,out] Index to append to / Индекс для дополнения
+ * @return Number of pictures added / Количество добавленных изображений
+ */
+int OGG_IndexPicturesA(const char* audioPath, PictureIndex* idx);
+
+/**
+ * @brief Read and decode one picture indexed by OGG_IndexPicturesA()
+ * @brief Прочитать и декодировать одно изображение, проиндексированное OGG_IndexPicturesA()
+ */
+BOOL OGG_LoadEntryA(const char* audioPath, const PictureEntry* e, HBITMAP* phbm, SIZE* psz);
+
+/**
+ * @brief Copy reader statistics / Скопировать статистику ридера
+ */
+void OGG_GetStats(OGGStats* out);
+
+#ifdef __cplusplus
+}
+#endif
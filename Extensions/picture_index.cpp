@@ -0,0 +1,154 @@
+/**
+ * @file picture_index.cpp
+ * @brief Picture index implementation
+ * @brief Реализация индекса изображений
+ */
+
+#include "picture_index.h"
+#include "id3v2_reader.h"
+#include "flac_reader.h"
+#include "mp4_reader.h"
+#include "ape_reader.h"
+#include "ogg_reader.h"
+#include "asf_reader.h"
+#include "mkv_reader.h"
+#include "zlib_inflate.h"
+#include "..\image_loader.h"
+#include "..\utils_common.h"
+
+#define PICINDEX_MAX_BYTES (32 * 1024 * 1024)   // same limit as the readers / тот же предел, что у ридеров
+
+static SIZE s_target = {0, 0};
+
+void PicIndex_SetTargetSize(int cx, int cy)
+{
+    s_target.cx = (cx > 0) ? cx : 0;
+    s_target.cy = (cy > 0) ? cy : 0;
+}
+
+static int TypeRank(BYTE type)
+{
+    switch (type) {
+    case PIC_TYPE_FRONT: return 0;
+    case PIC_TYPE_OTHER: return 1;
+    case PIC_TYPE_BACK:  return 3;
+    case 1: case 2:      return 4;   // 32x32 file icon, other file icon / иконки файла
+    default:             return 2;   // leaflet, media, artist... / буклет, носитель, исполнитель...
+    }
+}
+
+// Fills the view without upscaling / Заполняет окно без увеличения
+static BOOL Covers(SIZE d)
+{
+    if (d.cx <= 0 || d.cy <= 0) return FALSE;
+    if (!s_target.cx || !s_target.cy) return FALSE;
+    return d.cx >= s_target.cx || d.cy >= s_target.cy;
+}
+
+BOOL PicIndex_Prefer(BYTE type, SIZE dim, BYTE bestType, SIZE bestDim)
+{
+    int ra = TypeRank(type), rb = TypeRank(bestType);
+    if (ra != rb) return ra < rb;
+
+    BOOL ca = Covers(dim), cb = Covers(bestDim);
+    if (ca != cb) return ca;
+
+    double aa = (double)dim.cx * dim.cy, ab = (double)bestDim.cx * bestDim.cy;
+    return ca ? (aa < ab) : (aa > ab);
+}
+
+int PicIndex_Best(const void* pics, int n, DWORD stride)
+{
+    int best = -1;
+    const PictureCandidate* b = NULL;
+    for (int i = 0; i < n; ++i) {
+        const PictureCandidate* c = (const PictureCandidate*)((const BYTE*)pics + i * stride);
+        if (c->failed) continue;
+        if (!b || PicIndex_Prefer(c->type, c->dim, b->type, b->dim) ||
+            (c->tie < b->tie && !PicIndex_Prefer(b->type, b->dim, c->type, c->dim))) {
+            best = i;
+            b = c;
+        }
+    }
+    return best;
+}
+
+BOOL PicIndex_Add(PictureIndex* idx, unsigned __int64 offset, DWORD length, BYTE type, BYTE source)
+{
+    return PicIndex_AddCoded(idx, offset, length, type, source, PIC_CODING_NONE, 0, 0, length);
+}
+
+BOOL PicIndex_AddCoded(PictureIndex* idx, unsigned __int64 offset, DWORD length, BYTE type, BYTE source,
+                       BYTE coding, DWORD zpos, DWORD skip, DWORD size)
+{
+    if (!idx || idx->count >= PICINDEX_MAX) return FALSE;
+    if (length == 0 || length > PICINDEX_MAX_BYTES) return FALSE;
+    if (size == 0 || size > PICINDEX_MAX_BYTES) return FALSE;
+
+    PictureEntry* e = &idx->items[idx->count++];
+    e->offset = offset;
+    e->length = length;
+    e->type   = type;
+    e->source = source;
+    e->coding = coding;
+    e->zpos   = zpos;
+    e->skip   = skip;
+    e->size   = size;
+    return TRUE;
+}
+
+int PicIndex_BuildA(const char* path, PictureIndex* out)
+{
+    if (!out) return 0;
+    ZeroMemory(out, sizeof(*out));
+    if (!path || !*path) return 0;
+
+    // An MP3 may carry both ID3v2 and APEv2, so every reader gets its turn
+    // В MP3 могут быть и ID3v2, и APEv2, поэтому опрашиваются все ридеры
+    ID3v2_IndexPicturesA(path, out);
+    FLAC_IndexPicturesA (path, out);
+    MP4_IndexPicturesA  (path, out);
+    APE_IndexPicturesA  (path, out);
+    OGG_IndexPicturesA  (path, out);
+    ASF_IndexPicturesA  (path, out);
+    MKV_IndexPicturesA  (path, out);
+    return out->count;
+}
+
+BOOL PicIndex_LoadA(const char* path, const PictureEntry* e, HBITMAP* phbm, SIZE* psz)
+{
+    if (!path || !e || !e->length || e->length > PICINDEX_MAX_BYTES) return FALSE;
+    if (e->coding & PIC_CODING_OGG) return OGG_LoadEntryA(path, e, phbm, psz);
+
+    FileHandle f(path);
+    if (!f.IsValid()) return FALSE;
+
+    BYTE* buf = (BYTE*)GlobalAlloc(GMEM_FIXED, e->length);
+    if (!buf) return FALSE;
+
+    BOOL ok = FALSE;
+    if (f.ReadAt(e->offset, buf, e->length)) {
+        // Decoding only shrinks the data, so it is done in place
+        // Декодирование только уменьшает данные, поэтому выполняется на месте
+        DWORD n = e->length;
+        const BYTE* data = buf;
+        if (e->coding & PIC_CODING_UNSYNC) n = ID3v2_Resync(buf, n);
+
+        // Inflate exactly up to the end of the image, no further
+        // Распаковать ровно до конца изображения, не дальше
+        if (e->coding & PIC_CODING_ZLIB) {
+            DWORD want = e->skip + e->size;
+            BYTE* out  = (e->zpos < n && want >= e->skip) ? Inflate_Scratch(want) : NULL;
+            DWORD got  = 0;
+            int r = out ? Inflate_Zlib(buf + e->zpos, n - e->zpos, out, want, &got) : INFLATE_ERROR;
+            data = (r != INFLATE_ERROR) ? out : NULL;
+            n    = got;
+        }
+        if (data && e->skip <= n && e->size <= n - e->skip) {
+            ok = Img_LoadFromMemoryToBitmap(data + e->skip, e->size, phbm, psz);
+        }
+    }
+    Inflate_ReleaseScratch(FALSE);
+    GlobalFree(buf);
+    return ok;
+}
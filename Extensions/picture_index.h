@@ -0,0 +1,187 @@
+/**
+ * @file picture_index.h
+ * @brief Header-only index of all pictures embedded in a track
+ * @brief Индекс всех встроенных в трек изображений (только по заголовкам)
+ *
+ * ID3v2 APIC, FLAC PICTURE, MP4 covr, APEv2 binary items and Ogg
+ * METADATA_BLOCK_PICTURE comments can all hold several pictures (front, back, booklet, disc). The index records where the
+ * image bytes of each one live in the file without reading them, so the
+ * picture strip can list everything and decode a picture only when it is
+ * actually shown.
+ *
+ * ID3v2 APIC, FLAC PICTURE, MP4 covr, бинарные элементы APEv2 и комментарии Ogg
+ * METADATA_BLOCK_PICTURE могут хранить несколько изображений (лицевая, задняя, буклет, диск). Индекс запоминает, где
+ * в файле лежат байты каждого изображения, не читая их, поэтому лента картинок
+ * может показать всё и декодировать картинку только когда её действительно видно.
+ *
+ * Pictures stored unsynchronised or compressed (ID3v2) are indexed by their
+ * stored range and decoded back on load; the entry says which bytes of the
+ * result are the image. Encrypted frames are not indexed.
+ * Изображения, хранящиеся unsynchronised или сжатыми (ID3v2), индексируются по
+ * хранимому диапазону и декодируются обратно при загрузке; запись указывает,
+ * какие байты результата являются изображением. Зашифрованные фреймы не индексируются.
+ *
+ * Ogg pictures are interleaved with page headers, so their entries point at
+ * the first page and are read back by the Ogg reader.
+ * Изображения Ogg перемежаются заголовками страниц, поэтому их записи указывают
+ * на первую страницу и читаются обратно ридером Ogg.
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PICINDEX_MAX 32   ///< Pictures kept per track / Изображений на трек
+
+/// Picture types (ID3v2/FLAC numbering) / Типы изображений (нумерация ID3v2/FLAC)
+#define PIC_TYPE_OTHER  0
+#define PIC_TYPE_FRONT  3
+#define PIC_TYPE_BACK   4
+
+/// Tag the picture was found in / Тег, в котором найдено изображение
+#define PIC_SRC_ID3V2   1
+#define PIC_SRC_FLAC    2
+#define PIC_SRC_MP4     3
+#define PIC_SRC_APE     4
+#define PIC_SRC_OGG     5
+#define PIC_SRC_ASF     6
+#define PIC_SRC_MKV     7
+
+/// How the stored bytes are coded (bit mask) / Как закодированы хранимые байты (битовая маска)
+#define PIC_CODING_NONE    0
+#define PIC_CODING_UNSYNC  1   ///< ID3v2 unsynchronisation / Unsynchronisation ID3v2
+#define PIC_CODING_ZLIB    2   ///< zlib stream, inflated after unsynchronisation / Поток zlib, распаковывается после unsynchronisation
+#define PIC_CODING_OGG     4   ///< Spread over Ogg pages: offset = first page, zpos = offset in its body / Разнесено по страницам Ogg: offset = первая страница, zpos = смещение в её теле
+#define PIC_CODING_BASE64  8   ///< Stored as base64 text / Хранится как текст base64
+
+/**
+ * @brief Location of one embedded picture / Расположение одного встроенного изображения
+ */
+typedef struct {
+    unsigned __int64 offset;  ///< File offset of the stored bytes / Смещение хранимых байтов в файле
+    DWORD length;             ///< Stored size in bytes / Хранимый размер в байтах
+    BYTE  type;               ///< PIC_TYPE_* (0..20) / Тип изображения
+    BYTE  source;             ///< PIC_SRC_* / Источник
+    BYTE  coding;             ///< PIC_CODING_* / Кодирование
+    DWORD zpos;               ///< zlib stream start in the resynchronised bytes / Начало потока zlib в декодированных байтах
+    DWORD skip;               ///< Decoded bytes before the image / Декодированных байт перед изображением
+    DWORD size;               ///< Image size once decoded / Размер изображения после декодирования
+} PictureEntry;
+
+/**
+ * @brief Pictures of one track in file order / Изображения трека в порядке следования в файле
+ */
+typedef struct {
+    int          count;
+    PictureEntry items[PICINDEX_MAX];
+} PictureIndex;
+
+/**
+ * @brief What the ranking needs to know about one candidate of a tag reader
+ * @brief Что нужно ранжированию об одном кандидате ридера тегов
+ *
+ * Readers put it first in their own picture description, so one array of
+ * those can be ranked by PicIndex_Best().
+ * Ридеры ставят его первым полем своего описания изображения, чтобы массив
+ * таких описаний можно было ранжировать через PicIndex_Best().
+ */
+typedef struct {
+    BYTE type;     ///< PIC_TYPE_* as ranked / PIC_TYPE_* для ранжирования
+    BYTE tie;      ///< Decides between equals, lower wins / Решает между равными, меньший побеждает
+    SIZE dim;      ///< From the image header, 0 = unknown / Из заголовка изображения, 0 = неизвестно
+    BOOL failed;   ///< Decode was tried and failed / Декодирование пробовали, оно не удалось
+} PictureCandidate;
+
+/**
+ * @brief Set the view size pictures are chosen for
+ * @brief Задать размер окна, под который выбираются изображения
+ *
+ * @param cx, cy View size in physical pixels, 0 = unknown / Размер окна в физических пикселях, 0 = неизвестен
+ */
+void PicIndex_SetTargetSize(int cx, int cy);
+
+/**
+ * @brief Ranking policy shared by the tag readers
+ * @brief Политика ранжирования, общая для ридеров тегов
+ *
+ * Front cover first, then generic pictures, other artwork, back cover, and
+ * file icons last. Within a type, a picture that fills the view without
+ * upscaling beats one that doesn't; among those the smaller one wins (less
+ * to decode), otherwise the larger one. A zero size means "unknown".
+ *
+ * Сначала лицевая обложка, затем общие изображения, прочие, задняя обложка,
+ * иконки файла последними. Внутри типа изображение, заполняющее окно без
+ * увеличения, лучше того, что не заполняет; из таких побеждает меньшее (меньше
+ * декодировать), иначе большее. Нулевой размер означает "неизвестен".
+ *
+ * @return TRUE if (type, dim) should be preferred to (bestType, bestDim)
+ * @return TRUE если (type, dim) предпочтительнее (bestType, bestDim)
+ */
+BOOL PicIndex_Prefer(BYTE type, SIZE dim, BYTE bestType, SIZE bestDim);
+
+/**
+ * @brief Best candidate by PicIndex_Prefer(), then by tie, skipping failed ones
+ * @brief Лучший кандидат по PicIndex_Prefer(), затем по tie, пропуская неудачные
+ *
+ * @param pics   First description; each starts with a PictureCandidate / Первое описание; каждое начинается с PictureCandidate
+ * @param n      Descriptions / Описаний
+ * @param stride Size of one description / Размер одного описания
+ * @return Candidate number or -1 / Номер кандидата или -1
+ */
+int PicIndex_Best(const void* pics, int n, DWORD stride);
+
+/**
+ * @brief Append an entry (used by the tag readers)
+ * @brief Добавить запись (используется ридерами тегов)
+ *
+ * @return FALSE if the index is full or the entry is invalid / FALSE если индекс полон или запись некорректна
+ */
+BOOL PicIndex_Add(PictureIndex* idx, unsigned __int64 offset, DWORD length, BYTE type, BYTE source);
+
+/**
+ * @brief Append an entry whose stored bytes must be decoded first
+ * @brief Добавить запись, хранимые байты которой нужно сначала декодировать
+ *
+ * @param offset, length Stored range in the file / Хранимый диапазон в файле
+ * @param coding PIC_CODING_* / Кодирование
+ * @param zpos   Start of the zlib stream (PIC_CODING_ZLIB) / Начало потока zlib (PIC_CODING_ZLIB)
+ * @param skip, size     Image inside the decoded bytes / Изображение внутри декодированных байт
+ */
+BOOL PicIndex_AddCoded(PictureIndex* idx, unsigned __int64 offset, DWORD length, BYTE type, BYTE source,
+                       BYTE coding, DWORD zpos, DWORD skip, DWORD size);
+
+/**
+ * @brief Index the pictures of every supported tag in a file
+ * @brief Проиндексировать изображения всех поддерживаемых тегов файла
+ *
+ * Only tag and frame headers are read; no image byte is touched.
+ * Читаются только заголовки тегов и фреймов; байты изображений не трогаются.
+ *
+ * @param path Audio file / Аудиофайл
+ * @param out  [out] Index (cleared first) / Индекс (сначала очищается)
+ * @return Number of pictures found / Количество найденных изображений
+ */
+int PicIndex_BuildA(const char* path, PictureIndex* out);
+
+/**
+ * @brief Read and decode one indexed picture
+ * @brief Прочитать и декодировать одно проиндексированное изображение
+ *
+ * @param path Audio file the index was built from / Аудиофайл, по которому построен индекс
+ * @param e    Entry to decode / Декодируемая запись
+ * @param phbm [out] Bitmap, owned by the caller / Bitmap, принадлежит вызывающему
+ * @param psz  [out] Bitmap size / Размер bitmap'а
+ * @return TRUE on success / TRUE при успехе
+ */
+BOOL PicIndex_LoadA(const char* path, const PictureEntry* e, HBITMAP* phbm, SIZE* psz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,191 @@
+/**
+ * @file tag_tail.cpp
+ * @brief Trailing tag locator implementation
+ * @brief Реализация поиска завершающих тегов
+ */
+
+#include "tag_tail.h"
+#include "..\utils_common.h"
+#include "..\pixel_ops.h"
+#include <emmintrin.h>
+
+typedef unsigned __int64 U64;
+
+static char         s_path[MAX_PATH] = {0};
+static FILETIME     s_time  = {0, 0};
+static TagTail      s_tail;
+static BOOL         s_valid = FALSE;
+static TagTailStats s_stats = {0};
+
+// Bytes [pos, pos + n) from the window, or one small read outside it
+// Байты [pos, pos + n) из окна, или одно короткое чтение вне его
+static BOOL TailBytes(const TagTail* t, HANDLE file, U64 pos, DWORD n, BYTE* out)
+{
+    if (pos > t->fileSize || n > t->fileSize - pos) return FALSE;
+    if (pos >= t->pos && pos + n <= t->pos + t->len) {
+        CopyMemory(out, t->data + (DWORD)(pos - t->pos), n);
+        return TRUE;
+    }
+    s_stats.trailerReads++;
+    return ReadFileAt(file, pos, out, n);
+}
+
+/**
+ * @brief Locate the trailers from their size fields: ID3v1, then APEv2 and Lyrics3v2 in either order
+ * @brief Найти завершающие блоки по их полям размера: ID3v1, затем APEv2 и Lyrics3v2 в любом порядке
+ */
+static void TailLayout(TagTail* t, HANDLE file)
+{
+    BYTE b[32];
+    U64  end = t->fileSize;
+    ZeroMemory(&t->ape, sizeof(t->ape));
+
+    if (end >= 128 && TailBytes(t, file, end - 128, 3, b) && memcmp(b, "TAG", 3) == 0) end -= 128;
+    t->tagsEnd = end;
+
+    for (int step = 0; step < 3; ++step) {
+        if (end >= 32 && TailBytes(t, file, end - 32, 32, b) && memcmp(b, "APETAGEX", 8) == 0) {
+            DWORD sz = LE32(b + 12);
+            if (sz >= 32 && sz <= end) {
+                t->ape.footer = end - 32;
+                t->ape.size   = sz;
+                t->ape.items  = LE32(b + 16);
+                t->ape.flags  = LE32(b + 20);
+            }
+            return;
+        }
+
+        // Lyrics3v2: "LYRICSBEGIN" ... size(6 digits) "LYRICS200", size counting from LYRICSBEGIN
+        // Lyrics3v2: "LYRICSBEGIN" ... размер(6 цифр) "LYRICS200", размер считается от LYRICSBEGIN
+        if (end < 15 + 11 || !TailBytes(t, file, end - 15, 15, b) || memcmp(b + 6, "LYRICS200", 9) != 0) return;
+        DWORD sz = 0;
+        for (int i = 0; i < 6; ++i) {
+            if (b[i] < '0' || b[i] > '9') return;
+            sz = sz * 10 + (b[i] - '0');
+        }
+        if (sz < 11 || sz > end - 15 || !TailBytes(t, file, end - 15 - sz, 11, b) ||
+            memcmp(b, "LYRICSBEGIN", 11) != 0) return;
+
+        end -= sz + 15;
+        t->tagsEnd = end;
+    }
+}
+
+BOOL TagTail_Get(const char* path, HANDLE file, TagTail* out)
+{
+    if (!path || !out || file == INVALID_HANDLE_VALUE) return FALSE;
+
+    U64 size = FileSize64(file);
+    if (size == 0) return FALSE;
+    FILETIME wt = {0, 0};
+    GetFileTime(file, NULL, NULL, &wt);
+
+    if (s_valid && s_tail.fileSize == size && CompareFileTime(&s_time, &wt) == 0 &&
+        lstrcmpiA(s_path, path) == 0) {
+        s_stats.hits++;
+        CopyMemory(out, &s_tail, sizeof(*out));
+        return TRUE;
+    }
+
+    s_valid = FALSE;
+    s_tail.fileSize = size;
+    s_tail.len = (size > TAGTAIL_BYTES) ? TAGTAIL_BYTES : (DWORD)size;
+    s_tail.pos = size - s_tail.len;
+    if (!ReadFileAt(file, s_tail.pos, s_tail.data, s_tail.len)) return FALSE;
+    s_stats.reads++;
+    TailLayout(&s_tail, file);
+
+    lstrcpynA(s_path, path, MAX_PATH);
+    s_time  = wt;
+    s_valid = TRUE;
+    CopyMemory(out, &s_tail, sizeof(*out));
+    return TRUE;
+}
+
+// Validated footer at data[i] / Проверенный footer в data[i]
+static BOOL ApeFooterAt(const TagTail* t, int i, TagTailApe* out)
+{
+    const BYTE* p = &t->data[i];
+    if (memcmp(p, "APETAGEX", 8) != 0) return FALSE;
+    DWORD sz = LE32(p + 12); // Tag Size (including footer)
+    // Validate size
+    // Валидация размера
+    if (sz < 32 || sz > t->fileSize || t->pos + i + 32 < sz) return FALSE;
+    out->footer = t->pos + i;
+    out->size   = sz;
+    out->items  = LE32(p + 16);
+    out->flags  = LE32(p + 20);
+    return TRUE;
+}
+
+BOOL TagTail_FindApe(const TagTail* t, TagTailApe* out)
+{
+    if (!t || !out) return FALSE;
+    if (t->ape.footer) {
+        *out = t->ape;
+        return TRUE;
+    }
+    if (t->len < 32) return FALSE;
+
+    // Fallback: search for "APETAGEX" backwards, 16 candidate positions per step
+    // Запасной путь: ищем "APETAGEX" с конца, по 16 позиций-кандидатов за шаг
+    s_stats.scans++;
+    int i = (int)t->len - 32;
+    if (Pix_HasSSE2()) {
+        const __m128i a = _mm_set1_epi8('A');
+        for (; i >= 15; i -= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(t->data + i - 15));
+            int m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, a));
+            for (int bit = 15; m && bit >= 0; --bit) {
+                if (!(m & (1 << bit))) continue;
+                m &= ~(1 << bit);
+                if (ApeFooterAt(t, i - 15 + bit, out)) return TRUE;
+            }
+        }
+    }
+    for (; i >= 0; --i) {
+        if (t->data[i] == 'A' && ApeFooterAt(t, i, out)) return TRUE;
+    }
+    return FALSE;
+}
+
+// "3DI" footer ending exactly at @end / Footer "3DI", заканчивающийся ровно в @end
+static BOOL Id3FooterAt(const TagTail* t, HANDLE file, U64 end, U64* tagPos)
+{
+    BYTE p[10];
+    if (end < 10 || !TailBytes(t, file, end - 10, 10, p)) return FALSE;
+    if (memcmp(p, "3DI", 3) != 0 || p[3] != 4 || p[4] == 0xFF) return FALSE;
+    if ((p[6] | p[7] | p[8] | p[9]) & 0x80) return FALSE;   // not syncsafe / не syncsafe
+
+    // header (10) + tag + footer (10) / заголовок (10) + тег + footer (10)
+    DWORD total = SyncSafeToInt(p + 6) + 20;
+    if (total > end) return FALSE;
+    *tagPos = end - total;
+    return TRUE;
+}
+
+BOOL TagTail_FindId3v2(const TagTail* t, HANDLE file, U64* tagPos)
+{
+    if (!t || !tagPos) return FALSE;
+    U64 end = t->fileSize;
+
+    // 1. Right at the end / В самом конце
+    if (Id3FooterAt(t, file, end, tagPos)) return TRUE;
+
+    // 2. Before ID3v1 and Lyrics3v2 / Перед ID3v1 и Lyrics3v2
+    if (t->tagsEnd != end && Id3FooterAt(t, file, t->tagsEnd, tagPos)) return TRUE;
+
+    // 3. Before APEv2 (its header too, if it has one) / Перед APEv2 (и его заголовком, если есть)
+    TagTailApe ape;
+    if (TagTail_FindApe(t, &ape)) {
+        U64 start = ape.footer + 32 - ape.size;
+        if (ape.flags & 0x80000000) start -= (start >= 32) ? 32 : start;
+        if (Id3FooterAt(t, file, start, tagPos)) return TRUE;
+    }
+    return FALSE;
+}
+
+void TagTail_GetStats(TagTailStats* out)
+{
+    if (out) *out = s_stats;
+}
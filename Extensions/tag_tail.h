@@ -0,0 +1,127 @@
+/**
+ * @file tag_tail.h
+ * @brief Shared read of the end of an audio file, where trailing tags live
+ * @brief Общее чтение конца аудиофайла, где находятся завершающие теги
+ *
+ * APEv2, ID3v1 and appended ID3v2.4 tags (marked by a "3DI" footer) all sit
+ * at the end of the file. The last 4 KB are read once per file and kept in
+ * a one-entry cache, so the ID3v2 reader looking for an appended tag and the
+ * APE reader looking for its footer share the same read. The cache is keyed
+ * by path, size and last write time.
+ *
+ * APEv2, ID3v1 и дописанные в конец теги ID3v2.4 (отмеченные footer'ом "3DI")
+ * находятся в конце файла. Последние 4 КБ читаются один раз на файл и хранятся
+ * в кэше на одну запись, поэтому ридер ID3v2, ищущий дописанный тег, и ридер
+ * APE, ищущий свой footer, используют одно и то же чтение. Ключ кэша - путь,
+ * размер и время последней записи.
+ *
+ * Trailers are located by their own size fields, not by scanning: ID3v1 is
+ * the last 128 bytes, Lyrics3v2 ends with a 6-digit size and "LYRICS200",
+ * and the APEv2 footer is the 32 bytes before them (either order of APE and
+ * Lyrics3). A footer outside the 4 KB window costs one 32-byte read. Only if
+ * that finds nothing is the window searched for "APETAGEX".
+ * Завершающие блоки находятся по их собственным полям размера, а не
+ * сканированием: ID3v1 - последние 128 байт, Lyrics3v2 заканчивается 6-значным
+ * размером и "LYRICS200", footer APEv2 - 32 байта перед ними (APE и Lyrics3 в
+ * любом порядке). Footer вне окна 4 КБ стоит одного чтения 32 байт. Только если
+ * так ничего не найдено, окно просматривается в поисках "APETAGEX".
+ *
+ * @warning Not thread-safe: the tag readers run on the UI thread
+ * @warning Не потокобезопасно: ридеры тегов работают в UI-потоке
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TAGTAIL_BYTES 4096   ///< Bytes read from the end of the file / Байт, читаемых с конца файла
+
+/**
+ * @brief APEv2 footer / Footer APEv2
+ */
+typedef struct {
+    unsigned __int64 footer;   ///< File offset of the 32-byte footer, 0 = none / Смещение 32-байтового footer'а, 0 = нет
+    DWORD size;     ///< Tag size including the footer, excluding the header / Размер тега с footer'ом, без заголовка
+    DWORD items;    ///< Item count / Количество элементов
+    DWORD flags;    ///< Bit 31: the tag has a header / Бит 31: у тега есть заголовок
+} TagTailApe;
+
+/**
+ * @brief End of a file / Конец файла
+ */
+typedef struct {
+    unsigned __int64 fileSize;  ///< Whole file size / Размер всего файла
+    unsigned __int64 pos;       ///< File offset of data[0] / Смещение data[0] в файле
+    DWORD len;                  ///< Valid bytes in data / Действительных байт в data
+    unsigned __int64 tagsEnd;   ///< Start of the ID3v1/Lyrics3v2 trailers / Начало завершающих ID3v1/Lyrics3v2
+    TagTailApe ape;             ///< APEv2 footer located from the trailers / Footer APEv2, найденный по завершающим блокам
+    BYTE  data[TAGTAIL_BYTES];  ///< Last bytes of the file / Последние байты файла
+} TagTail;
+
+/**
+ * @brief Tail cache statistics / Статистика кэша конца файла
+ */
+typedef struct {
+    DWORD reads;          ///< Tails read from disk / Прочитано с диска
+    DWORD hits;           ///< Tails served from the cache / Взято из кэша
+    DWORD trailerReads;   ///< Small reads of trailers outside the window / Короткие чтения блоков вне окна
+    DWORD scans;          ///< Fallback signature searches / Запасных поисков сигнатуры
+} TagTailStats;
+
+/**
+ * @brief Get the end of a file, from the cache if it is unchanged
+ * @brief Получить конец файла, из кэша если файл не изменился
+ *
+ * @param path Path the handle was opened with (cache key) / Путь, по которому открыт дескриптор (ключ кэша)
+ * @param file Open file handle / Открытый дескриптор файла
+ * @param out  [out] Tail / Конец файла
+ * @return TRUE on success / TRUE при успехе
+ */
+BOOL TagTail_Get(const char* path, HANDLE file, TagTail* out);
+
+/**
+ * @brief Find an APEv2 footer / Найти footer APEv2
+ *
+ * Uses the footer located from the trailers; otherwise searches the window
+ * backwards for "APETAGEX" (SSE2 when available).
+ * Использует footer, найденный по завершающим блокам; иначе ищет "APETAGEX"
+ * в окне с конца (SSE2, если доступно).
+ *
+ * @param out [out] Footer / Footer
+ * @return TRUE if found / TRUE если найден
+ */
+BOOL TagTail_FindApe(const TagTail* t, TagTailApe* out);
+
+/**
+ * @brief Find an ID3v2.4 tag appended to the end of the file
+ * @brief Найти тег ID3v2.4, дописанный в конец файла
+ *
+ * The "3DI" footer is looked for right before the end of the file, before the
+ * ID3v1/Lyrics3v2 trailers and before an APEv2 tag - no scanning. A footer
+ * outside the window (behind a large APEv2 or Lyrics3v2 block) costs one
+ * 10-byte read.
+ * Footer "3DI" ищется прямо перед концом файла, перед завершающими ID3v1/Lyrics3v2
+ * и перед тегом APEv2 - без сканирования. Footer вне окна (за большим блоком
+ * APEv2 или Lyrics3v2) стоит одного чтения 10 байт.
+ *
+ * @param file   Open file handle / Открытый дескриптор файла
+ * @param tagPos [out] File offset of the tag header / Смещение заголовка тега в файле
+ * @return TRUE if found / TRUE если найден
+ */
+BOOL TagTail_FindId3v2(const TagTail* t, HANDLE file, unsigned __int64* tagPos);
+
+/**
+ * @brief Copy cache statistics / Скопировать статистику кэша
+ */
+void TagTail_GetStats(TagTailStats* out);
+
+#ifdef __cplusplus
+}
+#endif
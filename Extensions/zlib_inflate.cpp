@@ -0,0 +1,413 @@
+/**
+ * @file zlib_inflate.cpp
+ * @brief Bounded zlib/deflate decoder implementation
+ * @brief Реализация ограниченного декодера zlib/deflate
+ *
+ * Canonical Huffman decoding as in RFC 1951. Codes up to 9 bits are resolved
+ * with one table lookup; longer ones are walked bit by bit, which is rare
+ * enough not to matter for picture data.
+ * Каноническое декодирование Хаффмана по RFC 1951. Коды до 9 бит разрешаются
+ * одним обращением к таблице; более длинные обходятся побитно, что для данных
+ * изображений встречается достаточно редко.
+ */
+
+#include "zlib_inflate.h"
+
+#define INFLATE_KEEP_BYTES (1024 * 1024)   // scratch kept between calls / буфер, сохраняемый между вызовами
+
+#define MAXBITS    15    // longest code / самый длинный код
+#define MAXLCODES  286   // literal/length codes / кодов литералов/длин
+#define MAXDCODES  30    // distance codes / кодов расстояний
+#define FIXLCODES  288   // fixed literal/length table / фиксированная таблица литералов/длин
+#define FAST_BITS  9     // bits resolved by one lookup / бит, разрешаемых одним поиском
+
+/**
+ * @brief Canonical Huffman code / Канонический код Хаффмана
+ */
+typedef struct {
+    WORD count[MAXBITS + 1];        ///< Codes per length ([0] = unused symbols) / Кодов каждой длины ([0] = неиспользуемые)
+    WORD symbol[FIXLCODES];         ///< Symbols in code order / Символы в порядке кодов
+    WORD fast[1 << FAST_BITS];      ///< (length << 12) | symbol, 0 = walk / (длина << 12) | символ, 0 = обход
+} Huff;
+
+/**
+ * @brief Decoder state / Состояние декодера
+ */
+typedef struct {
+    const BYTE* in;
+    DWORD       inLen, inPos;
+    DWORD       bits;               ///< Bit buffer, LSB first / Битовый буфер, младшие биты первыми
+    int         nbits;
+    BYTE*       out;
+    DWORD       outMax, outLen;
+} Inf;
+
+static const WORD kLenBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const BYTE kLenExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const WORD kDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const BYTE kDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static Huff         s_fixLen, s_fixDist;
+static BOOL         s_fixReady   = FALSE;
+static BYTE*        s_scratch    = NULL;
+static DWORD        s_scratchCap = 0;
+static InflateStats s_stats      = {0};
+
+// ============================================================================
+// Bits / Биты
+// ============================================================================
+
+static void Inf_Fill(Inf* s)
+{
+    while (s->nbits <= 24 && s->inPos < s->inLen) {
+        s->bits |= (DWORD)s->in[s->inPos++] << s->nbits;
+        s->nbits += 8;
+    }
+}
+
+// n <= 16; -1 past the end of the input / -1 за концом входа
+static int Inf_Bits(Inf* s, int n)
+{
+    if (s->nbits < n) {
+        Inf_Fill(s);
+        if (s->nbits < n) return -1;
+    }
+    int v = (int)(s->bits & ((1UL << n) - 1));
+    s->bits >>= n;
+    s->nbits -= n;
+    return v;
+}
+
+// ============================================================================
+// Huffman Codes / Коды Хаффмана
+// ============================================================================
+
+/**
+ * @return 0 = complete code, > 0 = incomplete, < 0 = over-subscribed
+ * @return 0 = полный код, > 0 = неполный, < 0 = переполненный
+ */
+static int Huff_Build(Huff* h, const BYTE* len, int n)
+{
+    ZeroMemory(h, sizeof(*h));
+    for (int i = 0; i < n; ++i) h->count[len[i]]++;
+    if (h->count[0] == n) return 0;
+
+    int left = 1;
+    for (int b = 1; b <= MAXBITS; ++b) {
+        left <<= 1;
+        left -= h->count[b];
+        if (left < 0) return left;
+    }
+
+    WORD offs[MAXBITS + 1];
+    int  next[MAXBITS + 1];
+    offs[1] = 0;
+    for (int b = 1; b < MAXBITS; ++b) offs[b + 1] = (WORD)(offs[b] + h->count[b]);
+    int code = 0;
+    for (int b = 1; b <= MAXBITS; ++b) {
+        code = (code + (b > 1 ? h->count[b - 1] : 0)) << 1;
+        next[b] = code;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        int l = len[i];
+        if (!l) continue;
+        h->symbol[offs[l]++] = (WORD)i;
+
+        // Codes are sent MSB first, the bit buffer is LSB first: index by the reversed code
+        // Коды передаются старшим битом вперёд, буфер - младшим: индекс по обращённому коду
+        int c = next[l]++;
+        if (l <= FAST_BITS) {
+            int r = 0;
+            for (int k = 0; k < l; ++k) r |= ((c >> k) & 1) << (l - 1 - k);
+            for (int k = r; k < (1 << FAST_BITS); k += 1 << l) h->fast[k] = (WORD)((l << 12) | i);
+        }
+    }
+    return left;
+}
+
+static int Huff_Decode(Inf* s, const Huff* h)
+{
+    if (s->nbits < FAST_BITS) Inf_Fill(s);
+    WORD e = h->fast[s->bits & ((1 << FAST_BITS) - 1)];
+    if (e && (int)(e >> 12) <= s->nbits) {
+        s->bits >>= e >> 12;
+        s->nbits -= e >> 12;
+        return e & 0x1FF;
+    }
+
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= MAXBITS; ++len) {
+        int b = Inf_Bits(s, 1);
+        if (b < 0) return -1;
+        code |= b;
+        int count = h->count[len];
+        if (code - count < first) return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code  <<= 1;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Blocks / Блоки
+// ============================================================================
+
+// 0 = block done, 1 = output full, -1 = corrupt / 0 = блок готов, 1 = выход заполнен, -1 = повреждён
+static int Inf_Stored(Inf* s)
+{
+    s->bits  >>= s->nbits & 7;
+    s->nbits  -= s->nbits & 7;
+    int len  = Inf_Bits(s, 16);
+    int nlen = Inf_Bits(s, 16);
+    if (len < 0 || nlen < 0 || (len ^ 0xFFFF) != nlen) return -1;
+
+    // Whole bytes already in the bit buffer come first
+    // Сначала целые байты, уже находящиеся в битовом буфере
+    while (len > 0 && s->nbits >= 8) {
+        if (s->outLen >= s->outMax) return 1;
+        s->out[s->outLen++] = (BYTE)s->bits;
+        s->bits >>= 8;
+        s->nbits -= 8;
+        --len;
+    }
+    if ((DWORD)len > s->inLen - s->inPos) return -1;
+
+    DWORD room = s->outMax - s->outLen;
+    DWORD n = ((DWORD)len < room) ? (DWORD)len : room;
+    CopyMemory(s->out + s->outLen, s->in + s->inPos, n);
+    s->outLen += n;
+    s->inPos  += n;
+    return (n < (DWORD)len) ? 1 : 0;
+}
+
+static int Inf_Codes(Inf* s, const Huff* lc, const Huff* dc)
+{
+    for (;;) {
+        int sym = Huff_Decode(s, lc);
+        if (sym < 0) return -1;
+        if (sym < 256) {
+            if (s->outLen >= s->outMax) return 1;
+            s->out[s->outLen++] = (BYTE)sym;
+            continue;
+        }
+        if (sym == 256) return 0;
+
+        sym -= 257;
+        if (sym >= 29) return -1;
+        int x = Inf_Bits(s, kLenExtra[sym]);
+        if (x < 0) return -1;
+        DWORD len = kLenBase[sym] + x;
+
+        int ds = Huff_Decode(s, dc);
+        if (ds < 0 || ds >= 30) return -1;
+        x = Inf_Bits(s, kDistExtra[ds]);
+        if (x < 0) return -1;
+        DWORD dist = kDistBase[ds] + x;
+        if (dist > s->outLen) return -1;
+
+        // Byte by byte: source and destination overlap when dist < len
+        // Побайтно: источник и приёмник перекрываются при dist < len
+        DWORD room = s->outMax - s->outLen;
+        DWORD n = (len < room) ? len : room;
+        BYTE* d = s->out + s->outLen;
+        const BYTE* p = d - dist;
+        for (DWORD i = 0; i < n; ++i) d[i] = p[i];
+        s->outLen += n;
+        if (n < len) return 1;
+    }
+}
+
+static int Inf_Fixed(Inf* s)
+{
+    if (!s_fixReady) {
+        BYTE len[FIXLCODES];
+        int i = 0;
+        for (; i < 144; ++i) len[i] = 8;
+        for (; i < 256; ++i) len[i] = 9;
+        for (; i < 280; ++i) len[i] = 7;
+        for (; i < FIXLCODES; ++i) len[i] = 8;
+        Huff_Build(&s_fixLen, len, FIXLCODES);
+        for (i = 0; i < MAXDCODES; ++i) len[i] = 5;
+        Huff_Build(&s_fixDist, len, MAXDCODES);
+        s_fixReady = TRUE;
+    }
+    return Inf_Codes(s, &s_fixLen, &s_fixDist);
+}
+
+static int Inf_Dynamic(Inf* s)
+{
+    static const BYTE order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    int nlen  = Inf_Bits(s, 5);
+    int ndist = Inf_Bits(s, 5);
+    int ncode = Inf_Bits(s, 4);
+    if (nlen < 0 || ndist < 0 || ncode < 0) return -1;
+    nlen  += 257;
+    ndist += 1;
+    ncode += 4;
+    if (nlen > MAXLCODES || ndist > MAXDCODES) return -1;
+
+    BYTE lengths[MAXLCODES + MAXDCODES];
+    for (int i = 0; i < 19; ++i) {
+        int v = (i < ncode) ? Inf_Bits(s, 3) : 0;
+        if (v < 0) return -1;
+        lengths[order[i]] = (BYTE)v;
+    }
+
+    Huff lencode, distcode;
+    if (Huff_Build(&lencode, lengths, 19) != 0) return -1;   // must be complete / должен быть полным
+
+    int idx = 0;
+    while (idx < nlen + ndist) {
+        int sym = Huff_Decode(s, &lencode);
+        if (sym < 0) return -1;
+        if (sym < 16) {
+            lengths[idx++] = (BYTE)sym;
+            continue;
+        }
+
+        BYTE len = 0;
+        int rep;
+        if (sym == 16) {
+            if (idx == 0) return -1;
+            len = lengths[idx - 1];
+            rep = Inf_Bits(s, 2) + 3;
+        } else if (sym == 17) {
+            rep = Inf_Bits(s, 3) + 3;
+        } else {
+            rep = Inf_Bits(s, 7) + 11;
+        }
+        if (rep < 3 || idx + rep > nlen + ndist) return -1;
+        while (rep--) lengths[idx++] = len;
+    }
+    if (lengths[256] == 0) return -1;
+
+    // An incomplete code is only allowed for a single code
+    // Неполный код допустим только для единственного кода
+    int err = Huff_Build(&lencode, lengths, nlen);
+    if (err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) return -1;
+    err = Huff_Build(&distcode, lengths + nlen, ndist);
+    if (err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) return -1;
+
+    return Inf_Codes(s, &lencode, &distcode);
+}
+
+static DWORD Adler32(const BYTE* p, DWORD n)
+{
+    DWORD a = 1, b = 0;
+    while (n > 0) {
+        DWORD k = (n < 5552) ? n : 5552;   // largest run without overflow / наибольший участок без переполнения
+        n -= k;
+        while (k--) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int Inflate_Zlib(const BYTE* src, DWORD srcLen, BYTE* dst, DWORD dstMax, DWORD* outLen)
+{
+    if (outLen) *outLen = 0;
+    s_stats.streams++;
+    if (!src || !dst || srcLen < 6) {
+        s_stats.errors++;
+        return INFLATE_ERROR;
+    }
+
+    // CMF/FLG: deflate, window <= 32K, check bits, no preset dictionary
+    // CMF/FLG: deflate, окно <= 32К, контрольные биты, без словаря
+    BYTE cmf = src[0], flg = src[1];
+    if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+        s_stats.errors++;
+        return INFLATE_ERROR;
+    }
+
+    Inf s;
+    ZeroMemory(&s, sizeof(s));
+    s.in     = src + 2;
+    s.inLen  = srcLen - 2;
+    s.out    = dst;
+    s.outMax = dstMax;
+
+    int r = 0, last = 0;
+    do {
+        last = Inf_Bits(&s, 1);
+        int type = Inf_Bits(&s, 2);
+        if (last < 0 || type < 0) r = -1;
+        else if (type == 0)       r = Inf_Stored(&s);
+        else if (type == 1)       r = Inf_Fixed(&s);
+        else if (type == 2)       r = Inf_Dynamic(&s);
+        else                      r = -1;
+    } while (!last && r == 0);
+
+    if (outLen) *outLen = s.outLen;
+    s_stats.bytesOut += s.outLen;
+    if (r < 0) {
+        s_stats.errors++;
+        return INFLATE_ERROR;
+    }
+    if (r > 0) {
+        s_stats.partial++;
+        return INFLATE_FULL;
+    }
+
+    // Adler-32 of the output, big-endian, byte aligned
+    // Adler-32 выхода, big-endian, по границе байта
+    s.bits  >>= s.nbits & 7;
+    s.nbits  -= s.nbits & 7;
+    DWORD sum = 0;
+    for (int i = 0; i < 4; ++i) {
+        int b = Inf_Bits(&s, 8);
+        if (b < 0) {
+            s_stats.errors++;
+            return INFLATE_ERROR;
+        }
+        sum = (sum << 8) | (DWORD)b;
+    }
+    if (sum != Adler32(dst, s.outLen)) {
+        s_stats.errors++;
+        return INFLATE_ERROR;
+    }
+    return INFLATE_DONE;
+}
+
+BYTE* Inflate_Scratch(DWORD size)
+{
+    if (s_scratch && size <= s_scratchCap) return s_scratch;
+    if (s_scratch) GlobalFree(s_scratch);
+    s_scratch    = (BYTE*)GlobalAlloc(GMEM_FIXED, size ? size : 1);
+    s_scratchCap = s_scratch ? size : 0;
+    return s_scratch;
+}
+
+void Inflate_ReleaseScratch(BOOL all)
+{
+    if (s_scratch && (all || s_scratchCap > INFLATE_KEEP_BYTES)) {
+        GlobalFree(s_scratch);
+        s_scratch    = NULL;
+        s_scratchCap = 0;
+    }
+}
+
+void Inflate_GetStats(InflateStats* out)
+{
+    if (out) *out = s_stats;
+}
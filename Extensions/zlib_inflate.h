@@ -0,0 +1,86 @@
+/**
+ * @file zlib_inflate.h
+ * @brief Bounded zlib/deflate decoder for compressed tag frames
+ * @brief Ограниченный декодер zlib/deflate для сжатых фреймов тегов
+ *
+ * ID3v2 frames may be stored zlib-compressed. Pictures themselves are decoded
+ * by OLE/GDI+, so the plugin has no inflate of its own otherwise; this one is
+ * small and never writes past the output buffer it is given. Decoding stops
+ * as soon as that buffer is full, so a caller can inflate just the head of a
+ * frame (enough to read the picture header and size) and the whole frame only
+ * for the picture it really decodes.
+ *
+ * Фреймы ID3v2 могут храниться сжатыми zlib. Сами изображения декодируются
+ * OLE/GDI+, поэтому другого inflate в плагине нет; этот невелик и никогда не
+ * пишет за пределы переданного выходного буфера. Декодирование останавливается,
+ * как только буфер заполнен, поэтому вызывающий может распаковать только начало
+ * фрейма (достаточно для заголовка и размера изображения), а весь фрейм - только
+ * для изображения, которое действительно декодируется.
+ *
+ * @warning Not thread-safe (scratch buffer): used on the UI thread only
+ * @warning Не потокобезопасно (рабочий буфер): используется только в UI-потоке
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Inflate_Zlib() results / Результаты Inflate_Zlib()
+#define INFLATE_ERROR  0   ///< Corrupt stream / Повреждённый поток
+#define INFLATE_DONE   1   ///< Whole stream decoded, checksum verified / Поток декодирован, контрольная сумма верна
+#define INFLATE_FULL   2   ///< Output buffer filled first / Выходной буфер заполнен раньше
+
+/**
+ * @brief Decoder statistics / Статистика декодера
+ */
+typedef struct {
+    DWORD streams;    ///< Inflate_Zlib() calls / Вызовов Inflate_Zlib()
+    DWORD partial;    ///< Calls stopped by a full buffer / Вызовов, остановленных заполненным буфером
+    DWORD errors;     ///< Corrupt streams / Повреждённых потоков
+    DWORD bytesOut;   ///< Bytes produced / Выдано байт
+} InflateStats;
+
+/**
+ * @brief Decode a zlib stream (RFC 1950/1951) into a bounded buffer
+ * @brief Декодировать поток zlib (RFC 1950/1951) в ограниченный буфер
+ *
+ * @param src    Compressed bytes / Сжатые байты
+ * @param srcLen Compressed size / Сжатый размер
+ * @param dst    Output / Выход
+ * @param dstMax Output capacity: decoding stops there / Ёмкость выхода: декодирование на ней останавливается
+ * @param outLen [out] Bytes written / Записано байт
+ * @return INFLATE_DONE, INFLATE_FULL or INFLATE_ERROR
+ */
+int Inflate_Zlib(const BYTE* src, DWORD srcLen, BYTE* dst, DWORD dstMax, DWORD* outLen);
+
+/**
+ * @brief Reusable output buffer of at least @p size bytes, valid until the next call
+ * @brief Повторно используемый выходной буфер не менее @p size байт, действителен до следующего вызова
+ *
+ * @return Buffer or NULL / Буфер или NULL
+ */
+BYTE* Inflate_Scratch(DWORD size);
+
+/**
+ * @brief Free the scratch buffer if it grew past the size worth keeping (or always, on unload)
+ * @brief Освободить рабочий буфер, если он вырос сверх разумного (или всегда, при выгрузке)
+ *
+ * @param all TRUE to free it regardless of size / TRUE чтобы освободить независимо от размера
+ */
+void Inflate_ReleaseScratch(BOOL all);
+
+/**
+ * @brief Copy decoder statistics / Скопировать статистику декодера
+ */
+void Inflate_GetStats(InflateStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,499 @@
+/**
+ * @file reader_stats.cpp
+ * @brief Read and decode counts of the tag readers
+ * @brief Счётчики чтений и декодирования ридеров тегов
+ *
+ * Console driver. Each test writes a small file to %TEMP%, loads its cover
+ * and checks the *_GetStats() deltas: how many reads were issued, how many
+ * bytes they asked for and how many pictures reached the decoder. The exit
+ * code is the number of failed checks.
+ *
+ * Консольный драйвер. Каждый тест пишет небольшой файл в %TEMP%, загружает
+ * обложку и проверяет приращения *_GetStats(): сколько выполнено чтений,
+ * сколько байт запрошено и сколько изображений передано декодеру. Код
+ * возврата - число проваленных проверок.
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <winioctl.h>
+#include <objbase.h>
+#include <stdio.h>
+#include <string.h>
+#include "..\Extensions\id3v2_reader.h"
+#include "..\Extensions\flac_reader.h"
+#include "..\Extensions\mkv_reader.h"
+#include "..\image_loader.h"
+
+static int s_checks = 0;
+static int s_failed = 0;
+
+static void Test_Check(BOOL ok, const char* expr, const char* file, int line)
+{
+    s_checks++;
+    if (ok) return;
+    s_failed++;
+    printf("%s(%d): check failed: %s\n", file, line, expr);
+}
+
+#define CHECK(x) Test_Check((x) ? TRUE : FALSE, #x, __FILE__, __LINE__)
+
+// ============================================================================
+// Fixtures / Тестовые файлы
+// ============================================================================
+
+static BYTE s_buf[256 * 1024];   ///< File being built / Собираемый файл
+static DWORD s_len = 0;
+
+static void Buf_Put(const void* p, DWORD n) { memcpy(s_buf + s_len, p, n); s_len += n; }
+static void Buf_Str(const char* s)          { Buf_Put(s, (DWORD)strlen(s)); }
+static void Buf_Byte(BYTE b)                { s_buf[s_len++] = b; }
+static void Buf_Fill(BYTE b, DWORD n)       { memset(s_buf + s_len, b, n); s_len += n; }
+
+static void Put_BE32(BYTE* p, DWORD v) { p[0] = (BYTE)(v >> 24); p[1] = (BYTE)(v >> 16); p[2] = (BYTE)(v >> 8); p[3] = (BYTE)v; }
+static void Put_LE32(BYTE* p, DWORD v) { p[0] = (BYTE)v; p[1] = (BYTE)(v >> 8); p[2] = (BYTE)(v >> 16); p[3] = (BYTE)(v >> 24); }
+static void Put_LE16(BYTE* p, WORD v)  { p[0] = (BYTE)v; p[1] = (BYTE)(v >> 8); }
+
+/**
+ * @brief Build a w x 1 24-bit BMP, the smallest picture the decoder takes
+ * @brief Собрать BMP w x 1 24 бита - наименьшее изображение, которое берёт декодер
+ * @return Bytes written / Записано байт
+ */
+static DWORD Test_Bmp(BYTE* out, int w)
+{
+    DWORD row  = ((DWORD)w * 3 + 3) & ~3u;
+    DWORD size = 14 + 40 + row;
+    ZeroMemory(out, size);
+    out[0] = 'B'; out[1] = 'M';
+    Put_LE32(out + 2, size);
+    Put_LE32(out + 10, 14 + 40);
+    Put_LE32(out + 14, 40);            // BITMAPINFOHEADER
+    Put_LE32(out + 18, (DWORD)w);
+    Put_LE32(out + 22, 1);
+    Put_LE16(out + 26, 1);             // planes
+    Put_LE16(out + 28, 24);            // bpp
+    Put_LE32(out + 34, row);
+    memset(out + 54, 0x80, (DWORD)w * 3);
+    return size;
+}
+
+/// Full path of a fixture in %TEMP% / Полный путь тестового файла в %TEMP%
+static void Test_Path(char* out, const char* name)
+{
+    DWORD n = GetTempPathA(MAX_PATH, out);
+    if (n == 0 || n + strlen(name) >= MAX_PATH) n = 0;
+    lstrcpynA(out + n, name, MAX_PATH - n);
+}
+
+/// Write s_buf to a fixture / Записать s_buf в тестовый файл
+static BOOL Test_Save(const char* path)
+{
+    HANDLE h = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return FALSE;
+    DWORD wr = 0;
+    BOOL ok = WriteFile(h, s_buf, s_len, &wr, NULL) && wr == s_len;
+    CloseHandle(h);
+    return ok;
+}
+
+// ============================================================================
+// ID3v2
+// ============================================================================
+
+/// Append an ID3v2.3 frame / Добавить фрейм ID3v2.3
+static void Id3_Frame(const char* id, const BYTE* data, DWORD n)
+{
+    BYTE head[10] = {0};
+    memcpy(head, id, 4);
+    Put_BE32(head + 4, n);
+    Buf_Put(head, 10);
+    Buf_Put(data, n);
+}
+
+/// Append a text frame (ISO-8859-1) / Добавить текстовый фрейм (ISO-8859-1)
+static void Id3_Text(const char* id, const char* text)
+{
+    BYTE data[256];
+    data[0] = 0;
+    DWORD n = (DWORD)strlen(text);
+    memcpy(data + 1, text, n);
+    Id3_Frame(id, data, n + 1);
+}
+
+/**
+ * A v2.3 tag at the start of an MP3: text frames, a comment, a back cover
+ * and a front cover, then padding. The loader reads the 10-byte header and
+ * the rest of the tag, and decodes only the front cover (2 pixels wide).
+ * Тег v2.3 в начале MP3: текстовые фреймы, комментарий, задняя и передняя
+ * обложки, затем padding. Загрузчик читает 10-байтовый заголовок и остаток
+ * тега и декодирует только переднюю обложку (2 пикселя в ширину).
+ */
+static void Test_Id3v2(void)
+{
+    static const char* const kText[][2] = {
+        { "TIT2", "Title" }, { "TPE1", "Artist" }, { "TALB", "Album" },
+        { "TRCK", "1/12" },  { "TYER", "2004" },   { "TCON", "Rock" },
+    };
+    char path[MAX_PATH];
+    Test_Path(path, "reader_stats_id3.mp3");
+
+    s_len = 0;
+    Buf_Str("ID3");
+    Buf_Byte(3); Buf_Byte(0); Buf_Byte(0);
+    Buf_Fill(0, 4);                              // size, set below / размер, задаётся ниже
+
+    int frames = 0;
+    for (int i = 0; i < (int)(sizeof(kText) / sizeof(kText[0])); i++, frames++) {
+        Id3_Text(kText[i][0], kText[i][1]);
+    }
+    static const BYTE kComm[] = { 0, 'e', 'n', 'g', 0, 'c', 'o', 'm', 'm', 'e', 'n', 't' };
+    Id3_Frame("COMM", kComm, sizeof(kComm));
+    frames++;
+
+    for (int cover = 4; cover >= 3; cover--, frames++) {
+        BYTE apic[128];
+        DWORD n = 0;
+        apic[n++] = 0;                           // encoding / кодировка
+        memcpy(apic + n, "image/bmp", 10); n += 10;
+        apic[n++] = (BYTE)cover;                 // 4 = back, 3 = front
+        apic[n++] = 0;                           // empty description / пустое описание
+        n += Test_Bmp(apic + n, cover == 3 ? 2 : 1);
+        Id3_Frame("APIC", apic, n);
+    }
+    Buf_Fill(0, 512);                            // padding
+
+    DWORD tagSize = s_len - 10;
+    s_buf[6] = (BYTE)((tagSize >> 21) & 0x7F);
+    s_buf[7] = (BYTE)((tagSize >> 14) & 0x7F);
+    s_buf[8] = (BYTE)((tagSize >> 7) & 0x7F);
+    s_buf[9] = (BYTE)(tagSize & 0x7F);
+
+    // MPEG frames after the tag / MPEG фреймы после тега
+    for (int i = 0; i < 16; i++) {
+        static const BYTE kSync[] = { 0xFF, 0xFB, 0x90, 0x64 };
+        Buf_Put(kSync, sizeof(kSync));
+        Buf_Fill(0, 413);
+    }
+    if (!Test_Save(path)) { CHECK(!"cannot write the ID3v2 fixture"); return; }
+
+    ID3v2Stats a, b;
+    ID3v2_GetStats(&a);
+    HBITMAP hbm = NULL;
+    SIZE sz = {0, 0};
+    BOOL ok = ID3v2_LoadCoverToBitmapA(path, &hbm, &sz);
+    ID3v2_GetStats(&b);
+    if (hbm) DeleteObject(hbm);
+    DeleteFileA(path);
+
+    CHECK(ok);
+    CHECK(sz.cx == 2 && sz.cy == 1);
+    CHECK(b.tags - a.tags == 1);
+    CHECK(b.frames - a.frames == (DWORD)frames);
+    CHECK(b.reads - a.reads == 2);               // header, rest of the tag / заголовок, остаток тега
+    CHECK(b.bytesRead - a.bytesRead == tagSize + 10);
+    CHECK(b.decodes - a.decodes == 1);
+}
+
+// ============================================================================
+// FLAC
+// ============================================================================
+
+/// Append a metadata block header / Добавить заголовок блока метаданных
+static void Flac_Block(BYTE type, BOOL last, DWORD n)
+{
+    Buf_Byte((BYTE)(type | (last ? 0x80 : 0)));
+    Buf_Byte((BYTE)(n >> 16)); Buf_Byte((BYTE)(n >> 8)); Buf_Byte((BYTE)n);
+}
+
+/// Append a PICTURE block with a BMP / Добавить блок PICTURE с BMP
+static void Flac_Picture(DWORD type, int w)
+{
+    BYTE bmp[64];
+    DWORD cb = Test_Bmp(bmp, w);
+    BYTE f[4];
+    Flac_Block(6, FALSE, 4 + 4 + 9 + 4 + 16 + 4 + cb);
+    Put_BE32(f, type);    Buf_Put(f, 4);
+    Put_BE32(f, 9);       Buf_Put(f, 4); Buf_Str("image/bmp");
+    Put_BE32(f, 0);       Buf_Put(f, 4);     // description / описание
+    Put_BE32(f, (DWORD)w); Buf_Put(f, 4);
+    Put_BE32(f, 1);       Buf_Put(f, 4);
+    Put_BE32(f, 24);      Buf_Put(f, 4);
+    Put_BE32(f, 0);       Buf_Put(f, 4);     // colors / цвета
+    Put_BE32(f, cb);      Buf_Put(f, 4);
+    Buf_Put(bmp, cb);
+}
+
+/**
+ * STREAMINFO, SEEKTABLE, VORBIS_COMMENT, four pictures (other, back, front,
+ * artist) and PADDING, then 96 KB of frames. The whole metadata sits in the
+ * first 64 KB, so the loader reads once and decodes the front cover from
+ * that same read.
+ * STREAMINFO, SEEKTABLE, VORBIS_COMMENT, четыре изображения (прочее, задняя,
+ * передняя, исполнитель) и PADDING, затем 96 КБ фреймов. Все метаданные
+ * лежат в первых 64 КБ, поэтому загрузчик читает один раз и декодирует
+ * переднюю обложку из того же чтения.
+ */
+static void Test_Flac(void)
+{
+    static const BYTE kInfo[34] = {
+        0x10, 0x00, 0x10, 0x00,                  // block size 4096..4096
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00,      // frame size unknown / размер фрейма неизвестен
+        0x0A, 0xC4, 0x42, 0xF0, 0x00, 0x01, 0x58, 0x88,   // 44100 Hz, 2 ch, 16 bit, 88200 samples
+    };
+    static const DWORD kTypes[4] = { 0, 4, 3, 8 };
+    char path[MAX_PATH];
+    Test_Path(path, "reader_stats.flac");
+
+    s_len = 0;
+    Buf_Str("fLaC");
+    Flac_Block(0, FALSE, sizeof(kInfo));
+    Buf_Put(kInfo, sizeof(kInfo));
+
+    Flac_Block(3, FALSE, 2 * 18);
+    for (int i = 0; i < 2; i++) {
+        BYTE point[18] = {0};
+        point[6] = (BYTE)(i * 0xAC);             // sample / сэмпл
+        point[16] = 0x10;                        // 4096 samples / сэмплов
+        Buf_Put(point, sizeof(point));
+    }
+
+    static const char kVendor[] = "reference libFLAC 1.1.2 20050205";
+    static const char kTitle[]  = "TITLE=Title";
+    BYTE f[4];
+    Flac_Block(4, FALSE, 4 + (DWORD)strlen(kVendor) + 4 + 4 + (DWORD)strlen(kTitle));
+    Put_LE32(f, (DWORD)strlen(kVendor)); Buf_Put(f, 4); Buf_Str(kVendor);
+    Put_LE32(f, 1);                      Buf_Put(f, 4);
+    Put_LE32(f, (DWORD)strlen(kTitle));  Buf_Put(f, 4); Buf_Str(kTitle);
+
+    for (int i = 0; i < 4; i++) Flac_Picture(kTypes[i], kTypes[i] == 3 ? 2 : 1);
+
+    Flac_Block(1, TRUE, 8192);
+    Buf_Fill(0, 8192);
+
+    static const BYTE kSync[] = { 0xFF, 0xF8, 0xC9, 0x08 };
+    Buf_Put(kSync, sizeof(kSync));
+    Buf_Fill(0, 96 * 1024);
+    if (!Test_Save(path)) { CHECK(!"cannot write the FLAC fixture"); return; }
+
+    FLACStats a, b;
+    FLAC_GetStats(&a);
+    HBITMAP hbm = NULL;
+    SIZE sz = {0, 0};
+    BOOL ok = FLAC_LoadCoverToBitmapA(path, &hbm, &sz);
+    FLAC_GetStats(&b);
+    if (hbm) DeleteObject(hbm);
+    DeleteFileA(path);
+
+    CHECK(ok);
+    CHECK(sz.cx == 2 && sz.cy == 1);
+    CHECK(b.files - a.files == 1);
+    CHECK(b.pictures - a.pictures == 4);
+    CHECK(b.reads - a.reads == 1);               // the 64 KB metadata window / окно метаданных 64 КБ
+    CHECK(b.bytesRead - a.bytesRead == 64 * 1024);
+    CHECK(b.decodes - a.decodes == 1);
+}
+
+// ============================================================================
+// Matroska
+// ============================================================================
+
+typedef unsigned __int64 U64;
+
+/// Append an element ID (1-4 bytes, marker kept) / Добавить ID элемента (1-4 байта, с маркером)
+static void Ebml_Id(DWORD id)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if ((id >> shift) || shift == 0) Buf_Byte((BYTE)(id >> shift));
+    }
+}
+
+/// Patch an 8-byte size / Записать 8-байтовый размер
+static void Ebml_SetSize(DWORD at, U64 size)
+{
+    s_buf[at] = 0x01;
+    for (int i = 7; i >= 1; i--, size >>= 8) s_buf[at + i] = (BYTE)size;
+}
+
+/**
+ * @brief Start a master element with an 8-byte size, set by Ebml_Close()
+ * @brief Начать мастер-элемент с 8-байтовым размером, задаваемым Ebml_Close()
+ * @return Offset of the size in s_buf / Смещение размера в s_buf
+ */
+static DWORD Ebml_Open(DWORD id)
+{
+    Ebml_Id(id);
+    DWORD at = s_len;
+    Buf_Fill(0, 8);
+    return at;
+}
+
+static void Ebml_Close(DWORD at) { Ebml_SetSize(at, s_len - at - 8); }
+
+/// Append an 8-byte unsigned integer element / Добавить 8-байтовый элемент беззнакового целого
+static DWORD Ebml_Uint(DWORD id, U64 v)
+{
+    Ebml_Id(id);
+    Buf_Byte(0x88);
+    DWORD at = s_len;
+    for (int shift = 56; shift >= 0; shift -= 8) Buf_Byte((BYTE)(v >> shift));
+    return at;
+}
+
+static void Ebml_Patch(DWORD at, U64 v)
+{
+    for (int i = 7; i >= 0; i--, v >>= 8) s_buf[at + i] = (BYTE)v;
+}
+
+static void Ebml_Bin(DWORD id, const void* p, DWORD n)
+{
+    Ebml_Id(id);
+    Buf_Byte((BYTE)(0x80 | n));
+    Buf_Put(p, n);
+}
+
+static void Ebml_Str(DWORD id, const char* str) { Ebml_Bin(id, str, (DWORD)strlen(str)); }
+
+/// Append an AttachedFile / Добавить AttachedFile
+static void Mkv_File(const char* name, const char* mime, const BYTE* data, DWORD n)
+{
+    DWORD af = Ebml_Open(0x61A7);
+    Ebml_Str(0x466E, name);
+    Ebml_Str(0x4660, mime);
+    DWORD fd = Ebml_Open(0x465C);
+    Buf_Put(data, n);
+    Ebml_Close(fd);
+    Ebml_Uint(0x46AE, 0x12345678);               // FileUID
+    Ebml_Close(af);
+}
+
+/**
+ * The layout mkvmerge writes: a SeekHead at the start, Info and Tracks, then
+ * 5 GB of Clusters, then Cues and Attachments. The Clusters are a sparse
+ * gap, so the file takes a few KB on disk. The Attachments hold a 5 KB font
+ * before four images. The loader reads the start, follows the SeekHead to
+ * the Attachments, reads on past the font, then reads the cover:
+ * 4 reads, about 8 KB.
+ * Структура, которую пишет mkvmerge: SeekHead в начале, Info и Tracks,
+ * затем 5 ГБ Cluster'ов, затем Cues и Attachments. Cluster'ы - разреженный
+ * промежуток, поэтому на диске файл занимает несколько КБ. В Attachments
+ * перед четырьмя изображениями лежит шрифт на 5 КБ. Загрузчик читает
+ * начало, по SeekHead переходит к Attachments, читает дальше за шрифтом,
+ * затем читает обложку: 4 чтения, около 8 КБ.
+ */
+static void Test_Mkv(void)
+{
+    static const DWORD kSeekIds[4] = { 0x1549A966, 0x1654AE6B, 0x1C53BB6B, 0x1941A469 };   // Info, Tracks, Cues, Attachments
+    const U64 gap = (U64)5 * 1024 * 1024 * 1024;
+    char path[MAX_PATH];
+    Test_Path(path, "reader_stats.mkv");
+
+    // Start of the file / Начало файла
+    s_len = 0;
+    DWORD ebml = Ebml_Open(0x1A45DFA3);
+    Ebml_Str(0x4282, "matroska");
+    Ebml_Uint(0x4287, 4);                        // DocTypeVersion
+    Ebml_Close(ebml);
+
+    DWORD seg = Ebml_Open(0x18538067);
+    DWORD segData = s_len;
+    DWORD seekPos[4];
+    DWORD sh = Ebml_Open(0x114D9B74);
+    for (int i = 0; i < 4; i++) {
+        BYTE id[4];
+        Put_BE32(id, kSeekIds[i]);
+        DWORD e = Ebml_Open(0x4DBB);
+        Ebml_Bin(0x53AB, id, 4);
+        seekPos[i] = Ebml_Uint(0x53AC, 0);
+        Ebml_Close(e);
+    }
+    Ebml_Close(sh);
+
+    Ebml_Patch(seekPos[0], s_len - segData);
+    DWORD info = Ebml_Open(0x1549A966);
+    Ebml_Uint(0x2AD7B1, 1000000);                // TimecodeScale
+    Ebml_Close(info);
+
+    Ebml_Patch(seekPos[1], s_len - segData);
+    DWORD tracks = Ebml_Open(0x1654AE6B);
+    DWORD entry = Ebml_Open(0xAE);
+    Ebml_Uint(0xD7, 1);                          // TrackNumber
+    Ebml_Str(0x86, "A_FLAC");                    // CodecID
+    Ebml_Close(entry);
+    Ebml_Close(tracks);
+
+    // The Clusters: a Timecode, then the gap / Cluster'ы: Timecode, затем промежуток
+    DWORD cluster = Ebml_Open(0x1F43B675);
+    Ebml_SetSize(cluster, gap);
+    Ebml_Uint(0xE7, 0);
+    DWORD head = s_len;
+    U64 tail = (U64)cluster + 8 + gap;          // file offset of the Cues / смещение Cues в файле
+
+    // End of the file, built after the start in s_buf / Конец файла, собирается в s_buf после начала
+    Ebml_Patch(seekPos[2], tail - segData);
+    DWORD cues = Ebml_Open(0x1C53BB6B);
+    DWORD point = Ebml_Open(0xBB);
+    Ebml_Uint(0xB3, 0);                          // CueTime
+    Ebml_Close(point);
+    Ebml_Close(cues);
+
+    Ebml_Patch(seekPos[3], tail + (s_len - head) - segData);
+    BYTE font[5000], bmp[64];
+    memset(font, 'F', sizeof(font));
+    DWORD att = Ebml_Open(0x1941A469);
+    Mkv_File("font.ttf", "application/x-truetype-font", font, sizeof(font));
+    Mkv_File("small_cover.bmp", "image/bmp", bmp, Test_Bmp(bmp, 1));
+    Mkv_File("cover_land.bmp", "image/bmp", bmp, Test_Bmp(bmp, 1));
+    Mkv_File("cover.bmp", "image/bmp", bmp, Test_Bmp(bmp, 2));
+    Mkv_File("booklet.bmp", "image/bmp", bmp, Test_Bmp(bmp, 1));
+    Ebml_Close(att);
+    Ebml_SetSize(seg, tail + (s_len - head) - segData);
+
+    HANDLE h = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) { CHECK(!"cannot write the Matroska fixture"); return; }
+    DWORD wr = 0;
+    if (!DeviceIoControl(h, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &wr, NULL)) {
+        // FAT32 has neither sparse files nor files over 4 GB / У FAT32 нет ни разреженных файлов, ни файлов больше 4 ГБ
+        CloseHandle(h);
+        DeleteFileA(path);
+        printf("Test_Mkv: skipped, %%TEMP%% does not support sparse files\n");
+        return;
+    }
+    LONG hi = (LONG)(tail >> 32);
+    BOOL ok = WriteFile(h, s_buf, head, &wr, NULL) && wr == head &&
+              SetFilePointer(h, (LONG)(DWORD)tail, &hi, FILE_BEGIN) != INVALID_SET_FILE_POINTER &&
+              WriteFile(h, s_buf + head, s_len - head, &wr, NULL) && wr == s_len - head;
+    CloseHandle(h);
+    if (!ok) { DeleteFileA(path); CHECK(!"cannot write the Matroska fixture"); return; }
+
+    MKVStats a, b;
+    MKV_GetStats(&a);
+    HBITMAP hbm = NULL;
+    SIZE sz = {0, 0};
+    ok = MKV_LoadCoverToBitmapA(path, &hbm, &sz);
+    MKV_GetStats(&b);
+    if (hbm) DeleteObject(hbm);
+    DeleteFileA(path);
+
+    CHECK(ok);
+    CHECK(sz.cx == 2 && sz.cy == 1);
+    CHECK(b.files - a.files == 1);
+    CHECK(b.seeks - a.seeks == 1);
+    CHECK(b.attachments - a.attachments == 4);
+    CHECK(b.reads - a.reads == 4);               // start, Attachments, past the font, cover / начало, Attachments, за шрифтом, обложка
+    CHECK(b.bytesRead - a.bytesRead <= 9 * 1024);
+    CHECK(b.decodes - a.decodes == 1);
+}
+
+int main(void)
+{
+    OleInitialize(NULL);
+
+    Test_Id3v2();
+    Test_Flac();
+    Test_Mkv();
+
+    Img_Cleanup();
+    OleUninitialize();
+    printf("%d checks, %d failed\n", s_checks, s_failed);
+    return s_failed;
+}
@@ -7,6 +7,7 @@
 #include <windows.h>
 #include <shlwapi.h> 
 #include <stdio.h>
+#include <math.h>
 
 #pragma comment(lib, "shlwapi.lib")
 
@@ -16,6 +17,9 @@
 #include "image_loader.h"
 #include "skin_util.h"
 #include "ini_store.h"
+#include "render_worker.h"
+#include "pixel_ops.h"
+#include "picture_strip.h"
 
 // Provided by plugin_main.cpp
 extern HWND UIHost_GetWinampWnd();
@@ -25,6 +29,9 @@ extern HINSTANCE UIHost_GetHInstance();
 #include "Extensions\flac_reader.h"
 #include "Extensions\ape_reader.h"
 #include "Extensions\mp4_reader.h"
+#include "Extensions\ogg_reader.h"
+#include "Extensions\asf_reader.h"
+#include "Extensions\mkv_reader.h"
 
 // ============================================================================
 // Constants and Macros
@@ -42,24 +49,129 @@ extern HINSTANCE UIHost_GetHInstance();
 #define IPC_GETPLAYLISTFILE 211  
 #endif
 
+#ifndef IPC_GETOUTPUTTIME
+#define IPC_GETOUTPUTTIME 105
+#endif
+
+#ifndef WM_MOUSEWHEEL
+#define WM_MOUSEWHEEL 0x020A
+#endif
+
+#ifndef WM_DPICHANGED
+#define WM_DPICHANGED 0x02E0
+#endif
+
+#ifndef WM_DPICHANGED_AFTERPARENT
+#define WM_DPICHANGED_AFTERPARENT 0x02E3
+#endif
+
 #ifndef ARRAYSIZE
 #define ARRAYSIZE(a) (sizeof(a)/sizeof((a)[0]))
 #endif
 
 #define TAG_RETRY_TIMER_ID 2  
+#define FADE_TIMER_ID      3
+#define CHAPTER_TIMER_ID   4
+#define CHAPTER_POLL_MS    500    // playback time polling for chapter images / опрос времени для изображений глав
+#define ZOOM_MAX           8.0    // 800% / 800%
+#define FRAME_VARIANTS     2      // fitted frames kept at other sizes / вписанных кадров других размеров
+#define WM_APT_FRAMEREADY (WM_USER + 0x6E02)
+#define WM_APT_THUMBNEXT  (WM_USER + 0x6E03)
 
 // ============================================================================
 // Global State
 // ============================================================================
 
 static HWND  s_view          = NULL;  
-static HBITMAP s_hbm          = NULL;  
-static SIZE    s_bm           = {0,0}; 
+static CoverEntry*  s_cover   = NULL;  // current decoded cover / текущая декодированная обложка
+static RenderFrame* s_frame   = NULL;  // latest composed frame / последний скомпонованный кадр
 static UINT    s_timer        = 0;     
 static char    s_lastPath[MAX_PATH] = {0}; 
 static int     s_retryTries   = 0;     
 static ATOM    s_cls          = 0;     // window class atom / атом класса окна
 
+// Last composition request (to avoid re-queuing identical work)
+// Последний запрос композиции (чтобы не ставить одинаковую работу повторно)
+static struct {
+    DWORD    coverId;
+    int      w, h;
+    COLORREF bg;
+    DWORD    flags;
+    RenderView view;
+} s_req = {0};
+
+// Crossfade between the outgoing and the incoming frame
+// Плавный переход между уходящим и входящим кадром
+static int s_fadeMs = 200;            // 0 = off / 0 = выключено
+static BOOL s_blurBg = FALSE;         // blurred letterbox / размытые поля
+static BOOL s_tintBg = FALSE;         // background from cover colours / фон из цветов обложки
+static BOOL s_strip  = FALSE;         // thumbnail strip of embedded pictures / лента встроенных изображений
+static BOOL s_thumbPosted = FALSE;    // WM_APT_THUMBNEXT in the queue / WM_APT_THUMBNEXT в очереди
+
+// Zoom and pan; scale 0 = fit to window
+// Масштаб и сдвиг; scale 0 = вписать в окно
+static struct {
+    double scale;     // screen px per cover px / экранных пикселей на пиксель обложки
+    double cx, cy;    // cover point at the window centre / точка обложки в центре окна
+    BOOL   drag;
+    POINT  last;
+} s_zoom = {0};
+
+// Colours of the most recent cover; kept after it is gone so the placeholder matches
+// Цвета последней обложки; сохраняются после её ухода, чтобы заглушка совпадала
+static struct {
+    BOOL     valid;
+    COLORREF bg;
+    COLORREF text;
+} s_tint = {0};
+static struct {
+    RenderFrame* from;    // outgoing picture / уходящая картинка
+    RenderFrame* mix;     // blend shown while fading / смесь, показываемая во время перехода
+    LONGLONG     t0;
+    DWORD        cpuUs;   // blend time of this transition / время смешивания этого перехода
+    int          steps;
+    RECT         rc;      // pixels that differ between the two / пиксели, которые различаются
+} s_fade = {0};
+static PerfHistogram s_fadeCpu = {0};
+
+// Monitor DPI, queried only when the window is created or changes monitor/display
+// DPI монитора, запрашивается только при создании окна и смене монитора/дисплея
+static int s_dpi = 96;
+
+// Recent fitted frames of the current cover at other physical sizes, newest first:
+// moving between monitors of different DPI flips between two sizes and reuses them
+// Недавние вписанные кадры текущей обложки других физических размеров, новые первыми:
+// переход между мониторами с разным DPI переключает два размера и переиспользует их
+static struct {
+    RenderFrame* f[FRAME_VARIANTS];
+    DWORD        hits;
+    DWORD        misses;
+} s_variants = {0};
+
+// Repainted pixels, counted from the update region of every WM_PAINT (debug builds)
+// Перерисованные пиксели, считаются по региону обновления каждого WM_PAINT (отладочные сборки)
+static struct {
+    DWORD            paints;
+    DWORD            lastPixels;
+    unsigned __int64 pixels;
+} s_paint = {0};
+
+// Chapter images of the current audiobook; items is the view's own copy of the
+// index the MP4 reader caches, which any later reader call may replace
+// Изображения глав текущей аудиокниги; items - собственная копия индекса,
+// который кэширует ридер MP4 и который может заменить любой его вызов
+static struct {
+    MP4ChapterImage* items;
+    int     count;
+    int     shown;     // chapter on screen, -1 = track cover / глава на экране, -1 = обложка трека
+    int     next;      // chapter whose bytes are read ahead, -1 = none / глава, чьи байты читаются заранее, -1 = нет
+    CoverEntry* main;  // track cover while a chapter image is shown / обложка трека, пока показано изображение главы
+} s_chap = { NULL, 0, -1, -1, NULL };
+
+static void RefreshView();
+static void DropVariants();
+static void ClampZoom(int W, int H);
+
 // ============================================================================
 // Helper Functions
 // ============================================================================
@@ -82,7 +194,10 @@ static BOOL IsTagReadingSupported(const char* lpszPath)
 
     const char* szSupported[] = {
         ".mp3", ".flac", ".fla", ".m4a", ".m4b", 
-        ".mp4", ".m4v", ".mov", ".ape", ".mpc", ".wv"
+        ".mp4", ".m4v", ".mov", ".ape", ".mpc", ".wv",
+        ".ogg", ".oga", ".opus", ".m4p", ".m4r", ".3gp", ".3g2", ".aac",
+        ".wav", ".aif", ".aiff", ".aifc", ".dsf", ".dff", ".wma", ".wmv", ".asf",
+        ".mka", ".mkv", ".webm"
     };
 
     for (int i = 0; i < ARRAYSIZE(szSupported); i++) {
@@ -91,6 +206,19 @@ static BOOL IsTagReadingSupported(const char* lpszPath)
     return FALSE;
 }
 
+// Embedded cover from the first tag reader that finds one
+// Встроенная обложка от первого ридера тегов, который её нашёл
+static BOOL LoadTagCoverA(const char* path, HBITMAP* phb, SIZE* psz)
+{
+    return ID3v2_LoadCoverToBitmapA(path, phb, psz) ||
+           FLAC_LoadCoverToBitmapA (path, phb, psz) ||
+           MP4_LoadCoverToBitmapA  (path, phb, psz) ||
+           APE_LoadCoverToBitmapA  (path, phb, psz) ||
+           OGG_LoadCoverToBitmapA  (path, phb, psz) ||
+           ASF_LoadCoverToBitmapA  (path, phb, psz) ||
+           MKV_LoadCoverToBitmapA  (path, phb, psz);
+}
+
 static BOOL GetCurrentSongPathA(char* out, int cch)
 {
     HWND wa = FindWinamp(); 
@@ -103,12 +231,59 @@ static BOOL GetCurrentSongPathA(char* out, int cch)
     return TRUE;
 }
 
+// Client area minus the picture strip band (if shown)
+// Клиентская область за вычетом полосы ленты (если она показана)
+static void GetViewArea(HWND h, int* W, int* H, RECT* band) {
+    RECT rc;
+    GetClientRect(h, &rc);
+    *W = rc.right;
+    *H = rc.bottom;
+    if (band) SetRectEmpty(band);
+    int strip = Strip_Height();
+    if (s_strip && rc.bottom > 2 * strip && Strip_Count() > 0) {
+        *H = rc.bottom - strip;
+        if (band) SetRect(band, 0, *H, rc.right, rc.bottom);
+    }
+}
+
+static void ResetZoom() {
+    s_zoom.scale = 0;
+    if (s_zoom.drag && s_view && GetCapture() == s_view) ReleaseCapture();
+    s_zoom.drag = FALSE;
+}
+
 static void SafeResetBitmap() { 
-    if (s_hbm) { 
-        DeleteObject(s_hbm); 
-        s_hbm = NULL; 
-    } 
-    s_bm.cx = s_bm.cy = 0; 
+    // The worker may still hold its own reference; the bitmap dies with the last one
+    // Рабочий поток может ещё держать свою ссылку; bitmap умрёт вместе с последней
+    Cover_Release(s_cover);
+    s_cover = NULL;
+    DropVariants();
+    ResetZoom();
+}
+
+// Put @c on screen in place of the current cover, keeping zoom and pan (takes the reference)
+// Показать @c вместо текущей обложки, сохраняя масштаб и сдвиг (ссылка передаётся)
+static void SwapCover(CoverEntry* c) {
+    Cover_Release(s_cover);
+    s_cover = c;
+    DropVariants();
+    if (!s_cover) {
+        ResetZoom();
+        return;
+    }
+    s_tint.valid = TRUE;
+    s_tint.bg    = s_cover->dominant;
+    s_tint.text  = s_cover->accent;
+    if (s_view) {
+        int W, H;
+        GetViewArea(s_view, &W, &H, NULL);
+        ClampZoom(W, H);
+    }
+}
+
+static void SetCoverBitmap(HBITMAP hb, SIZE sz) {
+    SafeResetBitmap();
+    SwapCover(Cover_Create(hb, sz));
 }
 
 static BOOL IsHttpUrl(const char* path) {
@@ -127,6 +302,94 @@ static void StartRetry() {
     SetTimer(s_view, TAG_RETRY_TIMER_ID, 300, NULL); 
 }
 
+// Forget the track cover kept for the way back from the chapter images
+// Забыть обложку трека, сохранённую для возврата от изображений глав
+static void ForgetChapterCover() {
+    Cover_Release(s_chap.main);
+    s_chap.main  = NULL;
+    s_chap.shown = -1;
+}
+
+static void StopChapters() {
+    if (s_view && IsWindow(s_view)) KillTimer(s_view, CHAPTER_TIMER_ID);
+    if (s_chap.items) GlobalFree(s_chap.items);
+    ForgetChapterCover();
+    s_chap.items = NULL;
+    s_chap.count = 0;
+    s_chap.next  = -1;
+}
+
+// Follow playback time if the track has chapter images
+// Следовать времени воспроизведения, если у трека есть изображения глав
+static void StartChapters(const char* path) {
+    StopChapters();
+    if (!s_view || !IsWindow(s_view) || !IsTagReadingSupported(path)) return;
+    const MP4ChapterImage* items = NULL;
+    int n = MP4_GetChapterImagesA(path, &items);
+    if (n <= 0) return;
+    s_chap.items = (MP4ChapterImage*)GlobalAlloc(GMEM_FIXED, n * sizeof(MP4ChapterImage));
+    if (!s_chap.items) return;
+    CopyMemory(s_chap.items, items, n * sizeof(MP4ChapterImage));
+    s_chap.count = n;
+    SetTimer(s_view, CHAPTER_TIMER_ID, CHAPTER_POLL_MS, NULL);
+}
+
+// Show the image of the chapter being played. Images are decoded only when
+// their chapter starts; on the tick after a switch the MP4 reader's prefetch
+// thread reads the next chapter's image, so the following switch only decodes
+// from memory. Before the first chapter the track cover comes back. Zoom and
+// pan stay as they are.
+// Показать изображение играющей главы. Изображения декодируются только с
+// началом главы; на тике после смены поток упреждающего чтения ридера MP4
+// читает изображение следующей главы, поэтому следующая смена только декодирует
+// из памяти. До первой главы возвращается обложка трека. Масштаб и сдвиг
+// остаются как есть.
+static void StepChapters() {
+    HWND wa = FindWinamp();
+    if (!wa || !s_chap.count) return;
+    int ms = (int)SendMessageA(wa, WM_WA_IPC, 0, IPC_GETOUTPUTTIME);
+    if (ms < 0) return;   // stopped / остановлено
+
+    int n = MP4_FindChapter(s_chap.items, s_chap.count, (DWORD)ms);
+    if (n < 0) {
+        if (s_chap.shown < 0) return;
+        s_chap.shown = -1;
+        if (s_chap.main) {
+            SwapCover(s_chap.main);   // the reference goes back to s_cover / ссылка возвращается в s_cover
+            s_chap.main = NULL;
+            RefreshView();
+        }
+        return;
+    }
+    if (n == s_chap.shown) {
+        int ahead = n + 1;
+        if (ahead < s_chap.count && s_chap.next != ahead) {
+            s_chap.next = ahead;
+            MP4_PrefetchChapterImageA(s_lastPath, &s_chap.items[ahead]);
+        }
+        return;
+    }
+
+    HBITMAP hb = NULL;
+    SIZE    sz = {0, 0};
+    s_chap.next = -1;
+    if (!MP4_LoadChapterImageA(s_lastPath, &s_chap.items[n], &hb, &sz)) hb = NULL;
+    if (hb) {
+        CoverEntry* c = Cover_Create(hb, sz);
+        if (c) {
+            // Leaving the track cover: keep it for the way back
+            // Уходим с обложки трека: сохраняем её для возврата
+            if (s_chap.shown < 0 && !s_chap.main && s_cover) {
+                Cover_AddRef(s_cover);
+                s_chap.main = s_cover;
+            }
+            SwapCover(c);
+            RefreshView();
+        }
+    }
+    s_chap.shown = n;
+}
+
 // ============================================================================
 // Cover Art Search Logic
 // ============================================================================
@@ -148,8 +411,7 @@ static BOOL TryLoadBesideA(const char* audioPath)
             if (PathFileExistsA(testPath)) {
                 HBITMAP hb; SIZE s;
                 if (Img_LoadFromFileA(testPath, &hb, &s)) {
-                    SafeResetBitmap();
-                    s_hbm = hb; s_bm = s;
+                    SetCoverBitmap(hb, s);
                     return TRUE;
                 }
             }
@@ -165,27 +427,27 @@ static void LoadForPathA(const char* path)
     if (IsHttpUrl(path)) {
         lstrcpynA(s_lastPath, path, MAX_PATH);
         SafeResetBitmap();
-        if (s_view) InvalidateRect(s_view, NULL, TRUE);
+        StopChapters();
+        Strip_SetTrack(NULL);
+        RefreshView();
         return;
     }
 
-    if (s_hbm && ascii_icmp(path, s_lastPath) == 0) return;
+    if (s_cover && ascii_icmp(path, s_lastPath) == 0) return;
+
+    // Only forgets the old index; the new one is built when the strip is shown
+    // Только забывает старый индекс; новый строится, когда лента показывается
+    Strip_SetTrack(path);
+    if (s_strip && s_view) InvalidateRect(s_view, NULL, FALSE);   // layout may change / раскладка может измениться
 
     HBITMAP hb = 0;
     SIZE    sz = {0,0};
     BOOL    loaded = FALSE;
 
-    if (IsTagReadingSupported(path)) 
-    {
-        if      (ID3v2_LoadCoverToBitmapA(path, &hb, &sz)) loaded = TRUE;
-        else if (FLAC_LoadCoverToBitmapA (path, &hb, &sz)) loaded = TRUE;
-        else if (MP4_LoadCoverToBitmapA  (path, &hb, &sz)) loaded = TRUE;
-        else if (APE_LoadCoverToBitmapA  (path, &hb, &sz)) loaded = TRUE;
-    }
+    if (IsTagReadingSupported(path)) loaded = LoadTagCoverA(path, &hb, &sz);
 
     if (loaded && hb) {
-        SafeResetBitmap();
-        s_hbm = hb; s_bm = sz;
+        SetCoverBitmap(hb, sz);
         StopRetry();
     } 
     else if (TryLoadBesideA(path)) {
@@ -197,14 +459,622 @@ static void LoadForPathA(const char* path)
     }
 
     lstrcpynA(s_lastPath, path, MAX_PATH);
+    StartChapters(path);
 
     // УДАЛЕНО: WADlg_init и Skin_RefreshDialogBrush. 
     // Эти функции вызывали SendMessage к главному окну, что приводило к Deadlock 
     // в Modern скинах при запуске файла из Медиатеки.
     
-    if (s_view && IsWindow(s_view)) {
-        InvalidateRect(s_view, NULL, TRUE);
-        // UpdateWindow убран для предотвращения лишней синхронности
+    // Only what the new frame changes gets repainted, once it is ready
+    // Перерисовывается только то, что меняет новый кадр, когда он готов
+    RefreshView();
+}
+
+// ============================================================================
+// Frame Presentation
+// ============================================================================
+
+static DWORD CurrentCoverId()
+{
+    return s_cover ? s_cover->id : 0;
+}
+
+static void DropVariants()
+{
+    for (int i = 0; i < FRAME_VARIANTS; ++i) {
+        RenderFrame_Free(s_variants.f[i]);
+        s_variants.f[i] = NULL;
+    }
+}
+
+// Keep a fitted frame that was replaced by one of another size (takes ownership)
+// Сохранить вписанный кадр, заменённый кадром другого размера (владение передаётся)
+static void StashVariant(RenderFrame* f)
+{
+    if (!f) return;
+    if (!f->coverId || f->coverId != CurrentCoverId() || f->view.scale > 0) {
+        RenderFrame_Free(f);
+        return;
+    }
+
+    // One slot per size; otherwise the oldest goes
+    // Один слот на размер; иначе уходит самый старый
+    int slot = FRAME_VARIANTS - 1;
+    for (int i = 0; i < FRAME_VARIANTS; ++i) {
+        if (s_variants.f[i] && s_variants.f[i]->w == f->w && s_variants.f[i]->h == f->h) {
+            slot = i;
+            break;
+        }
+    }
+    RenderFrame_Free(s_variants.f[slot]);
+    for (int i = slot; i > 0; --i) s_variants.f[i] = s_variants.f[i - 1];
+    s_variants.f[0] = f;
+}
+
+static RenderFrame* TakeVariant(int W, int H, COLORREF bg, DWORD flags)
+{
+    for (int i = 0; i < FRAME_VARIANTS; ++i) {
+        RenderFrame* v = s_variants.f[i];
+        if (v && v->coverId == CurrentCoverId() && v->w == W && v->h == H &&
+            v->bg == bg && v->flags == flags) {
+            for (int j = i; j < FRAME_VARIANTS - 1; ++j) s_variants.f[j] = s_variants.f[j + 1];
+            s_variants.f[FRAME_VARIANTS - 1] = NULL;
+            s_variants.hits++;
+            return v;
+        }
+    }
+    s_variants.misses++;
+    return NULL;
+}
+
+// Which pixels differ between two frames of the view
+// Какие пиксели различаются между двумя кадрами окна
+enum {
+    CHANGE_NONE,    // identical / одинаковы
+    CHANGE_BANDS,   // same cover, letterbox only / та же обложка, только поля
+    CHANGE_RECT,    // inside *rc only / только внутри *rc
+    CHANGE_ALL
+};
+
+static int FrameChange(const RenderFrame* a, const RenderFrame* b, RECT* rc)
+{
+    SetRectEmpty(rc);
+    if (!a || !b || a->w != b->w || a->h != b->h ||
+        a->view.scale > 0 || b->view.scale > 0)
+    {
+        SetRect(rc, 0, 0, b ? b->w : 0, b ? b->h : 0);
+        return CHANGE_ALL;
+    }
+
+    BOOL sameBg = (a->bg == b->bg && a->flags == b->flags);
+    BOOL blur   = ((a->flags | b->flags) & RENDER_BLUR_BACKDROP) != 0;
+
+    if (a->coverId && a->coverId == b->coverId && EqualRect(&a->rcCover, &b->rcCover)) {
+        // The blurred letterbox comes from the cover, not from the background colour
+        // Размытые поля берутся из обложки, а не из цвета фона
+        if (sameBg || (blur && a->flags == b->flags)) return CHANGE_NONE;
+        return CHANGE_BANDS;
+    }
+
+    // Another picture over the same flat background: only the two picture rectangles
+    // (for the placeholder, rcCover is its text)
+    // Другая картинка на том же сплошном фоне: только два прямоугольника картинок
+    // (у заглушки rcCover - её текст)
+    if (sameBg && !blur) {
+        UnionRect(rc, &a->rcCover, &b->rcCover);
+        return IsRectEmpty(rc) ? CHANGE_NONE : CHANGE_RECT;
+    }
+
+    SetRect(rc, 0, 0, b->w, b->h);
+    return CHANGE_ALL;
+}
+
+// Invalidate, without erase, what changed from @a to @b
+// Объявить недействительным, без стирания, то, что изменилось от @a к @b
+static void InvalidateFrameChange(const RenderFrame* a, const RenderFrame* b)
+{
+    if (!s_view) return;
+
+    RECT rc;
+    switch (FrameChange(a, b, &rc)) {
+    case CHANGE_NONE:
+        break;
+
+    case CHANGE_BANDS:
+    {
+        HRGN bands = CreateRectRgn(0, 0, b->w, b->h);
+        HRGN cover = CreateRectRgnIndirect(&b->rcCover);
+        if (bands && cover && CombineRgn(bands, bands, cover, RGN_DIFF) != ERROR) {
+            InvalidateRgn(s_view, bands, FALSE);
+        } else {
+            InvalidateRect(s_view, NULL, FALSE);
+        }
+        if (cover) DeleteObject(cover);
+        if (bands) DeleteObject(bands);
+        break;
+    }
+
+    default:
+        InvalidateRect(s_view, &rc, FALSE);
+        break;
+    }
+}
+
+// Timer interval for one fade step: never faster than the display refreshes
+// Интервал таймера одного шага перехода: не чаще частоты обновления дисплея
+static UINT FadeInterval(HWND h)
+{
+    int hz = 0;
+    HDC dc = GetDC(h);
+    if (dc) {
+        hz = GetDeviceCaps(dc, VREFRESH);
+        ReleaseDC(h, dc);
+    }
+    if (hz <= 1)  hz = 60;   // 0/1 mean "hardware default" / 0/1 означают "по умолчанию"
+    if (hz > 240) hz = 240;
+    return (UINT)((1000 + hz - 1) / hz);
+}
+
+static void EndFade()
+{
+    if (!s_fade.mix && !s_fade.from) return;
+    if (s_view && IsWindow(s_view)) KillTimer(s_view, FADE_TIMER_ID);
+
+    if (s_fade.steps) {
+        Perf_HistAdd(&s_fadeCpu, s_fade.cpuUs);
+        Perf_Trace("fade: %d steps, %lu us cpu", s_fade.steps, s_fade.cpuUs);
+    }
+    RenderFrame_Free(s_fade.from);
+    RenderFrame_Free(s_fade.mix);
+    ZeroMemory(&s_fade, sizeof(s_fade));
+}
+
+// Start fading from @from (ownership taken) to s_frame; only the pixels that differ are repainted
+// Начать переход от @from (владение передаётся) к s_frame; перерисовываются только различающиеся пиксели
+static void BeginFade(RenderFrame* from)
+{
+    // Already fading: continue from what is on screen right now
+    // Переход уже идёт: продолжаем с того, что сейчас на экране
+    RECT prev = {0};
+    if (s_fade.mix) {
+        prev = s_fade.rc;
+        RenderFrame_Free(from);
+        from = s_fade.mix;
+        s_fade.mix = NULL;
+    }
+    EndFade();
+
+    if (s_fadeMs > 0 && s_view && IsWindowVisible(s_view) && s_frame &&
+        from->w == s_frame->w && from->h == s_frame->h)
+    {
+        s_fade.mix = RenderFrame_Create(from->w, from->h);
+    }
+    if (!s_fade.mix) {
+        // No fade: show the new frame at once
+        // Без перехода: сразу показать новый кадр
+        if (s_view && !IsRectEmpty(&prev)) InvalidateRect(s_view, &prev, FALSE);
+        InvalidateFrameChange(from, s_frame);
+        RenderFrame_Free(from);
+        return;
+    }
+    CopyMemory(s_fade.mix->bits, from->bits, from->w * from->h * sizeof(DWORD));
+    FrameChange(from, s_frame, &s_fade.rc);
+    UnionRect(&s_fade.rc, &s_fade.rc, &prev);
+    s_fade.mix->coverId = from->coverId;
+    s_fade.mix->bg      = from->bg;
+    s_fade.mix->flags   = from->flags;
+    s_fade.mix->rcCover = from->rcCover;
+    s_fade.mix->view    = from->view;
+    s_fade.from = from;
+    s_fade.t0   = Perf_Now();
+    SetTimer(s_view, FADE_TIMER_ID, FadeInterval(s_view), NULL);
+}
+
+static void StepFade()
+{
+    if (!s_fade.mix || !s_frame ||
+        s_frame->w != s_fade.mix->w || s_frame->h != s_fade.mix->h)
+    {
+        EndFade();
+        if (s_view) KillTimer(s_view, FADE_TIMER_ID);
+        return;
+    }
+
+    // Outside this rectangle both frames are identical, so is every blend of them
+    // Вне этого прямоугольника оба кадра одинаковы, как и любая их смесь
+    RECT dirty = s_fade.rc;
+    DWORD elapsed  = Perf_SinceUs(s_fade.t0);
+    DWORD duration = (DWORD)s_fadeMs * 1000;
+    if (elapsed >= duration) {
+        // Done: the plain frame is shown again and no timer is left running
+        // Готово: снова показывается обычный кадр и ни один таймер не остаётся
+        EndFade();
+    } else {
+        // Rows outside the changed rectangle never differ, so only its rows are blended
+        // Строки вне изменённого прямоугольника не различаются, смешиваются только его строки
+        int first = dirty.top * s_frame->w;
+        int count = (dirty.bottom - dirty.top) * s_frame->w;
+        LONGLONG c0 = Perf_Now();
+        if (count > 0) {
+            Pix_Crossfade(s_fade.from->bits + first, s_frame->bits + first, s_fade.mix->bits + first,
+                          count, MulDiv((int)elapsed, 256, (int)duration));
+        }
+        s_fade.cpuUs += Perf_SinceUs(c0);
+        s_fade.steps++;
+    }
+    InvalidateRect(s_view, &dirty, FALSE);
+}
+
+// Make @f the current frame; a change of picture starts a crossfade
+// Сделать @f текущим кадром; смена картинки запускает плавный переход
+static void PresentFrame(RenderFrame* f)
+{
+    RenderFrame* old = s_frame;
+    s_frame = f;
+    if (old && old->coverId != f->coverId) {
+        BeginFade(old);   // repaints through the fade timer, or at once / перерисовка таймером перехода или сразу
+        return;
+    }
+    InvalidateFrameChange(old, f);
+    if (old && (old->w != f->w || old->h != f->h)) StashVariant(old);
+    else RenderFrame_Free(old);
+}
+
+static void AdoptReadyFrame()
+{
+    // A failed composition must not block the same request forever
+    // Неудачная композиция не должна навсегда блокировать тот же запрос
+    if (RenderWorker_TakeFailure()) ZeroMemory(&s_req, sizeof(s_req));
+
+    RenderFrame* f = RenderWorker_TakeFrame();
+    if (!f) return;
+
+    // Late frame of a cover that is already gone
+    // Запоздавший кадр обложки, которой уже нет
+    if (f->coverId != CurrentCoverId()) {
+        RenderFrame_Free(f);
+        return;
+    }
+    PresentFrame(f);
+}
+
+// "No cover" placeholder as a frame, so it can take part in crossfades
+// Заглушка "нет обложки" в виде кадра, чтобы участвовать в переходах
+static void ComposeEmptyFrame(int W, int H)
+{
+    BOOL     tint = s_tintBg && s_tint.valid;
+    COLORREF bg   = tint ? s_tint.bg : Skin_GetDialogColor();
+    if (s_frame && s_frame->coverId == 0 &&
+        s_frame->w == W && s_frame->h == H && s_frame->bg == bg) return;
+
+    RenderFrame* f = RenderFrame_Create(W, H);
+    if (!f) return;
+    f->bg = bg;
+
+    HDC mem = CreateCompatibleDC(NULL);
+    if (!mem) {
+        RenderFrame_Free(f);
+        return;
+    }
+    HGDIOBJ old = SelectObject(mem, f->hbm);
+    RECT rc = { 0, 0, W, H };
+
+    HBRUSH own = tint ? CreateSolidBrush(bg) : NULL;
+    HBRUSH br  = own ? own : Skin_GetDialogBrush();
+    if (br) FillRect(mem, &rc, br);
+    else    FillRect(mem, &rc, (HBRUSH)(COLOR_WINDOW + 1));
+    if (own) DeleteObject(own);
+
+    SetBkMode(mem, TRANSPARENT);
+    SetTextColor(mem, tint ? s_tint.text : RGB(160, 160, 160));
+    DrawTextA(mem, STR_NO_COVER, -1, &rc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+
+    // The text bounds act as the picture rectangle when tracking what changed
+    // Границы текста служат прямоугольником картинки при отслеживании изменений
+    RECT tr = rc;
+    DrawTextA(mem, STR_NO_COVER, -1, &tr, DT_SINGLELINE | DT_CALCRECT);
+    OffsetRect(&tr, (W - tr.right) / 2, (H - tr.bottom) / 2);
+    InflateRect(&tr, 2, 2);
+    IntersectRect(&f->rcCover, &tr, &rc);
+    GdiFlush();
+
+    SelectObject(mem, old);
+    DeleteDC(mem);
+    PresentFrame(f);
+}
+
+// ============================================================================
+// Zoom and Pan
+// ============================================================================
+
+static double FitScale(int W, int H)
+{
+    if (!s_cover || s_cover->sz.cx <= 0 || s_cover->sz.cy <= 0) return 1.0;
+    double sx = (double)W / s_cover->sz.cx;
+    double sy = (double)H / s_cover->sz.cy;
+    return (sx < sy) ? sx : sy;
+}
+
+// Keep the image on screen; centre it along axes where it is smaller than the window
+// Не давать изображению уйти за экран; центрировать по осям, где оно меньше окна
+static void ClampZoom(int W, int H)
+{
+    if (s_zoom.scale <= 0 || !s_cover) return;
+
+    double hw = W / (2.0 * s_zoom.scale);
+    double hh = H / (2.0 * s_zoom.scale);
+    double cw = s_cover->sz.cx, ch = s_cover->sz.cy;
+
+    if (cw <= 2 * hw)           s_zoom.cx = cw / 2;
+    else if (s_zoom.cx < hw)    s_zoom.cx = hw;
+    else if (s_zoom.cx > cw - hw) s_zoom.cx = cw - hw;
+
+    if (ch <= 2 * hh)           s_zoom.cy = ch / 2;
+    else if (s_zoom.cy < hh)    s_zoom.cy = hh;
+    else if (s_zoom.cy > ch - hh) s_zoom.cy = ch - hh;
+}
+
+// Zoom by @factor keeping the cover point under (mx, my) in place
+// Масштабировать на @factor, оставляя точку обложки под (mx, my) на месте
+static void ZoomAt(int mx, int my, double factor)
+{
+    if (!s_cover || !s_view) return;
+
+    int W, H;
+    GetViewArea(s_view, &W, &H, NULL);
+    if (W <= 0 || H <= 0) return;
+
+    double fit = FitScale(W, H);
+    double cur = s_zoom.scale;
+    if (cur <= 0) {
+        cur = fit;
+        s_zoom.cx = s_cover->sz.cx / 2.0;
+        s_zoom.cy = s_cover->sz.cy / 2.0;
+    }
+
+    double next = cur * factor;
+    double top  = (fit > ZOOM_MAX) ? fit : ZOOM_MAX;
+    if (next > top) next = top;
+    if (next <= fit * 1.001) {
+        ResetZoom();
+        RefreshView();
+        return;
+    }
+
+    double px = s_zoom.cx + (mx - W / 2.0) / cur;
+    double py = s_zoom.cy + (my - H / 2.0) / cur;
+    s_zoom.scale = next;
+    s_zoom.cx = px - (mx - W / 2.0) / next;
+    s_zoom.cy = py - (my - H / 2.0) / next;
+    ClampZoom(W, H);
+    RefreshView();
+}
+
+static BOOL SameView(const RenderView* a, const RenderView* b)
+{
+    return a->scale == b->scale && a->cx == b->cx && a->cy == b->cy;
+}
+
+// Queue a composition for the current cover unless an identical one is done or pending
+// Поставить композицию текущей обложки, если такая же ещё не готова и не в очереди
+static void RequestFrame(int W, int H)
+{
+    if (!s_cover || W <= 0 || H <= 0) return;
+
+    COLORREF bg = s_tintBg ? s_cover->dominant : Skin_GetDialogColor();
+    DWORD flags = s_blurBg ? RENDER_BLUR_BACKDROP : 0;
+    RenderView view = {0};
+    if (s_zoom.scale > 0) {
+        view.scale = s_zoom.scale;
+        view.cx    = s_zoom.cx;
+        view.cy    = s_zoom.cy;
+    }
+    if (s_frame && s_frame->coverId == s_cover->id && s_frame->w == W && s_frame->h == H &&
+        s_frame->bg == bg && s_frame->flags == flags && SameView(&s_frame->view, &view)) return;
+
+    // Back to a size seen recently (another monitor's DPI): no composition at all.
+    // Checked before the pending request, which may be for this very size, and
+    // forgets that request: it no longer describes what is on screen.
+    // Возврат к недавнему размеру (DPI другого монитора): без композиции вообще.
+    // Проверяется до ожидающего запроса, который может быть на этот же размер, и
+    // забывает этот запрос: он больше не описывает то, что на экране.
+    RenderFrame* v = (view.scale > 0) ? NULL : TakeVariant(W, H, bg, flags);
+    if (v) {
+        ZeroMemory(&s_req, sizeof(s_req));
+        PresentFrame(v);
+        return;
+    }
+
+    if (s_req.coverId == s_cover->id && s_req.w == W && s_req.h == H &&
+        s_req.bg == bg && s_req.flags == flags && SameView(&s_req.view, &view)) return;
+
+    s_req.coverId = s_cover->id;
+    s_req.w     = W;
+    s_req.h     = H;
+    s_req.bg    = bg;
+    s_req.flags = flags;
+    s_req.view  = view;
+
+    if (!RenderWorker_Request(s_cover, W, H, bg, flags, &view)) {
+        // No worker thread: compose inline as the old code did
+        // Нет рабочего потока: рисуем синхронно, как раньше
+        RenderFrame* f = Render_Compose(s_cover, W, H, bg, flags, &view);
+        if (f) PresentFrame(f);
+        else   ZeroMemory(&s_req, sizeof(s_req));
+    }
+}
+
+// Bring the frame up to date outside of WM_PAINT; the frame change invalidates what differs
+// Обновить кадр вне WM_PAINT; смена кадра объявляет недействительным то, что отличается
+static void RefreshView()
+{
+    if (!s_view || !IsWindow(s_view)) return;
+
+    int W, H;
+    GetViewArea(s_view, &W, &H, NULL);
+    if (W <= 0 || H <= 0) return;
+    if (s_cover) RequestFrame(W, H);
+    else         ComposeEmptyFrame(W, H);
+}
+
+typedef UINT (WINAPI *GetDpiForWindowFn)(HWND);
+
+// Windows 10 1607+ reports the DPI of the window's monitor; older systems have one DPI for all
+// Windows 10 1607+ сообщает DPI монитора окна; у старых систем один DPI для всех
+static int QueryDpi(HWND h)
+{
+    static GetDpiForWindowFn pGetDpiForWindow = NULL;
+    static BOOL looked = FALSE;
+    if (!looked) {
+        looked = TRUE;
+        HMODULE user = GetModuleHandleA("user32.dll");
+        if (user) pGetDpiForWindow = (GetDpiForWindowFn)GetProcAddress(user, "GetDpiForWindow");
+    }
+
+    int dpi = pGetDpiForWindow ? (int)pGetDpiForWindow(h) : 0;
+    if (dpi <= 0) {
+        HDC dc = GetDC(h);
+        if (dc) {
+            dpi = GetDeviceCaps(dc, LOGPIXELSX);
+            ReleaseDC(h, dc);
+        }
+    }
+    return (dpi > 0) ? dpi : 96;
+}
+
+static void UpdateDpi(HWND h)
+{
+    int dpi = QueryDpi(h);
+    if (dpi == s_dpi) return;
+
+    Perf_Trace("dpi %d -> %d", s_dpi, dpi);
+    s_dpi = dpi;
+    if (Strip_SetDpi(dpi) && s_strip) InvalidateRect(h, NULL, FALSE);   // band height changed / высота полосы изменилась
+    RefreshView();
+}
+
+static void InvalidateStrip(HWND h)
+{
+    int W, H;
+    RECT band;
+    GetViewArea(h, &W, &H, &band);
+    if (!IsRectEmpty(&band)) InvalidateRect(h, &band, FALSE);
+}
+
+// Skin colours changed: letterbox, placeholder and strip background follow them
+// Сменились цвета скина: за ними следуют поля, заглушка и фон ленты
+static void SkinChanged(HWND h)
+{
+    RefreshView();
+    if (!(s_tintBg && s_tint.valid)) InvalidateStrip(h);
+}
+
+#ifdef _DEBUG
+// Area of the pending update region, in pixels; call before BeginPaint
+// Площадь ожидающего региона обновления в пикселях; вызывать до BeginPaint
+static DWORD UpdatePixels(HWND h)
+{
+    DWORD px = 0;
+    HRGN rgn = CreateRectRgn(0, 0, 0, 0);
+    if (!rgn) return 0;
+    if (GetUpdateRgn(h, rgn, FALSE) > NULLREGION) {
+        DWORD cb = GetRegionData(rgn, 0, NULL);
+        RGNDATA* rd = cb ? (RGNDATA*)GlobalAlloc(GMEM_FIXED, cb) : NULL;
+        if (rd && GetRegionData(rgn, cb, rd)) {
+            const RECT* r = (const RECT*)rd->Buffer;
+            for (DWORD i = 0; i < rd->rdh.nCount; ++i) {
+                px += (DWORD)(r[i].right - r[i].left) * (DWORD)(r[i].bottom - r[i].top);
+            }
+        }
+        if (rd) GlobalFree(rd);
+    }
+    DeleteObject(rgn);
+    return px;
+}
+#endif
+
+static void PaintView(HDC dc, int W, int H)
+{
+    if (s_fade.mix) {
+        if (s_fade.mix->w == W && s_fade.mix->h == H) {
+            HDC xdc = CreateCompatibleDC(dc);
+            if (xdc) {
+                HGDIOBJ oldX = SelectObject(xdc, s_fade.mix->hbm);
+                BitBlt(dc, 0, 0, W, H, xdc, 0, 0, SRCCOPY);
+                SelectObject(xdc, oldX);
+                DeleteDC(xdc);
+                return;
+            }
+        }
+        EndFade();
+    }
+
+    HDC fdc = NULL;
+    HGDIOBJ oldF = NULL;
+    if (s_frame) {
+        fdc = CreateCompatibleDC(dc);
+        if (fdc) oldF = SelectObject(fdc, s_frame->hbm);
+    }
+
+    // Fast path: the latest frame matches the window exactly - one blit, no scaling
+    // Быстрый путь: последний кадр точно совпадает с окном - один blit, без масштабирования
+    if (fdc && s_frame->coverId == CurrentCoverId() &&
+        s_frame->w == W && s_frame->h == H)
+    {
+        BitBlt(dc, 0, 0, W, H, fdc, 0, 0, SRCCOPY);
+    }
+    else
+    {
+        // A new frame is on its way. Show the previous one with a cheap stretch
+        // (COLORONCOLOR) instead of waiting, or the placeholder if there is no cover.
+        // Новый кадр в пути. Показываем предыдущий дешёвым растяжением
+        // (COLORONCOLOR) вместо ожидания, или заглушку если обложки нет.
+        HDC mem = CreateCompatibleDC(dc);
+        HBITMAP bmp = mem ? CreateCompatibleBitmap(dc, W, H) : NULL;
+        if (bmp)
+        {
+            HGDIOBJ old = SelectObject(mem, bmp);
+            RECT rc = { 0, 0, W, H };
+
+            HBRUSH br = Skin_GetDialogBrush();
+            if (br) FillRect(mem, &rc, br);
+            else    FillRect(mem, &rc, (HBRUSH)(COLOR_WINDOW + 1));
+
+            if (s_cover)
+            {
+                if (fdc)
+                {
+                    SIZE fs;
+                    fs.cx = s_frame->rcCover.right - s_frame->rcCover.left;
+                    fs.cy = s_frame->rcCover.bottom - s_frame->rcCover.top;
+
+                    RECT dst;
+                    Render_FitRect(W, H, fs, &dst);
+                    if (!IsRectEmpty(&dst)) {
+                        SetStretchBltMode(mem, COLORONCOLOR);
+                        StretchBlt(mem, dst.left, dst.top, dst.right - dst.left, dst.bottom - dst.top,
+                                   fdc, s_frame->rcCover.left, s_frame->rcCover.top, fs.cx, fs.cy, SRCCOPY);
+                    }
+                }
+            }
+            else
+            {
+                SetBkMode(mem, TRANSPARENT);
+                SetTextColor(mem, RGB(160, 160, 160));
+                DrawTextA(mem, STR_NO_COVER, -1, &rc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+            }
+
+            BitBlt(dc, 0, 0, W, H, mem, 0, 0, SRCCOPY);
+
+            SelectObject(mem, old);
+            DeleteObject(bmp);
+        }
+        if (mem) DeleteDC(mem);
+    }
+
+    if (fdc) {
+        SelectObject(fdc, oldF);
+        DeleteDC(fdc);
     }
 }
 
@@ -217,7 +1087,16 @@ static LRESULT CALLBACK ViewProc(HWND h, UINT m, WPARAM w, LPARAM l)
     switch (m)
     {
     case WM_CREATE:
+        s_dpi = QueryDpi(h);
+        Strip_SetDpi(s_dpi);
         s_timer = SetTimer(h, 1, 700, NULL);
+        RenderWorker_Start(h, WM_APT_FRAMEREADY);
+        s_fadeMs = Ini_LoadInt(TEXT("fade_ms"), 200);
+        if (s_fadeMs < 0)    s_fadeMs = 0;
+        if (s_fadeMs > 2000) s_fadeMs = 2000;
+        s_blurBg = Ini_LoadInt(TEXT("blur_bg"), 0) ? TRUE : FALSE;
+        s_tintBg = Ini_LoadInt(TEXT("tint_bg"), 0) ? TRUE : FALSE;
+        s_strip  = Ini_LoadInt(TEXT("strip"), 0) ? TRUE : FALSE;
         // Инициализируем кисть скина один раз при создании
         WADlg_init(FindWinamp());
         Skin_RefreshDialogBrush();
@@ -233,18 +1112,27 @@ static LRESULT CALLBACK ViewProc(HWND h, UINT m, WPARAM w, LPARAM l)
             }
             return 0;
         }
+
+        if (w == FADE_TIMER_ID) {
+            StepFade();
+            return 0;
+        }
+
+        if (w == CHAPTER_TIMER_ID) {
+            StepChapters();
+            return 0;
+        }
         
         if (w == TAG_RETRY_TIMER_ID) {
             if (s_retryTries > 0 && s_lastPath[0] && !IsHttpUrl(s_lastPath) && IsTagReadingSupported(s_lastPath)) {
                 HBITMAP hb = NULL; SIZE sz;
-                if (ID3v2_LoadCoverToBitmapA(s_lastPath, &hb, &sz) ||
-                    FLAC_LoadCoverToBitmapA (s_lastPath, &hb, &sz) ||
-                    MP4_LoadCoverToBitmapA  (s_lastPath, &hb, &sz) ||
-                    APE_LoadCoverToBitmapA  (s_lastPath, &hb, &sz))
+                if (LoadTagCoverA(s_lastPath, &hb, &sz))
                 {
-                    SafeResetBitmap();
-                    s_hbm = hb; s_bm = sz;
-                    InvalidateRect(h, NULL, TRUE);
+                    SetCoverBitmap(hb, sz);
+                    ForgetChapterCover();   // the chapter image comes back on the next tick / изображение главы вернётся на следующем тике
+                    Strip_SetTrack(s_lastPath);
+                    if (s_strip) InvalidateRect(h, NULL, FALSE);   // the strip may appear / лента может появиться
+                    RefreshView();
                     StopRetry();
                     return 0;
                 }
@@ -261,85 +1149,172 @@ static LRESULT CALLBACK ViewProc(HWND h, UINT m, WPARAM w, LPARAM l)
         return 1;
 
     case WM_SIZE: 
-        InvalidateRect(h, NULL, TRUE); 
+    {
+        int W, H;
+        GetViewArea(h, &W, &H, NULL);
+        ClampZoom(W, H);
+        PicIndex_SetTargetSize(W, H);   // embedded pictures are ranked for this size / под этот размер ранжируются изображения
+        // CS_HREDRAW | CS_VREDRAW already invalidate the window, without erase
+        // CS_HREDRAW | CS_VREDRAW уже объявили окно недействительным, без стирания
         return 0;
+    }
 
-    case WM_SYSCOLORCHANGE:
-    case WM_DISPLAYCHANGE:
-        // Обновляем цвета только когда скин реально меняется
-        WADlg_init(FindWinamp());
-        Skin_RefreshDialogBrush();
-        InvalidateRect(h, NULL, TRUE);
+    case WM_MOUSEWHEEL:
+    {
+        POINT pt = { (short)LOWORD(l), (short)HIWORD(l) };
+        ScreenToClient(h, &pt);
+
+        int W, H;
+        RECT band;
+        GetViewArea(h, &W, &H, &band);
+        if (PtInRect(&band, pt)) {
+            if (Strip_Scroll(&band, ((short)HIWORD(w) > 0) ? -1 : 1)) InvalidateRect(h, &band, FALSE);
+            return 0;
+        }
+        ZoomAt(pt.x, pt.y, pow(1.25, (short)HIWORD(w) / 120.0));
         return 0;
+    }
 
-    case WM_PAINT:
+    case WM_LBUTTONDOWN:
     {
-        PAINTSTRUCT ps;
-        HDC dc = BeginPaint(h, &ps);
-        RECT rc; 
-        GetClientRect(h, &rc);
-        int W = rc.right - rc.left;
-        int H = rc.bottom - rc.top;
+        SetFocus(h);
+
+        POINT pt = { (short)LOWORD(l), (short)HIWORD(l) };
+        int W, H;
+        RECT band;
+        GetViewArea(h, &W, &H, &band);
+        if (PtInRect(&band, pt)) {
+            // Show the clicked picture; the strip keeps its thumbnails
+            // Показать выбранное изображение; лента сохраняет миниатюры
+            HBITMAP hb = NULL;
+            SIZE sz;
+            if (Strip_LoadPicture(Strip_HitTest(&band, pt), &hb, &sz)) {
+                SetCoverBitmap(hb, sz);
+                StopRetry();
+                RefreshView();
+                InvalidateStrip(h);
+            }
+            return 0;
+        }
+        if (s_zoom.scale > 0) {
+            s_zoom.drag   = TRUE;
+            s_zoom.last.x = (short)LOWORD(l);
+            s_zoom.last.y = (short)HIWORD(l);
+            SetCapture(h);
+        }
+        return 0;
+    }
 
-        if (W > 0 && H > 0 && dc)
-        {
-            HDC mem = CreateCompatibleDC(dc);
-            if (mem)
-            {
-                HBITMAP bmp = CreateCompatibleBitmap(dc, W, H);
-                if (bmp)
-                {
-                    HGDIOBJ old = SelectObject(mem, bmp);
+    case WM_RBUTTONUP:
+        s_strip = !s_strip;
+        Ini_SaveInt(TEXT("strip"), s_strip);
+        InvalidateRect(h, NULL, FALSE);
+        return 0;
 
-                    HBRUSH br = Skin_GetDialogBrush();
-                    if (br) FillRect(mem, &rc, br);
-                    else    FillRect(mem, &rc, (HBRUSH)(COLOR_WINDOW + 1));
+    case WM_MOUSEMOVE:
+        if (s_zoom.drag && s_zoom.scale > 0) {
+            int x = (short)LOWORD(l), y = (short)HIWORD(l);
+            s_zoom.cx -= (x - s_zoom.last.x) / s_zoom.scale;
+            s_zoom.cy -= (y - s_zoom.last.y) / s_zoom.scale;
+            s_zoom.last.x = x;
+            s_zoom.last.y = y;
+
+            int W, H;
+            GetViewArea(h, &W, &H, NULL);
+            ClampZoom(W, H);
+            RefreshView();
+        }
+        return 0;
 
-                    if (s_hbm && s_bm.cx > 0 && s_bm.cy > 0)
-                    {
-                        double sx = (double)W / (double)s_bm.cx;
-                        double sy = (double)H / (double)s_bm.cy;
-                        double s = (sx < sy) ? sx : sy;
+    case WM_LBUTTONUP:
+        if (s_zoom.drag) ReleaseCapture();
+        return 0;
 
-                        int wdst = (int)(s_bm.cx * s);
-                        int hdst = (int)(s_bm.cy * s);
-                        int x = (W - wdst) / 2;
-                        int y = (H - hdst) / 2;
+    case WM_CAPTURECHANGED:
+        s_zoom.drag = FALSE;
+        return 0;
 
-                        HDC src = CreateCompatibleDC(dc);
-                        if (src)
-                        {
-                            HGDIOBJ oS = SelectObject(src, s_hbm);
+    case WM_LBUTTONDBLCLK:
+        ResetZoom();
+        RefreshView();
+        return 0;
 
-                            int mode = (s < 1.0) ? HALFTONE : COLORONCOLOR;
-                            SetStretchBltMode(mem, mode);
-                            if (mode == HALFTONE) SetBrushOrgEx(mem, 0, 0, NULL);
+    case WM_SETCURSOR:
+        if (s_zoom.scale > 0 && LOWORD(l) == HTCLIENT) {
+            SetCursor(LoadCursor(NULL, IDC_SIZEALL));
+            return TRUE;
+        }
+        break;
+
+    case WM_SYSCOLORCHANGE:
+    case WM_DISPLAYCHANGE:
+        // Обновляем цвета только когда скин реально меняется
+        WADlg_init(FindWinamp());
+        Skin_RefreshDialogBrush();
+        if (m == WM_DISPLAYCHANGE) UpdateDpi(h);
+        SkinChanged(h);
+        return 0;
 
-                            StretchBlt(mem, x, y, wdst, hdst, src, 0, 0, s_bm.cx, s_bm.cy, SRCCOPY);
+    case WM_DPICHANGED:
+    case WM_DPICHANGED_AFTERPARENT:
+        // The new physical size arrives with WM_SIZE; frames come from the variant or mip caches
+        // Новый физический размер приходит с WM_SIZE; кадры берутся из кэшей вариантов или уменьшений
+        UpdateDpi(h);
+        return 0;
 
-                            SelectObject(src, oS);
-                            DeleteDC(src);
-                        }
-                    }
-                    else
-                    {
-                        SetBkMode(mem, TRANSPARENT);
-                        SetTextColor(mem, RGB(160, 160, 160));
-                        DrawTextA(mem, STR_NO_COVER, -1, &rc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-                    }
+    case WM_PAINT:
+    {
+        // Bring the frame up to date before BeginPaint: whatever a new frame invalidates
+        // joins this paint's update region instead of being left on screen
+        // Обновить кадр до BeginPaint: всё, что объявит недействительным новый кадр,
+        // входит в регион обновления этой отрисовки, а не остаётся на экране
+        int W, H;
+        RECT band;
+        GetViewArea(h, &W, &H, &band);
+        if (W > 0 && H > 0) {
+            AdoptReadyFrame();
+            if (s_cover) RequestFrame(W, H);
+            else         ComposeEmptyFrame(W, H);
+        }
 
-                    BitBlt(dc, 0, 0, W, H, mem, 0, 0, SRCCOPY);
+#ifdef _DEBUG
+        s_paint.lastPixels = UpdatePixels(h);
+        s_paint.pixels    += s_paint.lastPixels;
+        s_paint.paints++;
+        Perf_Trace("paint #%lu: %lu px", s_paint.paints, s_paint.lastPixels);
+#endif
 
-                    SelectObject(mem, old);
-                    DeleteObject(bmp);
-                }
-                DeleteDC(mem);
+        PAINTSTRUCT ps;
+        HDC dc = BeginPaint(h, &ps);
+        if (dc && W > 0 && H > 0) PaintView(dc, W, H);
+        if (dc && !IsRectEmpty(&band)) {
+            BOOL     tint = s_tintBg && s_tint.valid;
+            COLORREF bg   = tint ? s_tint.bg : Skin_GetDialogColor();
+            COLORREF mark = tint ? s_tint.text : RGB(160, 160, 160);
+            // Thumbnails scrolled into view are decoded one per message, after painting
+            // Миниатюры, попавшие в видимую область, декодируются по одной за сообщение, после отрисовки
+            if (Strip_Paint(dc, &band, bg, mark) && !s_thumbPosted) {
+                s_thumbPosted = PostMessage(h, WM_APT_THUMBNEXT, 0, 0);
             }
         }
-
         EndPaint(h, &ps);
         return 0;
     }
+
+    case WM_APT_THUMBNEXT:
+    {
+        s_thumbPosted = FALSE;
+        int W, H;
+        RECT band;
+        GetViewArea(h, &W, &H, &band);
+        if (!IsRectEmpty(&band) && Strip_DecodeNext(&band)) InvalidateRect(h, &band, FALSE);
+        return 0;
+    }
+
+    case WM_APT_FRAMEREADY:
+        AdoptReadyFrame();
+        return 0;
+
 case WM_NCDESTROY:
         // Final cleanup: if our DLL is unloaded, class must not remain registered
         // Финальная очистка: при выгрузке DLL класс не должен оставаться зарегистрированным
@@ -356,10 +1331,30 @@ case WM_NCDESTROY:
         return 0;
 
     case WM_DESTROY:
+        EndFade();
         if (s_timer) KillTimer(h, s_timer);
         StopRetry(); 
+        StopChapters();
         if (h == s_view) s_view = NULL;
+        RenderWorker_Stop();
+        RenderFrame_Free(s_frame);
+        s_frame = NULL;
+        DropVariants();
+        ZeroMemory(&s_req, sizeof(s_req));
         SafeResetBitmap();
+        Strip_SetTrack(NULL);
+        s_thumbPosted = FALSE;
+        {
+            char line[160];
+            Perf_HistFormat(&s_fadeCpu, line, sizeof(line));
+            Perf_Trace("fade cpu per transition %s", line);
+
+            StripStats ss;
+            Strip_GetStats(&ss);
+            Perf_Trace("strip: %lu indexed, %lu decoded, %lu failed", ss.indexed, ss.decoded, ss.failed);
+            Perf_Trace("paint: %lu updates, %I64u px", s_paint.paints, s_paint.pixels);
+            Perf_Trace("frame variants: %lu hits, %lu misses", s_variants.hits, s_variants.misses);
+        }
         return 0;
     }
     return DefWindowProcA(h, m, w, l);
@@ -382,7 +1377,7 @@ void CoverView_Attach(HWND parent)
             wc.hInstance     = UIHost_GetHInstance();
             if (!wc.hInstance) wc.hInstance = GetModuleHandleA(NULL);
             wc.lpszClassName = "APT_CoverArtView";
-            wc.style         = CS_HREDRAW | CS_VREDRAW;
+            wc.style         = CS_HREDRAW | CS_VREDRAW | CS_DBLCLKS;
             s_cls = RegisterClassA(&wc);
         }
 
@@ -401,6 +1396,11 @@ void CoverView_Attach(HWND parent)
     }
 }
 
+void CoverView_SkinChanged(void)
+{
+    if (s_view && IsWindow(s_view)) SkinChanged(s_view);
+}
+
 void CoverView_ReloadFromCurrent()
 
 {
@@ -410,7 +1410,8 @@ void CoverView_ReloadFromCurrent()
     } else { 
         s_lastPath[0] = 0; 
         SafeResetBitmap(); 
-        if (s_view && IsWindow(s_view)) InvalidateRect(s_view, NULL, TRUE);
+        Strip_SetTrack(NULL);
+        RefreshView();
     }
 }
 
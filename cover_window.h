@@ -71,6 +71,20 @@ void CoverView_Attach(HWND parent);
  */
 void CoverView_ReloadFromCurrent();
 
+/**
+ * @brief Repaint after the skin colours changed
+ * @brief Перерисовать после смены цветов скина
+ *
+ * Re-composes the current frame and invalidates only what differs from the
+ * frame on screen (letterbox bands, placeholder text), without erasing.
+ * Call after WADlg_init() and Skin_RefreshDialogBrush().
+ *
+ * Пересобирает текущий кадр и объявляет недействительным только то, что
+ * отличается от кадра на экране (поля, текст заглушки), без стирания.
+ * Вызывать после WADlg_init() и Skin_RefreshDialogBrush().
+ */
+void CoverView_SkinChanged(void);
+
 /**
  * @brief Find an existing cover viewer window attached to a parent
  * @brief Найти существующее окно просмотра обложек, прикреплённое к родителю
@@ -186,45 +186,84 @@ static BOOL LooksLikeKnownImage(const BYTE* p, DWORD n) {
 }
 
 // ============================================================================
-// DPI and Conversion Helpers / Помощники для DPI и конверсии
+// Header-Only Size Probing / Определение размера только по заголовку
 // ============================================================================
 
 /**
- * @brief Convert HIMETRIC units to pixels
- * @brief Конвертировать HIMETRIC единицы в пиксели
- * 
- * HIMETRIC is a logical unit of 0.01 millimeter, used by OLE IPicture.
- * This function converts to pixels based on the screen DPI.
- * 
- * HIMETRIC - это логическая единица 0.01 миллиметра, используемая OLE IPicture.
- * Эта функция конвертирует в пиксели на основе DPI экрана.
- * 
- * Formula / Формула: pixels = (HIMETRIC * DPI) / 2540
- * 
- * @param hmWidth  Width in HIMETRIC / Ширина в HIMETRIC
- * @param hmHeight Height in HIMETRIC / Высота в HIMETRIC
- * @param outPx    [out] Output dimensions in pixels / Выходные размеры в пикселях
+ * @brief Read the frame size of a JPEG from its SOFn marker
+ * @brief Прочитать размер кадра JPEG из маркера SOFn
+ *
+ * Walks the marker segments by their lengths; entropy-coded data is never scanned.
+ * Проходит сегменты маркеров по их длинам; сжатые данные не сканируются.
  */
-static void HimetricToPixels(LONG hmWidth, LONG hmHeight, SIZE* outPx) {
-    if (!outPx) return;
+static BOOL ProbeJPEG(const BYTE* p, DWORD n, SIZE* out) {
+    DWORD i = 2;
+    while (i + 4 <= n) {
+        if (p[i] != 0xFF) return FALSE;
+        BYTE m = p[i + 1];
+        if (m == 0xFF) { ++i; continue; }                 // fill byte / байт-заполнитель
+        if (m == 0xD8 || (m >= 0xD0 && m <= 0xD7) || m == 0x01) { i += 2; continue; }
+        if (m == 0xD9 || m == 0xDA) return FALSE;         // EOI/SOS before any SOF
+
+        DWORD len = ((DWORD)p[i + 2] << 8) | p[i + 3];
+        if (len < 2) return FALSE;
+        // SOF0-SOF15 except DHT (C4), JPG (C8) and DAC (CC)
+        if (m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+            if (i + 9 > n) return FALSE;
+            out->cy = ((LONG)p[i + 5] << 8) | p[i + 6];
+            out->cx = ((LONG)p[i + 7] << 8) | p[i + 8];
+            return out->cx > 0 && out->cy > 0;
+        }
+        i += 2 + len;
+    }
+    return FALSE;
+}
 
-    HDC hdc = GetDC(NULL);
+/**
+ * @brief Get image dimensions from the header only, without decoding
+ * @brief Получить размеры изображения только по заголовку, без декодирования
+ */
+int __cdecl Img_ProbeSize(const BYTE* p, DWORD n, SIZE* psz) {
+    if (!p || !psz) return FALSE;
+    psz->cx = psz->cy = 0;
 
-    // Get screen DPI (default to 96 if unavailable) / Получить DPI экрана (по умолчанию 96, если недоступно)
-    int dpiX = 96, dpiY = 96;
-    if (hdc) {
-        dpiX = GetDeviceCaps(hdc, LOGPIXELSX);
-        dpiY = GetDeviceCaps(hdc, LOGPIXELSY);
-        if (dpiX <= 0) dpiX = 96;
-        if (dpiY <= 0) dpiY = 96;
-        ReleaseDC(NULL, hdc);
-    }
+    if (LooksLikeJPEG(p, n)) return ProbeJPEG(p, n, psz);
 
-    // Convert HIMETRIC to pixels / Конвертировать HIMETRIC в пиксели
-    outPx->cx = MulDiv(hmWidth,  dpiX, 2540);
-    outPx->cy = MulDiv(hmHeight, dpiY, 2540);
+    if (LooksLikePNG(p, n)) {
+        // IHDR is always the first chunk / IHDR всегда первый чанк
+        if (n < 24 || memcmp(p + 12, "IHDR", 4) != 0) return FALSE;
+        psz->cx = (LONG)(((DWORD)p[16] << 24) | ((DWORD)p[17] << 16) | ((DWORD)p[18] << 8) | p[19]);
+        psz->cy = (LONG)(((DWORD)p[20] << 24) | ((DWORD)p[21] << 16) | ((DWORD)p[22] << 8) | p[23]);
+    }
+    else if (LooksLikeGIF(p, n)) {
+        if (n < 10) return FALSE;
+        psz->cx = p[6] | (p[7] << 8);
+        psz->cy = p[8] | (p[9] << 8);
+    }
+    else if (LooksLikeBMP(p, n)) {
+        if (n < 26) return FALSE;
+        DWORD hdr = *(const DWORD*)(p + 14);
+        if (hdr == 12) {   // BITMAPCOREHEADER
+            psz->cx = *(const WORD*)(p + 18);
+            psz->cy = *(const WORD*)(p + 20);
+        } else {
+            psz->cx = *(const LONG*)(p + 18);
+            psz->cy = *(const LONG*)(p + 22);
+            if (psz->cy < 0) psz->cy = -psz->cy;   // top-down / сверху вниз
+        }
+    }
+    else if (LooksLikeICO(p, n)) {
+        if (n < 8) return FALSE;
+        psz->cx = p[6] ? p[6] : 256;   // 0 means 256 / 0 означает 256
+        psz->cy = p[7] ? p[7] : 256;
+    }
+    return psz->cx > 0 && psz->cy > 0;
 }
 
+// ============================================================================
+// Conversion Helpers / Помощники конверсии
+// ============================================================================
+
 /**
  * @brief Create a deep copy of an HBITMAP
  * @brief Создать глубокую копию HBITMAP
@@ -236,9 +275,10 @@ static void HimetricToPixels(LONG hmWidth, LONG hmHeight, SIZE* outPx) {
  * Нам нужно создать копию, которой мы можем безопасно управлять сами.
  * 
  * @param src Source bitmap to copy / Исходный bitmap для копирования
+ * @param outSz [out] Size of the copy in pixels, or NULL / Размер копии в пикселях, или NULL
  * @return New bitmap handle, or NULL on failure / Новый дескриптор bitmap'а, или NULL при ошибке
  */
-static HBITMAP DeepCopyHBITMAP(HBITMAP src) {
+static HBITMAP DeepCopyHBITMAP(HBITMAP src, SIZE* outSz) {
     if (!src) return NULL;
 
     HDC hdc = GetDC(NULL);
@@ -302,6 +342,10 @@ static HBITMAP DeepCopyHBITMAP(HBITMAP src) {
     DeleteDC(ddc);
     ReleaseDC(NULL, hdc);
 
+    if (outSz) {
+        outSz->cx = bm.bmWidth;
+        outSz->cy = bm.bmHeight;
+    }
     return copy;
 }
 
@@ -388,15 +432,14 @@ static BOOL LoadImageViaOle(const BYTE* data, DWORD cb, HBITMAP* phbm, SIZE* psz
         return FALSE; 
     }
 
-    // Get dimensions in HIMETRIC and convert to pixels / Получить размеры в HIMETRIC и конвертировать в пиксели
-    LONG hmW=0, hmH=0;
-    pic->get_Width(&hmW);
-    pic->get_Height(&hmH);
-    SIZE px; 
-    HimetricToPixels(hmW, hmH, &px);
+    // The size comes from the bitmap itself: HIMETRIC converted with the screen DPI is
+    // wrong on any monitor that is not 96 DPI, and cost a GetDC per decode
+    // Размер берётся из самого bitmap'а: HIMETRIC, пересчитанный по DPI экрана, неверен
+    // на любом мониторе не с 96 DPI и стоил GetDC на каждое декодирование
+    SIZE px = {0, 0};
 
     // Create a deep copy (IPicture owns the original) / Создать глубокую копию (IPicture владеет оригиналом)
-    HBITMAP copy = DeepCopyHBITMAP((HBITMAP)hPic);
+    HBITMAP copy = DeepCopyHBITMAP((HBITMAP)hPic, &px);
     pic->Release();
     if (!copy) return FALSE;
 
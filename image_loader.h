@@ -100,6 +100,28 @@ int __cdecl Img_LoadFromMemoryToBitmap(const BYTE* buf, DWORD sz, HBITMAP* phbm,
  */
 int __cdecl Img_LoadFromFileA(const char* path, HBITMAP* phbm, SIZE* psz);
 
+/// Largest picture worth decoding (32bpp: 256 MB) / Наибольшее изображение, которое стоит декодировать (32bpp: 256 МБ)
+#define IMG_MAX_PIXELS (8192.0 * 8192.0)
+
+/**
+ * @brief Get image dimensions from the header only
+ * @brief Получить размеры изображения только по заголовку
+ *
+ * Reads the JPEG SOF marker, PNG IHDR, GIF screen descriptor, BMP info
+ * header or the first ICO entry. Nothing is decoded, so callers can rank
+ * several embedded pictures and decode just the chosen one.
+ *
+ * Читает маркер SOF JPEG, IHDR PNG, дескриптор экрана GIF, заголовок BMP
+ * или первую запись ICO. Ничего не декодируется, поэтому вызывающий может
+ * ранжировать несколько встроенных изображений и декодировать только выбранное.
+ *
+ * @param buf Image bytes (a prefix is enough) / Байты изображения (достаточно начала)
+ * @param sz  Bytes available / Доступно байт
+ * @param psz [out] Width and height in pixels / Ширина и высота в пикселях
+ * @return Non-zero if the size was found / Ненулевое значение если размер найден
+ */
+int __cdecl Img_ProbeSize(const BYTE* buf, DWORD sz, SIZE* psz);
+
 /**
  * @brief Clean up image loader resources (GDI+ shutdown)
  * @brief Очистить ресурсы загрузчика изображений (завершение работы GDI+)
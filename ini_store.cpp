@@ -252,3 +252,43 @@ void Ini_SaveWindowOpen(int isOpen)
     WritePrivateProfileStringA("Album Art", "open", buf, s_iniPath);
 #endif
 }
+
+// ============================================================================
+// Generic Options / Универсальные опции
+// ============================================================================
+
+/**
+ * @brief Load an integer option / Загрузить целочисленную опцию
+ *
+ * INI structure / Структура INI:
+ * [Album Art]
+ * fade_ms=200
+ *
+ * @param key Key name / Имя ключа
+ * @param def Default when the key is missing / Значение, если ключа нет
+ * @return Stored value or default / Сохранённое значение или значение по умолчанию
+ */
+int Ini_LoadInt(LPCTSTR key, int def)
+{
+    Ini_EnsurePath();
+    return (int)GetPrivateProfileInt(TEXT("Album Art"), key, def, s_iniPath);
+}
+
+/**
+ * @brief Save an integer option / Сохранить целочисленную опцию
+ *
+ * @param key   Key name / Имя ключа
+ * @param value Value to store / Сохраняемое значение
+ */
+void Ini_SaveInt(LPCTSTR key, int value)
+{
+    Ini_EnsurePath();
+    TCHAR buf[16];
+#if defined(UNICODE) || defined(_UNICODE)
+    wsprintfW(buf, L"%d", value);
+    WritePrivateProfileStringW(L"Album Art", key, buf, s_iniPath);
+#else
+    wsprintfA(buf, "%d", value);
+    WritePrivateProfileStringA("Album Art", key, buf, s_iniPath);
+#endif
+}
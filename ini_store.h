@@ -18,6 +18,10 @@
  * w=300        ; Window width / Ширина окна
  * h=300        ; Window height / Высота окна
  * open=1       ; Window open state (0=closed, 1=open) / Состояние окна (0=закрыто, 1=открыто)
+ * fade_ms=200  ; Cover crossfade duration, 0=off / Длительность смены обложки, 0=выкл
+ * blur_bg=0    ; Blurred cover in the letterbox / Размытая обложка на полях
+ * tint_bg=0    ; Background from the cover's colours / Фон из цветов обложки
+ * strip=0      ; Thumbnail strip of embedded pictures, right click toggles / Лента встроенных изображений, переключается правым кликом
  * 
  * @note Uses Windows API GetPrivateProfileInt/WritePrivateProfileString
  * @note Использует Windows API GetPrivateProfileInt/WritePrivateProfileString
@@ -125,3 +129,28 @@ bool Ini_LoadWindowOpen(int& isOpen);
  * @note Ненулевые значения конвертируются в 1 перед сохранением
  */
 void Ini_SaveWindowOpen(int isOpen);
+
+/**
+ * @brief Load an integer option from the [Album Art] section
+ * @brief Загрузить целочисленную опцию из секции [Album Art]
+ *
+ * Generic accessor for small tuning options that don't deserve a dedicated
+ * function (effects, timings). Missing keys return @p def.
+ *
+ * Универсальный доступ к небольшим настройкам, не заслуживающим отдельной
+ * функции (эффекты, тайминги). Для отсутствующих ключей возвращается @p def.
+ *
+ * @param key Key name / Имя ключа
+ * @param def Default value / Значение по умолчанию
+ * @return Stored value or @p def / Сохранённое значение или @p def
+ */
+int Ini_LoadInt(LPCTSTR key, int def);
+
+/**
+ * @brief Save an integer option to the [Album Art] section
+ * @brief Сохранить целочисленную опцию в секцию [Album Art]
+ *
+ * @param key   Key name / Имя ключа
+ * @param value Value to store / Сохраняемое значение
+ */
+void Ini_SaveInt(LPCTSTR key, int value);
@@ -0,0 +1,143 @@
+/**
+ * @file perf_stats.h
+ * @brief Lightweight timing and histogram helpers
+ * @brief Лёгкие помощники для замеров времени и гистограмм
+ *
+ * Small header-only toolbox used by the render and tag-reading paths to
+ * measure how long things take. Everything is based on QueryPerformanceCounter
+ * and fixed-size counters, so it costs nothing when nobody reads the numbers.
+ *
+ * Небольшой header-only набор, используемый путями отрисовки и чтения тегов
+ * для замера длительности операций. Всё построено на QueryPerformanceCounter
+ * и счётчиках фиксированного размера, поэтому ничего не стоит, пока цифры никто не читает.
+ *
+ * Histogram buckets / Корзины гистограммы:
+ * [0] < 1 ms, [1] < 2 ms, [2] < 4 ms, ... [7] < 128 ms, [8] >= 128 ms
+ *
+ * @note Perf_Trace() is compiled out in release builds
+ * @note Perf_Trace() исключается из release-сборок
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#define PERF_HIST_BUCKETS 9
+
+/**
+ * @brief Power-of-two millisecond histogram
+ * @brief Гистограмма в миллисекундах со степенями двойки
+ */
+typedef struct {
+    DWORD bucket[PERF_HIST_BUCKETS]; ///< Sample counts per bucket / Число замеров в корзине
+    DWORD count;                     ///< Total samples / Всего замеров
+    DWORD maxUs;                     ///< Worst sample in microseconds / Худший замер в микросекундах
+    DWORD lastUs;                    ///< Most recent sample / Последний замер
+} PerfHistogram;
+
+/**
+ * @brief Read the high resolution counter
+ * @brief Прочитать счётчик высокого разрешения
+ */
+inline LONGLONG Perf_Now() {
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+}
+
+/**
+ * @brief Convert a counter delta to microseconds
+ * @brief Перевести разницу счётчика в микросекунды
+ *
+ * @param ticks Delta between two Perf_Now() values / Разница двух значений Perf_Now()
+ * @return Microseconds, clamped to DWORD / Микросекунды, ограниченные DWORD
+ */
+inline DWORD Perf_TicksToUs(LONGLONG ticks) {
+    static LONGLONG freq = 0;
+    if (!freq) {
+        LARGE_INTEGER f;
+        freq = QueryPerformanceFrequency(&f) && f.QuadPart ? f.QuadPart : 1;
+    }
+    if (ticks <= 0) return 0;
+    LONGLONG us = (ticks * 1000000) / freq;
+    return (us > 0xFFFFFFFF) ? 0xFFFFFFFF : (DWORD)us;
+}
+
+/**
+ * @brief Microseconds elapsed since a Perf_Now() stamp
+ * @brief Микросекунды, прошедшие с момента Perf_Now()
+ */
+inline DWORD Perf_SinceUs(LONGLONG start) {
+    return Perf_TicksToUs(Perf_Now() - start);
+}
+
+/**
+ * @brief Add one sample to a histogram
+ * @brief Добавить замер в гистограмму
+ *
+ * @param h  Histogram / Гистограмма
+ * @param us Sample in microseconds / Замер в микросекундах
+ */
+inline void Perf_HistAdd(PerfHistogram* h, DWORD us) {
+    if (!h) return;
+    DWORD ms = us / 1000;
+    int i = 0;
+    while (i < PERF_HIST_BUCKETS - 1 && ms >= ((DWORD)1 << i)) ++i;
+    h->bucket[i]++;
+    h->count++;
+    h->lastUs = us;
+    if (us > h->maxUs) h->maxUs = us;
+}
+
+/**
+ * @brief Format a histogram as a single text line
+ * @brief Отформатировать гистограмму в одну строку текста
+ *
+ * Output example / Пример вывода:
+ * "n=42 max=17.3ms [<1:30 <2:8 <4:2 <8:1 <16:0 <32:1 <64:0 <128:0 >=128:0]"
+ *
+ * @param h   Histogram / Гистограмма
+ * @param out Output buffer / Выходной буфер
+ * @param cch Buffer size (at least 128) / Размер буфера (минимум 128)
+ */
+inline void Perf_HistFormat(const PerfHistogram* h, char* out, int cch) {
+    if (!out || cch < 128) return;
+    if (!h) { out[0] = 0; return; }
+    int n = wsprintfA(out, "n=%lu max=%lu.%lums [", h->count, h->maxUs / 1000, (h->maxUs % 1000) / 100);
+    for (int i = 0; i < PERF_HIST_BUCKETS && n < cch - 24; ++i) {
+        if (i < PERF_HIST_BUCKETS - 1)
+            n += wsprintfA(out + n, "%s<%d:%lu", i ? " " : "", 1 << i, h->bucket[i]);
+        else
+            n += wsprintfA(out + n, " >=%d:%lu", 1 << (i - 1), h->bucket[i]);
+    }
+    lstrcpynA(out + n, "]", cch - n);
+}
+
+/**
+ * @brief Debug trace to the debugger output window
+ * @brief Отладочный вывод в окно отладчика
+ *
+ * @note Empty in release builds / Пустая в release-сборках
+ */
+inline void Perf_Trace(const char* fmt, ...) {
+#ifdef _DEBUG
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    lstrcpyA(buf, "[gen_art] ");
+    _vsnprintf(buf + 10, sizeof(buf) - 12, fmt, ap);
+    va_end(ap);
+    buf[sizeof(buf) - 2] = 0;
+    lstrcatA(buf, "\n");
+    OutputDebugStringA(buf);
+#else
+    (void)fmt;
+#endif
+}
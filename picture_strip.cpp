@@ -0,0 +1,251 @@
+/**
+ * @file picture_strip.cpp
+ * @brief Thumbnail strip implementation
+ * @brief Реализация ленты миниатюр
+ *
+ * Cells scroll in whole thumbnails; cell i is visible when it starts left of
+ * the band's right edge, so a partly visible last cell is decoded too.
+ * Ячейки прокручиваются целыми миниатюрами; ячейка i видима, если начинается
+ * левее правого края полосы, поэтому частично видимая последняя тоже декодируется.
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "picture_strip.h"
+#include "render_worker.h"
+#include "Extensions\picture_index.h"
+
+// ============================================================================
+// State / Состояние
+// ============================================================================
+
+static char         s_path[MAX_PATH] = {0};
+static BOOL         s_indexed = FALSE;
+static PictureIndex s_idx     = {0};
+static RenderFrame* s_thumb[PICINDEX_MAX] = {0};  // NULL = not decoded yet / NULL = ещё не декодирована
+static BOOL         s_failed[PICINDEX_MAX] = {0};
+static int          s_first   = 0;                // first visible cell / первая видимая ячейка
+static int          s_sel     = -1;               // picture shown in the view / изображение в окне
+static StripStats   s_stats   = {0};
+static int          s_cell    = STRIP_THUMB;      // cell edge at the current DPI / сторона ячейки при текущем DPI
+static int          s_gap     = STRIP_GAP;
+
+#define STRIP_STEP (s_cell + s_gap)
+
+static void FreeThumbs()
+{
+    for (int i = 0; i < PICINDEX_MAX; ++i) {
+        RenderFrame_Free(s_thumb[i]);
+        s_thumb[i]  = NULL;
+        s_failed[i] = FALSE;
+    }
+}
+
+void Strip_SetTrack(const char* path)
+{
+    FreeThumbs();
+    ZeroMemory(&s_idx, sizeof(s_idx));
+    s_indexed = FALSE;
+    s_first   = 0;
+    s_sel     = -1;
+    if (path) lstrcpynA(s_path, path, MAX_PATH);
+    else      s_path[0] = 0;
+}
+
+BOOL Strip_SetDpi(int dpi)
+{
+    if (dpi <= 0) dpi = 96;
+    int cell = MulDiv(STRIP_THUMB, dpi, 96);
+    if (cell == s_cell) return FALSE;
+
+    s_cell = cell;
+    s_gap  = MulDiv(STRIP_GAP, dpi, 96);
+    FreeThumbs();
+    return TRUE;
+}
+
+int Strip_Height(void)
+{
+    return s_cell + 2 * s_gap;
+}
+
+int Strip_Count(void)
+{
+    if (!s_indexed && s_path[0]) {
+        s_indexed = TRUE;
+        s_stats.indexed += PicIndex_BuildA(s_path, &s_idx);
+    }
+    return s_idx.count;
+}
+
+// ============================================================================
+// Layout / Раскладка
+// ============================================================================
+
+static void CellRect(const RECT* band, int i, RECT* out)
+{
+    out->left   = band->left + s_gap + (i - s_first) * STRIP_STEP;
+    out->top    = band->top + s_gap;
+    out->right  = out->left + s_cell;
+    out->bottom = out->top + s_cell;
+}
+
+static int LastVisible(const RECT* band)
+{
+    int n = (band->right - band->left - s_gap + STRIP_STEP - 1) / STRIP_STEP;
+    int last = s_first + (n < 1 ? 1 : n) - 1;
+    return (last < s_idx.count - 1) ? last : s_idx.count - 1;
+}
+
+BOOL Strip_Scroll(const RECT* band, int cells)
+{
+    if (!band || s_idx.count <= 0) return FALSE;
+
+    int fit = (band->right - band->left - s_gap) / STRIP_STEP;
+    if (fit < 1) fit = 1;
+    int top = s_idx.count - fit;
+    if (top < 0) top = 0;
+
+    int first = s_first + cells;
+    if (first > top) first = top;
+    if (first < 0)   first = 0;
+    if (first == s_first) return FALSE;
+    s_first = first;
+    return TRUE;
+}
+
+int Strip_HitTest(const RECT* band, POINT pt)
+{
+    if (!band || !PtInRect(band, pt)) return -1;
+    int last = LastVisible(band);
+    for (int i = s_first; i <= last; ++i) {
+        RECT rc;
+        CellRect(band, i, &rc);
+        if (PtInRect(&rc, pt)) return i;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Thumbnails / Миниатюры
+// ============================================================================
+
+static RenderFrame* MakeThumb(HBITMAP hb, SIZE sz)
+{
+    RECT fit;
+    Render_FitRect(s_cell, s_cell, sz, &fit);
+    RenderFrame* t = RenderFrame_Create(fit.right - fit.left, fit.bottom - fit.top);
+    if (!t) return NULL;
+
+    HDC dst = CreateCompatibleDC(NULL);
+    HDC src = CreateCompatibleDC(NULL);
+    if (dst && src) {
+        HGDIOBJ oldD = SelectObject(dst, t->hbm);
+        HGDIOBJ oldS = SelectObject(src, hb);
+        SetStretchBltMode(dst, HALFTONE);
+        SetBrushOrgEx(dst, 0, 0, NULL);
+        StretchBlt(dst, 0, 0, t->w, t->h, src, 0, 0, sz.cx, sz.cy, SRCCOPY);
+        GdiFlush();
+        SelectObject(src, oldS);
+        SelectObject(dst, oldD);
+    }
+    if (src) DeleteDC(src);
+    if (dst) DeleteDC(dst);
+    return t;
+}
+
+BOOL Strip_DecodeNext(const RECT* band)
+{
+    if (!band || !s_indexed) return FALSE;
+
+    int last = LastVisible(band);
+    for (int i = s_first; i <= last; ++i) {
+        if (s_thumb[i] || s_failed[i]) continue;
+
+        HBITMAP hb = NULL;
+        SIZE sz = {0, 0};
+        if (PicIndex_LoadA(s_path, &s_idx.items[i], &hb, &sz) && hb) {
+            s_thumb[i] = MakeThumb(hb, sz);
+            DeleteObject(hb);
+        }
+        if (s_thumb[i]) s_stats.decoded++;
+        else {
+            s_failed[i] = TRUE;
+            s_stats.failed++;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+BOOL Strip_LoadPicture(int i, HBITMAP* phbm, SIZE* psz)
+{
+    if (i < 0 || i >= s_idx.count) return FALSE;
+    if (!PicIndex_LoadA(s_path, &s_idx.items[i], phbm, psz)) return FALSE;
+    s_sel = i;
+    return TRUE;
+}
+
+// ============================================================================
+// Painting / Отрисовка
+// ============================================================================
+
+BOOL Strip_Paint(HDC dc, const RECT* band, COLORREF bg, COLORREF mark)
+{
+    int W = band->right - band->left, H = band->bottom - band->top;
+    if (!dc || W <= 0 || H <= 0) return FALSE;
+
+    HDC mem = CreateCompatibleDC(dc);
+    HBITMAP bmp = mem ? CreateCompatibleBitmap(dc, W, H) : NULL;
+    if (!bmp) {
+        if (mem) DeleteDC(mem);
+        return FALSE;
+    }
+    HGDIOBJ old = SelectObject(mem, bmp);
+    RECT local = { 0, 0, W, H };
+
+    HBRUSH br = CreateSolidBrush(bg);
+    if (br) {
+        FillRect(mem, &local, br);
+        DeleteObject(br);
+    }
+
+    BOOL pending = FALSE;
+    HDC tdc = CreateCompatibleDC(dc);
+    HBRUSH frame = CreateSolidBrush(mark);
+    int last = LastVisible(&local);
+
+    for (int i = s_first; i <= last; ++i) {
+        RECT rc;
+        CellRect(&local, i, &rc);
+
+        RenderFrame* t = s_thumb[i];
+        if (t && tdc) {
+            HGDIOBJ oldT = SelectObject(tdc, t->hbm);
+            BitBlt(mem, rc.left + (s_cell - t->w) / 2, rc.top + (s_cell - t->h) / 2,
+                   t->w, t->h, tdc, 0, 0, SRCCOPY);
+            SelectObject(tdc, oldT);
+        } else if (!s_failed[i]) {
+            pending = TRUE;
+        }
+
+        if (frame && i == s_sel) {
+            RECT fr = rc;
+            InflateRect(&fr, 2, 2);
+            FrameRect(mem, &fr, frame);
+        }
+    }
+    if (frame) DeleteObject(frame);
+    if (tdc) DeleteDC(tdc);
+
+    BitBlt(dc, band->left, band->top, W, H, mem, 0, 0, SRCCOPY);
+    SelectObject(mem, old);
+    DeleteObject(bmp);
+    DeleteDC(mem);
+    return pending;
+}
+
+void Strip_GetStats(StripStats* out)
+{
+    if (out) *out = s_stats;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file picture_strip.h
+ * @brief Thumbnail strip of all pictures embedded in the current track
+ * @brief Лента миниатюр всех изображений, встроенных в текущий трек
+ *
+ * The strip is built from a header-only PictureIndex, so opening it costs a few
+ * small reads and no decoding. A thumbnail is decoded only once its cell is
+ * visible, one per call of Strip_DecodeNext(), and then kept until the track
+ * changes. The view calls it from a posted message, so a strip full of large
+ * booklet scans never blocks painting for more than one decode at a time.
+ *
+ * Лента строится по PictureIndex, собранному только из заголовков, поэтому её
+ * открытие стоит нескольких коротких чтений и ни одного декодирования. Миниатюра
+ * декодируется только когда её ячейка видна, по одной за вызов Strip_DecodeNext(),
+ * и хранится до смены трека. Окно вызывает её из отложенного сообщения, поэтому
+ * лента из больших сканов буклета не блокирует отрисовку дольше одного декодирования.
+ *
+ * @note Decoding stays on the UI thread: the OLE picture decoder needs its COM apartment
+ * @note Декодирование остаётся в UI-потоке: OLE-декодеру нужен его COM-апартамент
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STRIP_THUMB   64                        ///< Thumbnail box edge at 96 DPI / Сторона ячейки миниатюры при 96 DPI
+#define STRIP_GAP     6                         ///< Spacing around cells at 96 DPI / Отступ вокруг ячеек при 96 DPI
+
+/**
+ * @brief Strip statistics / Статистика ленты
+ */
+typedef struct {
+    DWORD indexed;   ///< Pictures found by index builds / Изображений найдено индексом
+    DWORD decoded;   ///< Thumbnails decoded / Декодировано миниатюр
+    DWORD failed;    ///< Thumbnails that failed to decode / Миниатюр с ошибкой декодирования
+} StripStats;
+
+/**
+ * @brief Switch to another track; the index is rebuilt on next use
+ * @brief Переключиться на другой трек; индекс перестраивается при следующем использовании
+ *
+ * @param path Audio file, or NULL to clear / Аудиофайл, или NULL для очистки
+ */
+void Strip_SetTrack(const char* path);
+
+/**
+ * @brief Scale the strip for a monitor DPI
+ * @brief Масштабировать ленту под DPI монитора
+ *
+ * Thumbnails are kept at their physical pixel size, so they are dropped (and
+ * decoded again lazily) only when the cell size really changes.
+ * Миниатюры хранятся в физическом размере, поэтому сбрасываются (и лениво
+ * декодируются заново) только если размер ячейки действительно изменился.
+ *
+ * @param dpi Monitor DPI (96 = 100%) / DPI монитора (96 = 100%)
+ * @return TRUE if the layout changed / TRUE если раскладка изменилась
+ */
+BOOL Strip_SetDpi(int dpi);
+
+/**
+ * @brief Height of the strip band in pixels / Высота полосы ленты в пикселях
+ */
+int Strip_Height(void);
+
+/**
+ * @brief Number of embedded pictures (builds the index on first call)
+ * @brief Количество встроенных изображений (строит индекс при первом вызове)
+ */
+int Strip_Count(void);
+
+/**
+ * @brief Draw the strip into a band of the window
+ * @brief Нарисовать ленту в полосе окна
+ *
+ * @param dc   Target DC / Целевой DC
+ * @param band Strip rectangle / Прямоугольник ленты
+ * @param bg   Background colour / Цвет фона
+ * @param mark Frame colour of the selected picture / Цвет рамки выбранного изображения
+ * @return TRUE if a visible thumbnail still waits for decoding / TRUE если видимая миниатюра ждёт декодирования
+ */
+BOOL Strip_Paint(HDC dc, const RECT* band, COLORREF bg, COLORREF mark);
+
+/**
+ * @brief Decode the first visible thumbnail that is not decoded yet
+ * @brief Декодировать первую видимую ещё не декодированную миниатюру
+ *
+ * @param band Strip rectangle / Прямоугольник ленты
+ * @return TRUE if one was decoded (repaint and call again) / TRUE если одна декодирована (перерисовать и вызвать снова)
+ */
+BOOL Strip_DecodeNext(const RECT* band);
+
+/**
+ * @brief Picture under a point, or -1 / Изображение под точкой, или -1
+ */
+int Strip_HitTest(const RECT* band, POINT pt);
+
+/**
+ * @brief Scroll by @p cells thumbnails (negative = left)
+ * @brief Прокрутить на @p cells миниатюр (отрицательное = влево)
+ *
+ * @return TRUE if the position changed / TRUE если позиция изменилась
+ */
+BOOL Strip_Scroll(const RECT* band, int cells);
+
+/**
+ * @brief Decode a picture at full size and mark it as selected
+ * @brief Декодировать изображение в полном размере и отметить его выбранным
+ *
+ * @param i    Picture number / Номер изображения
+ * @param phbm [out] Bitmap, owned by the caller / Bitmap, принадлежит вызывающему
+ * @param psz  [out] Bitmap size / Размер bitmap'а
+ * @return TRUE on success / TRUE при успехе
+ */
+BOOL Strip_LoadPicture(int i, HBITMAP* phbm, SIZE* psz);
+
+/**
+ * @brief Copy strip statistics / Скопировать статистику ленты
+ */
+void Strip_GetStats(StripStats* out);
+
+#ifdef __cplusplus
+}
+#endif
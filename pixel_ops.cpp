@@ -0,0 +1,398 @@
+/**
+ * @file pixel_ops.cpp
+ * @brief 32bpp pixel kernels implementation
+ * @brief Реализация ядер обработки 32bpp пикселей
+ *
+ * The SSE2 paths work on four pixels at a time, widening channels to 16 bits
+ * so that the 8.8 fixed point products never overflow. The scalar fallbacks
+ * use the classic "two channels per 32-bit register" trick.
+ *
+ * SSE2-пути обрабатывают по четыре пикселя, расширяя каналы до 16 бит,
+ * чтобы произведения в формате 8.8 не переполнялись. Скалярные пути
+ * используют классический приём "два канала в одном 32-битном регистре".
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <emmintrin.h>
+#include <stdlib.h>
+#include "pixel_ops.h"
+
+#ifndef PF_XMMI64_INSTRUCTIONS_AVAILABLE
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+#endif
+
+// ============================================================================
+// CPU Detection / Определение возможностей процессора
+// ============================================================================
+
+BOOL Pix_HasSSE2(void)
+{
+    static int s_sse2 = -1;
+    if (s_sse2 < 0) {
+        s_sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? 1 : 0;
+    }
+    return s_sse2 ? TRUE : FALSE;
+}
+
+// ============================================================================
+// Crossfade / Плавный переход
+// ============================================================================
+
+static inline DWORD BlendPixel(DWORD a, DWORD b, DWORD ia, DWORD t)
+{
+    DWORD rb = ((a & 0x00FF00FF) * ia + (b & 0x00FF00FF) * t) >> 8;
+    DWORD ag = ((a >> 8) & 0x00FF00FF) * ia + ((b >> 8) & 0x00FF00FF) * t;
+    return (rb & 0x00FF00FF) | (ag & 0xFF00FF00);
+}
+
+void Pix_Crossfade(const DWORD* a, const DWORD* b, DWORD* dst, int count, int t)
+{
+    if (!a || !b || !dst || count <= 0) return;
+    if (t < 0)   t = 0;
+    if (t > 256) t = 256;
+
+    DWORD ia = (DWORD)(256 - t);
+    int i = 0;
+
+    if (Pix_HasSSE2()) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i wa   = _mm_set1_epi16((short)ia);
+        const __m128i wb   = _mm_set1_epi16((short)t);
+
+        // a*(256-t) + b*t <= 255*256, so the sum fits an unsigned 16-bit lane
+        // a*(256-t) + b*t <= 255*256, поэтому сумма помещается в беззнаковую 16-битную ячейку
+        for (; i + 4 <= count; i += 4) {
+            __m128i pa = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i pb = _mm_loadu_si128((const __m128i*)(b + i));
+
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pa, zero), wa),
+                                       _mm_mullo_epi16(_mm_unpacklo_epi8(pb, zero), wb));
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pa, zero), wa),
+                                       _mm_mullo_epi16(_mm_unpackhi_epi8(pb, zero), wb));
+
+            lo = _mm_srli_epi16(lo, 8);
+            hi = _mm_srli_epi16(hi, 8);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+        }
+    }
+
+    for (; i < count; ++i) dst[i] = BlendPixel(a[i], b[i], ia, (DWORD)t);
+}
+
+// ============================================================================
+// Box Blur / Box-размытие
+// ============================================================================
+
+// One vertical box pass over w columns. Channel sums are kept in 16-bit lanes:
+// with a window of at most 255 rows they never exceed 255*255, and the running
+// update may wrap temporarily because the final value always fits.
+// Один вертикальный проход по w столбцам. Суммы каналов хранятся в 16-битных ячейках:
+// при окне не более 255 строк они не превышают 255*255, а промежуточное
+// обновление может временно переполниться, так как итог всегда помещается.
+static void BlurColumns(const DWORD* src, DWORD* dst, int w, int h, int stride, int r, WORD* sums)
+{
+    const int   n   = w * 4;                         // channels per row / каналов в строке
+    const WORD  inv = (WORD)((65536 + 2 * r) / (2 * r + 1));
+    const BYTE* s   = (const BYTE*)src;
+    const int   bpr = stride * 4;                    // bytes per row / байт в строке
+
+    // Window centred on row 0 with the edge row replicated
+    // Окно с центром в строке 0, крайняя строка повторяется
+    for (int k = 0; k < n; ++k) sums[k] = (WORD)(s[k] * (r + 1));
+    for (int i = 1; i <= r; ++i) {
+        const BYTE* row = s + (i < h ? i : h - 1) * bpr;
+        for (int k = 0; k < n; ++k) sums[k] = (WORD)(sums[k] + row[k]);
+    }
+
+    const BOOL sse2 = Pix_HasSSE2();
+    for (int y = 0; y < h; ++y) {
+        BYTE*       out  = (BYTE*)(dst + y * stride);
+        const BYTE* addR = s + (y + r + 1 < h ? y + r + 1 : h - 1) * bpr;
+        const BYTE* subR = s + (y - r > 0 ? y - r : 0) * bpr;
+        int k = 0;
+
+        if (sse2) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i vinv = _mm_set1_epi16((short)inv);
+            for (; k + 16 <= n; k += 16) {
+                __m128i s0 = _mm_loadu_si128((const __m128i*)(sums + k));
+                __m128i s1 = _mm_loadu_si128((const __m128i*)(sums + k + 8));
+
+                _mm_storeu_si128((__m128i*)(out + k),
+                                 _mm_packus_epi16(_mm_mulhi_epu16(s0, vinv), _mm_mulhi_epu16(s1, vinv)));
+
+                __m128i a = _mm_loadu_si128((const __m128i*)(addR + k));
+                __m128i b = _mm_loadu_si128((const __m128i*)(subR + k));
+                s0 = _mm_sub_epi16(_mm_add_epi16(s0, _mm_unpacklo_epi8(a, zero)), _mm_unpacklo_epi8(b, zero));
+                s1 = _mm_sub_epi16(_mm_add_epi16(s1, _mm_unpackhi_epi8(a, zero)), _mm_unpackhi_epi8(b, zero));
+                _mm_storeu_si128((__m128i*)(sums + k), s0);
+                _mm_storeu_si128((__m128i*)(sums + k + 8), s1);
+            }
+        }
+
+        for (; k < n; ++k) {
+            out[k]  = (BYTE)(((DWORD)sums[k] * inv) >> 16);
+            sums[k] = (WORD)(sums[k] + addR[k] - subR[k]);
+        }
+    }
+}
+
+static void Transpose(const DWORD* src, int w, int h, int sstride, DWORD* dst, int dstride)
+{
+    for (int y = 0; y < h; ++y) {
+        const DWORD* row = src + y * sstride;
+        for (int x = 0; x < w; ++x) dst[x * dstride + y] = row[x];
+    }
+}
+
+BOOL Pix_BoxBlur(DWORD* px, int w, int h, int stride, int radius, int passes)
+{
+    if (!px || w <= 0 || h <= 0 || stride < w || passes <= 0) return TRUE;
+    if (radius < 1)   radius = 1;
+    if (radius > 127) radius = 127;
+
+    // Pad rows to 4 pixels so the SIMD loop never needs a ragged tail
+    // Дополняем строки до 4 пикселей, чтобы SIMD-циклу не нужен был хвост
+    int sw = (w + 3) & ~3;
+    int sh = (h + 3) & ~3;
+    int cells = (sw * h > sh * w) ? sw * h : sh * w;
+    int wide  = (sw > sh) ? sw : sh;
+
+    DWORD* a    = (DWORD*)GlobalAlloc(GPTR, cells * sizeof(DWORD));
+    DWORD* b    = (DWORD*)GlobalAlloc(GPTR, cells * sizeof(DWORD));
+    WORD*  sums = (WORD*)GlobalAlloc(GPTR, wide * 4 * sizeof(WORD));
+    if (!a || !b || !sums) {
+        if (a) GlobalFree(a);
+        if (b) GlobalFree(b);
+        if (sums) GlobalFree(sums);
+        return FALSE;
+    }
+
+    for (int y = 0; y < h; ++y) CopyMemory(a + y * sw, px + y * stride, w * sizeof(DWORD));
+
+    // Vertical passes on w x h / Вертикальные проходы по w x h
+    for (int i = 0; i < passes; ++i) {
+        BlurColumns(a, b, sw, h, sw, radius, sums);
+        DWORD* t = a; a = b; b = t;
+    }
+
+    // Horizontal passes as vertical ones on the transposed h x w image
+    // Горизонтальные проходы как вертикальные по транспонированному h x w
+    Transpose(a, w, h, sw, b, sh);
+    { DWORD* t = a; a = b; b = t; }
+    for (int i = 0; i < passes; ++i) {
+        BlurColumns(a, b, sh, w, sh, radius, sums);
+        DWORD* t = a; a = b; b = t;
+    }
+    Transpose(a, h, w, sh, px, stride);
+
+    GlobalFree(a);
+    GlobalFree(b);
+    GlobalFree(sums);
+    return TRUE;
+}
+
+// ============================================================================
+// Darken / Затемнение
+// ============================================================================
+
+void Pix_Darken(DWORD* px, int count, int k)
+{
+    if (!px || count <= 0) return;
+    if (k < 0)   k = 0;
+    if (k > 256) k = 256;
+
+    int i = 0;
+    if (Pix_HasSSE2()) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vk   = _mm_set1_epi16((short)k);
+        for (; i + 4 <= count; i += 4) {
+            __m128i p  = _mm_loadu_si128((const __m128i*)(px + i));
+            __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), vk), 8);
+            __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), vk), 8);
+            _mm_storeu_si128((__m128i*)(px + i), _mm_packus_epi16(lo, hi));
+        }
+    }
+    for (; i < count; ++i) px[i] = BlendPixel(px[i], 0, (DWORD)k, 0);
+}
+
+// ============================================================================
+// Bilinear Stretch / Билинейное растяжение
+// ============================================================================
+
+// Horizontal lerp of one prepared source row into dst[x0..x1)
+// Горизонтальная интерполяция подготовленной строки в dst[x0..x1)
+static void StretchSpan(const DWORD* row, DWORD* dst, int x0, int x1,
+                        const int* xl, const int* xr, const WORD* wt)
+{
+    int x = x0;
+    if (Pix_HasSSE2()) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i full = _mm_set1_epi16(256);
+        for (; x + 4 <= x1; x += 4) {
+            __m128i l = _mm_set_epi32((int)row[xl[x + 3]], (int)row[xl[x + 2]], (int)row[xl[x + 1]], (int)row[xl[x]]);
+            __m128i r = _mm_set_epi32((int)row[xr[x + 3]], (int)row[xr[x + 2]], (int)row[xr[x + 1]], (int)row[xr[x]]);
+            __m128i w0 = _mm_loadu_si128((const __m128i*)(wt + x * 4));       // pixels x, x+1
+            __m128i w1 = _mm_loadu_si128((const __m128i*)(wt + x * 4 + 8));   // pixels x+2, x+3
+
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(l, zero), _mm_sub_epi16(full, w0)),
+                                       _mm_mullo_epi16(_mm_unpacklo_epi8(r, zero), w0));
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(l, zero), _mm_sub_epi16(full, w1)),
+                                       _mm_mullo_epi16(_mm_unpackhi_epi8(r, zero), w1));
+            _mm_storeu_si128((__m128i*)(dst + x),
+                             _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+        }
+    }
+    for (; x < x1; ++x) {
+        DWORD t = wt[x * 4];
+        dst[x] = BlendPixel(row[xl[x]], row[xr[x]], 256 - t, t);
+    }
+}
+
+// Map destination index i to a source position in 8.8 fixed point (pixel centres aligned)
+// Перевести индекс i приёмника в позицию источника в формате 8.8 (центры пикселей совпадают)
+static void MapAxis(int i, int dn, int sn, int* i0, int* i1, int* frac)
+{
+    int f = (int)((((LONGLONG)(2 * i + 1) * sn * 256) / (2 * dn)) - 128);
+    if (f < 0) f = 0;
+    int p = f >> 8;
+    if (p >= sn - 1) {
+        *i0 = *i1 = sn - 1;
+        *frac = 0;
+        return;
+    }
+    *i0 = p;
+    *i1 = p + 1;
+    *frac = f & 255;
+}
+
+BOOL Pix_StretchBilinear(const DWORD* src, int sw, int sh, int sstride,
+                         DWORD* dst, int dw, int dh, int dstride, const RECT* skip)
+{
+    if (!src || !dst || sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) return TRUE;
+
+    int*   xl  = (int*)GlobalAlloc(GPTR, dw * 2 * sizeof(int));
+    WORD*  wt  = (WORD*)GlobalAlloc(GPTR, dw * 4 * sizeof(WORD));
+    DWORD* row = (DWORD*)GlobalAlloc(GPTR, sw * sizeof(DWORD));
+    if (!xl || !wt || !row) {
+        if (xl) GlobalFree(xl);
+        if (wt) GlobalFree(wt);
+        if (row) GlobalFree(row);
+        return FALSE;
+    }
+    int* xr = xl + dw;
+
+    for (int x = 0; x < dw; ++x) {
+        int f;
+        MapAxis(x, dw, sw, &xl[x], &xr[x], &f);
+        wt[x * 4] = wt[x * 4 + 1] = wt[x * 4 + 2] = wt[x * 4 + 3] = (WORD)f;
+    }
+
+    RECT hole = { 0, 0, 0, 0 };
+    if (skip) hole = *skip;
+
+    int lastY0 = -1, lastY1 = -1, lastF = -1;
+    for (int y = 0; y < dh; ++y) {
+        int y0, y1, fy;
+        MapAxis(y, dh, sh, &y0, &y1, &fy);
+
+        // Vertical lerp once per distinct source position
+        // Вертикальная интерполяция один раз на каждую позицию источника
+        if (y0 != lastY0 || y1 != lastY1 || fy != lastF) {
+            Pix_Crossfade(src + y0 * sstride, src + y1 * sstride, row, sw, fy);
+            lastY0 = y0; lastY1 = y1; lastF = fy;
+        }
+
+        DWORD* out = dst + y * dstride;
+        if (y >= hole.top && y < hole.bottom && hole.right > hole.left) {
+            StretchSpan(row, out, 0, hole.left > 0 ? hole.left : 0, xl, xr, wt);
+            StretchSpan(row, out, hole.right < dw ? hole.right : dw, dw, xl, xr, wt);
+        } else {
+            StretchSpan(row, out, 0, dw, xl, xr, wt);
+        }
+    }
+
+    GlobalFree(xl);
+    GlobalFree(wt);
+    GlobalFree(row);
+    return TRUE;
+}
+
+// ============================================================================
+// Dominant Colours / Доминирующие цвета
+// ============================================================================
+
+static int Luma(int r, int g, int b)
+{
+    return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+void Pix_DominantColors(const DWORD* px, int count, COLORREF* dominant, COLORREF* accent)
+{
+    if (dominant) *dominant = RGB(0, 0, 0);
+    if (accent)   *accent   = RGB(160, 160, 160);
+    if (!px || count <= 0) return;
+
+    DWORD cnt[512];
+    DWORD sum[512][3];
+    ZeroMemory(cnt, sizeof(cnt));
+    ZeroMemory(sum, sizeof(sum));
+
+    // Bin key = top 3 bits of R, G, B. The scattered count/sum updates are the
+    // whole cost and do not vectorise with SSE2, so this stays scalar.
+    // Ключ корзины = старшие 3 бита R, G, B. Вся цена - в разбросанных
+    // обновлениях счётчиков и сумм, они не векторизуются SSE2, поэтому цикл скалярный.
+    int i;
+    for (i = 0; i < count; ++i) {
+        DWORD c = px[i];
+        DWORD k = ((c >> 15) & 0x1C0) | ((c >> 10) & 0x38) | ((c >> 5) & 0x7);
+        cnt[k]++;
+        sum[k][0] += (c >> 16) & 0xFF;
+        sum[k][1] += (c >> 8) & 0xFF;
+        sum[k][2] += c & 0xFF;
+    }
+
+    int best = 0;
+    for (i = 1; i < 512; ++i) if (cnt[i] > cnt[best]) best = i;
+
+    int dr = sum[best][0] / cnt[best];
+    int dg = sum[best][1] / cnt[best];
+    int db = sum[best][2] / cnt[best];
+
+    // Accent: weight population by saturation, ignore bins close to the dominant colour
+    // Акцент: население, взвешенное насыщенностью; корзины рядом с доминирующим цветом пропускаются
+    int   acc = -1;
+    DWORD accScore = 0;
+    DWORD minPop = (DWORD)count / 64 + 1;
+    for (i = 0; i < 512; ++i) {
+        if (cnt[i] < minPop || i == best) continue;
+        int r = sum[i][0] / cnt[i], g = sum[i][1] / cnt[i], b = sum[i][2] / cnt[i];
+        int dist = abs(r - dr) + abs(g - dg) + abs(b - db);
+        if (dist < 96) continue;
+        int hi = (r > g) ? r : g; if (b > hi) hi = b;
+        int lo = (r < g) ? r : g; if (b < lo) lo = b;
+        DWORD score = cnt[i] * (DWORD)(hi - lo + 16);
+        if (score > accScore) { accScore = score; acc = i; }
+    }
+
+    int ar, ag, ab;
+    if (acc >= 0) {
+        ar = sum[acc][0] / cnt[acc];
+        ag = sum[acc][1] / cnt[acc];
+        ab = sum[acc][2] / cnt[acc];
+    } else {
+        ar = dr; ag = dg; ab = db;
+    }
+
+    // Keep accent text readable: push it towards white or black until luma differs enough
+    // Чтобы текст читался: сдвигаем акцент к белому или чёрному, пока яркость не разойдётся
+    int ld = Luma(dr, dg, db);
+    for (int step = 0; step < 4 && abs(Luma(ar, ag, ab) - ld) < 96; ++step) {
+        if (ld < 128) { ar = (ar + 255) / 2; ag = (ag + 255) / 2; ab = (ab + 255) / 2; }
+        else          { ar /= 2;             ag /= 2;             ab /= 2; }
+    }
+
+    if (dominant) *dominant = RGB(dr, dg, db);
+    if (accent)   *accent   = RGB(ar, ag, ab);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file pixel_ops.h
+ * @brief 32bpp pixel kernels (SSE2 with scalar fallback)
+ * @brief Ядра обработки 32bpp пикселей (SSE2 с запасным скалярным путём)
+ *
+ * Small set of loops that operate on the pre-scaled frames produced by the
+ * render worker. Each kernel picks the SSE2 path at runtime when the CPU
+ * supports it, so the plugin still runs on pre-SSE2 machines.
+ *
+ * Небольшой набор циклов, работающих с уже отмасштабированными кадрами
+ * рабочего потока отрисовки. Каждое ядро выбирает SSE2-путь во время выполнения,
+ * если процессор его поддерживает, поэтому плагин работает и на машинах без SSE2.
+ *
+ * Pixel layout / Формат пикселя: 0xAARRGGBB (BI_RGB DIB section)
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Is the SSE2 path available on this CPU?
+ * @brief Доступен ли SSE2-путь на этом процессоре?
+ */
+BOOL Pix_HasSSE2(void);
+
+/**
+ * @brief Linear blend of two pixel runs: dst = a + (b - a) * t / 256
+ * @brief Линейное смешивание двух рядов пикселей: dst = a + (b - a) * t / 256
+ *
+ * @param a     Outgoing pixels / Уходящие пиксели
+ * @param b     Incoming pixels / Входящие пиксели
+ * @param dst   Output (may alias @p a or @p b) / Результат (может совпадать с @p a или @p b)
+ * @param count Number of pixels / Количество пикселей
+ * @param t     Weight of @p b, 0..256 / Вес @p b, 0..256
+ */
+void Pix_Crossfade(const DWORD* a, const DWORD* b, DWORD* dst, int count, int t);
+
+/**
+ * @brief In-place multi-pass box blur (approximates a gaussian with 3 passes)
+ * @brief Многопроходное box-размытие на месте (3 прохода приближают гауссиану)
+ *
+ * Runs @p passes vertical passes, transposes, runs the same number again
+ * and transposes back, so every pass is a column sweep that vectorises well.
+ * Intended for small downsampled images; allocates two scratch copies.
+ *
+ * Выполняет @p passes вертикальных проходов, транспонирует, повторяет столько же
+ * и транспонирует обратно, поэтому каждый проход - это обход по столбцам,
+ * хорошо ложащийся на SIMD. Рассчитано на маленькие уменьшенные изображения;
+ * выделяет две временные копии.
+ *
+ * @param px     Pixels / Пиксели
+ * @param w, h   Image size / Размер изображения
+ * @param stride Row pitch in pixels / Шаг строки в пикселях
+ * @param radius Box radius, 1..127 / Радиус окна, 1..127
+ * @param passes Passes per direction / Проходов на направление
+ * @return FALSE if scratch memory could not be allocated / FALSE если не удалось выделить память
+ */
+BOOL Pix_BoxBlur(DWORD* px, int w, int h, int stride, int radius, int passes);
+
+/**
+ * @brief Scale every channel by k/256 / Умножить каждый канал на k/256
+ *
+ * @param px    Pixels / Пиксели
+ * @param count Number of pixels / Количество пикселей
+ * @param k     Factor, 0..256 / Множитель, 0..256
+ */
+void Pix_Darken(DWORD* px, int count, int k);
+
+/**
+ * @brief Bilinear upscale of a small image, optionally leaving a hole
+ * @brief Билинейное увеличение маленького изображения, с возможной "дырой"
+ *
+ * Pixels inside @p skip are not written (the cover is drawn there anyway).
+ * Пиксели внутри @p skip не записываются (там всё равно будет нарисована обложка).
+ *
+ * @param src, sw, sh, sstride Source image / Исходное изображение
+ * @param dst, dw, dh, dstride Destination image / Целевое изображение
+ * @param skip Rectangle to leave untouched, or NULL / Прямоугольник, который не трогать, или NULL
+ * @return FALSE if the lookup tables could not be allocated / FALSE если не удалось выделить таблицы
+ */
+BOOL Pix_StretchBilinear(const DWORD* src, int sw, int sh, int sstride,
+                         DWORD* dst, int dw, int dh, int dstride, const RECT* skip);
+
+/**
+ * @brief Pick a dominant and an accent colour from a small image
+ * @brief Выбрать доминирующий и акцентный цвет маленького изображения
+ *
+ * Pixels are binned into a 3:3:3 bit histogram. The dominant colour is the
+ * mean of the fullest bin; the accent is the most saturated well-populated bin
+ * that is clearly different from it, adjusted so that text in the accent
+ * colour stays readable on the dominant one.
+ * Meant for ~1000 pixels (a 32x32 thumbnail): a few microseconds.
+ *
+ * Пиксели раскладываются в гистограмму 3:3:3 бита. Доминирующий цвет -
+ * среднее самой полной корзины; акцентный - самая насыщенная из заметных
+ * корзин, явно отличная от него, с поправкой, чтобы текст акцентным цветом
+ * читался на доминирующем.
+ * Рассчитано на ~1000 пикселей (миниатюра 32x32): единицы микросекунд.
+ *
+ * @param px       Pixels / Пиксели
+ * @param count    Number of pixels / Количество пикселей
+ * @param dominant [out] Dominant colour / Доминирующий цвет
+ * @param accent   [out] Accent colour / Акцентный цвет
+ */
+void Pix_DominantColors(const DWORD* px, int count, COLORREF* dominant, COLORREF* accent);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,644 @@
+/**
+ * @file render_worker.cpp
+ * @brief Background frame composition implementation
+ * @brief Реализация фоновой композиции кадров
+ *
+ * One worker thread, one pending request slot and one "done" slot:
+ * - RenderWorker_Request() overwrites the pending slot (older requests are dropped)
+ * - the worker composes into a fresh DIB section and publishes it in the done slot
+ * - the view is notified with a single coalesced PostMessage and takes the frame
+ *
+ * Один рабочий поток, один слот ожидающего запроса и один слот готового кадра:
+ * - RenderWorker_Request() перезаписывает слот запроса (старые запросы отбрасываются)
+ * - рабочий поток рисует в новый DIB section и публикует его в слоте готового кадра
+ * - окно получает одно объединённое PostMessage уведомление и забирает кадр
+ *
+ * The critical section only guards pointer swaps, never the composition itself,
+ * so the UI thread can't block behind a slow StretchBlt.
+ * Критическая секция защищает только обмен указателями, но не саму композицию,
+ * поэтому UI-поток не может заблокироваться за медленным StretchBlt.
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#include "render_worker.h"
+#include "pixel_ops.h"
+#include "tile_pyramid.h"
+
+// ============================================================================
+// Types and State / Типы и состояние
+// ============================================================================
+
+typedef struct {
+    CoverEntry* cover;
+    int         w, h;
+    COLORREF    bg;
+    DWORD       flags;
+    RenderView  view;
+    LONGLONG    tSubmit;
+} RenderJob;
+
+static CRITICAL_SECTION s_cs;
+static HANDLE        s_thread   = NULL;
+static HANDLE        s_wake     = NULL;
+static volatile LONG s_quit     = 0;
+static volatile LONG s_notified = 0;
+static volatile LONG s_failed   = 0;   // a composition failed since the UI last looked / композиция не удалась с последней проверки UI
+static HWND          s_notify   = NULL;
+static UINT          s_msg      = 0;
+
+static RenderJob     s_job      = {0};   // pending request (cover == NULL -> none)
+static RenderFrame*  s_done     = NULL;  // completed, not yet taken by the UI
+static RenderStats   s_stats    = {0};
+
+static volatile LONG s_nextCoverId = 0;
+
+// Zoom tiles; touched only by the thread that composes (the worker, or the UI without one)
+// Тайлы увеличения; трогает только поток, который рисует (рабочий, или UI без него)
+static TilePyramid*  s_pyr      = NULL;
+#define PYRAMID_MIN_TILES 64     // 64 x 256 KB = 16 MB; grown to the view size / растёт до размера вида
+
+// Mip counters of the composing thread, published with the frame
+// Счётчики уменьшений рисующего потока, публикуются вместе с кадром
+static DWORD         s_mipsBuilt  = 0;
+static DWORD         s_mipsReused = 0;
+
+// ============================================================================
+// Cover Entry / Запись обложки
+// ============================================================================
+
+// Runs before the entry is shared, so selecting the bitmap here is safe
+// Выполняется до того, как запись станет общей, поэтому выбирать bitmap здесь безопасно
+static void Cover_ExtractColors(CoverEntry* c)
+{
+    const int N = 32;
+    c->dominant = RGB(0, 0, 0);
+    c->accent   = RGB(160, 160, 160);
+
+    RenderFrame* t = RenderFrame_Create(N, N);
+    if (!t) return;
+
+    LONGLONG t0 = Perf_Now();
+    HDC dst = CreateCompatibleDC(NULL);
+    HDC src = CreateCompatibleDC(NULL);
+    if (dst && src) {
+        HGDIOBJ oldD = SelectObject(dst, t->hbm);
+        HGDIOBJ oldS = SelectObject(src, c->hbm);
+        if (oldS && oldS != HGDI_ERROR) {
+            // Point sampling touches only N*N source pixels / Точечная выборка трогает только N*N пикселей
+            SetStretchBltMode(dst, COLORONCOLOR);
+            if (StretchBlt(dst, 0, 0, N, N, src, 0, 0, c->sz.cx, c->sz.cy, SRCCOPY)) {
+                GdiFlush();
+                Pix_DominantColors(t->bits, N * N, &c->dominant, &c->accent);
+            }
+            SelectObject(src, oldS);
+        }
+        SelectObject(dst, oldD);
+    }
+    if (src) DeleteDC(src);
+    if (dst) DeleteDC(dst);
+    RenderFrame_Free(t);
+
+    Perf_Trace("cover %lu colours %06lX/%06lX in %lu us", c->id, c->dominant, c->accent, Perf_SinceUs(t0));
+}
+
+CoverEntry* Cover_Create(HBITMAP hbm, SIZE sz)
+{
+    if (!hbm) return NULL;
+
+    CoverEntry* c = (CoverEntry*)GlobalAlloc(GPTR, sizeof(CoverEntry));
+    if (!c) {
+        DeleteObject(hbm);
+        return NULL;
+    }
+    c->refs = 1;
+    c->id   = (DWORD)InterlockedIncrement(&s_nextCoverId);
+    c->hbm  = hbm;
+    c->sz   = sz;
+    Cover_ExtractColors(c);
+    return c;
+}
+
+void Cover_AddRef(CoverEntry* c)
+{
+    if (c) InterlockedIncrement(&c->refs);
+}
+
+void Cover_Release(CoverEntry* c)
+{
+    if (!c) return;
+    if (InterlockedDecrement(&c->refs) == 0) {
+        for (int i = 0; i < COVER_MIPS; ++i) RenderFrame_Free(c->mip[i]);
+        if (c->hbm) DeleteObject(c->hbm);
+        GlobalFree(c);
+    }
+}
+
+// ============================================================================
+// Frames / Кадры
+// ============================================================================
+
+RenderFrame* RenderFrame_Create(int w, int h)
+{
+    if (w <= 0 || h <= 0) return NULL;
+
+    RenderFrame* f = (RenderFrame*)GlobalAlloc(GPTR, sizeof(RenderFrame));
+    if (!f) return NULL;
+
+    BITMAPINFO bi = {0};
+    bi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth       = w;
+    bi.bmiHeader.biHeight      = -h;   // top-down / сверху вниз
+    bi.bmiHeader.biPlanes      = 1;
+    bi.bmiHeader.biBitCount    = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
+
+    void* bits = NULL;
+    f->hbm = CreateDIBSection(NULL, &bi, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!f->hbm || !bits) {
+        if (f->hbm) DeleteObject(f->hbm);
+        GlobalFree(f);
+        return NULL;
+    }
+    f->bits = (DWORD*)bits;
+    f->w = w;
+    f->h = h;
+    return f;
+}
+
+void RenderFrame_Free(RenderFrame* f)
+{
+    if (!f) return;
+    if (f->hbm) DeleteObject(f->hbm);
+    GlobalFree(f);
+}
+
+void Render_FitRect(int W, int H, SIZE sz, RECT* out)
+{
+    if (!out) return;
+    SetRectEmpty(out);
+    if (W <= 0 || H <= 0 || sz.cx <= 0 || sz.cy <= 0) return;
+
+    double sx = (double)W / (double)sz.cx;
+    double sy = (double)H / (double)sz.cy;
+    double s  = (sx < sy) ? sx : sy;
+
+    int wdst = (int)(sz.cx * s);
+    int hdst = (int)(sz.cy * s);
+    out->left   = (W - wdst) / 2;
+    out->top    = (H - hdst) / 2;
+    out->right  = out->left + wdst;
+    out->bottom = out->top + hdst;
+}
+
+/**
+ * @brief Fill the frame with a blurred, darkened copy of the cover
+ * @brief Заполнить кадр размытой затемнённой копией обложки
+ *
+ * The cover is cropped to the frame's aspect ratio and shrunk 8x with HALFTONE,
+ * blurred with three box passes per direction, darkened and stretched back
+ * bilinearly everywhere except the area the sharp cover will cover.
+ * The result lives in the frame, so plain repaints never redo any of it.
+ *
+ * Обложка обрезается под пропорции кадра и уменьшается в 8 раз через HALFTONE,
+ * размывается тремя box-проходами в каждом направлении, затемняется и билинейно
+ * растягивается обратно везде, кроме области под чёткой обложкой.
+ * Результат хранится в кадре, поэтому обычные перерисовки ничего не пересчитывают.
+ *
+ * @param src DC with the cover bitmap selected / DC с выбранным bitmap обложки
+ * @return FALSE if the caller should fall back to a flat fill / FALSE если нужна заливка цветом
+ */
+static BOOL ComposeBackdrop(const RenderJob* job, RenderFrame* f, HDC src)
+{
+    const SIZE cs = job->cover->sz;
+    int sw = (job->w + 7) / 8;
+    int sh = (job->h + 7) / 8;
+    if (sw < 4) sw = 4;
+    if (sh < 4) sh = 4;
+
+    // Largest centred part of the cover with the frame's aspect ratio
+    // Наибольшая центральная часть обложки с пропорциями кадра
+    int cw = cs.cx, ch = cs.cy;
+    if ((LONGLONG)cs.cx * job->h > (LONGLONG)cs.cy * job->w) cw = MulDiv(cs.cy, job->w, job->h);
+    else                                                    ch = MulDiv(cs.cx, job->h, job->w);
+    if (cw <= 0 || ch <= 0) return FALSE;
+
+    RenderFrame* small = RenderFrame_Create(sw, sh);
+    if (!small) return FALSE;
+
+    BOOL ok = FALSE;
+    HDC dc = CreateCompatibleDC(NULL);
+    if (dc) {
+        HGDIOBJ old = SelectObject(dc, small->hbm);
+        SetStretchBltMode(dc, HALFTONE);
+        SetBrushOrgEx(dc, 0, 0, NULL);
+        ok = StretchBlt(dc, 0, 0, sw, sh, src, (cs.cx - cw) / 2, (cs.cy - ch) / 2, cw, ch, SRCCOPY);
+        GdiFlush();
+        SelectObject(dc, old);
+        DeleteDC(dc);
+    }
+
+    if (ok) {
+        int radius = ((sw < sh) ? sw : sh) / 12;
+        ok = Pix_BoxBlur(small->bits, sw, sh, sw, radius < 1 ? 1 : radius, 3);
+    }
+    if (ok) {
+        Pix_Darken(small->bits, sw * sh, 140);
+        ok = Pix_StretchBilinear(small->bits, sw, sh, sw, f->bits, job->w, job->h, job->w, &f->rcCover);
+    }
+
+    RenderFrame_Free(small);
+    return ok;
+}
+
+/**
+ * @brief Pick the smallest mip level still at least @p wdst x @p hdst, building it if needed
+ * @brief Выбрать наименьший уровень не меньше @p wdst x @p hdst, построив его при необходимости
+ *
+ * Each level is halved from the one above with HALFTONE, so a window that changes
+ * its physical size (another monitor DPI, a resize) is fitted from a level within
+ * 2x of the target instead of from the full-size decode.
+ * Каждый уровень уменьшается вдвое из предыдущего через HALFTONE, поэтому окно,
+ * сменившее физический размер (DPI другого монитора, изменение размера), вписывается
+ * из уровня не более чем вдвое больше цели, а не из полноразмерной декодированной обложки.
+ *
+ * @param src DC with the cover bitmap selected / DC с выбранным bitmap'ом обложки
+ * @return Level: 0 = the cover itself, i = cover->mip[i - 1] / Уровень: 0 = сама обложка, i = cover->mip[i - 1]
+ */
+static int PrepareMip(CoverEntry* c, HDC src, int wdst, int hdst)
+{
+    if (wdst <= 0 || hdst <= 0) return 0;
+
+    int level = 0;
+    while (level < COVER_MIPS &&
+           (c->sz.cx >> (level + 1)) >= wdst && (c->sz.cy >> (level + 1)) >= hdst) ++level;
+    if (level == 0) return 0;
+    if (c->mip[level - 1]) {
+        s_mipsReused++;
+        return level;
+    }
+
+    HDC dst = CreateCompatibleDC(NULL);
+    HDC up  = CreateCompatibleDC(NULL);
+    int have = 0;
+    for (int i = 1; dst && up && i <= level; ++i) {
+        if (!c->mip[i - 1]) {
+            RenderFrame* m = RenderFrame_Create(c->sz.cx >> i, c->sz.cy >> i);
+            if (!m) break;
+
+            HDC from = src;
+            HGDIOBJ oldU = NULL;
+            if (i > 1) {
+                oldU = SelectObject(up, c->mip[i - 2]->hbm);
+                from = up;
+            }
+            int fw = (i > 1) ? c->mip[i - 2]->w : c->sz.cx;
+            int fh = (i > 1) ? c->mip[i - 2]->h : c->sz.cy;
+
+            HGDIOBJ oldD = SelectObject(dst, m->hbm);
+            SetStretchBltMode(dst, HALFTONE);
+            SetBrushOrgEx(dst, 0, 0, NULL);
+            StretchBlt(dst, 0, 0, m->w, m->h, from, 0, 0, fw, fh, SRCCOPY);
+            GdiFlush();
+            SelectObject(dst, oldD);
+            if (oldU) SelectObject(up, oldU);
+
+            c->mip[i - 1] = m;
+            s_mipsBuilt++;
+        }
+        have = i;
+    }
+    if (up)  DeleteDC(up);
+    if (dst) DeleteDC(dst);
+    return have;
+}
+
+/**
+ * @brief Compose one frame (normally runs on the worker thread)
+ * @brief Скомпоновать один кадр (обычно выполняется в рабочем потоке)
+ *
+ * @param backdropUs [out] Time spent on the blurred letterbox, or NULL / Время на размытые поля, или NULL
+ */
+static RenderFrame* ComposeFrame(const RenderJob* job, DWORD* backdropUs)
+{
+    if (!job->cover || !job->cover->hbm || job->w <= 0 || job->h <= 0) return NULL;
+
+    RenderFrame* f = RenderFrame_Create(job->w, job->h);
+    if (!f) return NULL;
+
+    f->coverId = job->cover->id;
+    f->bg      = job->bg;
+    f->flags   = job->flags;
+    f->view    = job->view;
+    Render_FitRect(job->w, job->h, job->cover->sz, &f->rcCover);
+
+    BOOL zoomed = (job->view.scale > 0);
+    if (zoomed && !s_pyr) s_pyr = Pyramid_Create(PYRAMID_MIN_TILES);
+    if (!s_pyr) zoomed = FALSE;
+
+    // Every visible tile must fit at once, or the LRU evicts within a single frame
+    // Все видимые тайлы должны помещаться сразу, иначе LRU вытесняет их внутри одного кадра
+    if (zoomed) Pyramid_Reserve(s_pyr, Pyramid_TilesFor(job->w, job->h));
+
+    HDC mem = CreateCompatibleDC(NULL);
+    HDC src = CreateCompatibleDC(NULL);
+    if (!mem || !src) {
+        if (mem) DeleteDC(mem);
+        if (src) DeleteDC(src);
+        RenderFrame_Free(f);
+        return NULL;
+    }
+
+    HGDIOBJ oldM = SelectObject(mem, f->hbm);
+    HGDIOBJ oldS = SelectObject(src, job->cover->hbm);
+    BOOL haveSrc = (oldS && oldS != HGDI_ERROR);
+
+    // Letterbox: blurred cover if requested and there is any, flat colour otherwise
+    // Поля: размытая обложка если запрошено и поля есть, иначе сплошной цвет
+    RECT rc = { 0, 0, job->w, job->h };
+    BOOL backdrop = FALSE;
+    if (haveSrc && !zoomed && (job->flags & RENDER_BLUR_BACKDROP) && !EqualRect(&rc, &f->rcCover)) {
+        LONGLONG t0 = Perf_Now();
+        backdrop = ComposeBackdrop(job, f, src);
+        if (backdropUs) *backdropUs = Perf_SinceUs(t0);
+    }
+    if (!backdrop) {
+        HBRUSH br = CreateSolidBrush(job->bg);
+        if (br) {
+            FillRect(mem, &rc, br);
+            DeleteObject(br);
+        }
+    }
+
+    if (haveSrc && zoomed) {
+        // Only the visible tiles of the right pyramid level are touched
+        // Затрагиваются только видимые тайлы нужного уровня пирамиды
+        Pyramid_Draw(s_pyr, job->cover, src, mem, job->w, job->h, &job->view, &f->rcCover);
+        SelectObject(src, oldS);
+    }
+    else if (haveSrc) {
+        int wdst = f->rcCover.right - f->rcCover.left;
+        int hdst = f->rcCover.bottom - f->rcCover.top;
+
+        // Scale from the closest cached mip; the full-size bitmap only when no level fits
+        // Масштабировать из ближайшего готового уровня; полный bitmap - только если ни один не подходит
+        HDC from = src;
+        SIZE fsz = job->cover->sz;
+        HDC mdc = NULL;
+        HGDIOBJ oldMip = NULL;
+        int level = PrepareMip(job->cover, src, wdst, hdst);
+        if (level > 0 && (mdc = CreateCompatibleDC(NULL)) != NULL) {
+            const RenderFrame* m = job->cover->mip[level - 1];
+            oldMip = SelectObject(mdc, m->hbm);
+            from   = mdc;
+            fsz.cx = m->w;
+            fsz.cy = m->h;
+        }
+
+        int mode = (wdst < fsz.cx) ? HALFTONE : COLORONCOLOR;
+        SetStretchBltMode(mem, mode);
+        if (mode == HALFTONE) SetBrushOrgEx(mem, 0, 0, NULL);
+
+        StretchBlt(mem, f->rcCover.left, f->rcCover.top, wdst, hdst,
+                   from, 0, 0, fsz.cx, fsz.cy, SRCCOPY);
+        if (mdc) {
+            SelectObject(mdc, oldMip);
+            DeleteDC(mdc);
+        }
+        SelectObject(src, oldS);
+    }
+
+    // Make sure the pixels are in memory before another thread touches them
+    // Убедиться, что пиксели записаны до того, как их тронет другой поток
+    GdiFlush();
+
+    SelectObject(mem, oldM);
+    DeleteDC(src);
+    DeleteDC(mem);
+    return f;
+}
+
+RenderFrame* Render_Compose(CoverEntry* cover, int W, int H, COLORREF bg, DWORD flags,
+                            const RenderView* view)
+{
+    RenderJob job = {0};
+    job.cover = cover;
+    job.w     = W;
+    job.h     = H;
+    job.bg    = bg;
+    job.flags = flags;
+    if (view) job.view = *view;
+    return ComposeFrame(&job, NULL);
+}
+
+// ============================================================================
+// Worker Thread / Рабочий поток
+// ============================================================================
+
+static unsigned __stdcall WorkerProc(void*)
+{
+    for (;;) {
+        WaitForSingleObject(s_wake, INFINITE);
+        if (s_quit) break;
+
+        RenderJob job;
+        EnterCriticalSection(&s_cs);
+        job = s_job;
+        s_job.cover = NULL;
+        LeaveCriticalSection(&s_cs);
+
+        if (!job.cover) continue;
+
+        LONGLONG t0 = Perf_Now();
+        DWORD backdropUs = (DWORD)-1;
+        RenderFrame* f = ComposeFrame(&job, &backdropUs);
+        DWORD composeUs = Perf_SinceUs(t0);
+        Cover_Release(job.cover);
+
+        RenderFrame* stale = NULL;
+        HWND notify = NULL;
+        UINT msg = 0;
+
+        // A failure is reported too, so the UI forgets the request and may ask again
+        // О неудаче тоже сообщается, чтобы UI забыл запрос и мог запросить снова
+        if (!f) {
+            EnterCriticalSection(&s_cs);
+            s_stats.failed++;
+            notify = s_notify;
+            msg    = s_msg;
+            LeaveCriticalSection(&s_cs);
+            InterlockedExchange(&s_failed, 1);
+            if (notify && InterlockedExchange(&s_notified, 1) == 0) {
+                if (!PostMessage(notify, msg, 0, 0)) InterlockedExchange(&s_notified, 0);
+            }
+            continue;
+        }
+
+        EnterCriticalSection(&s_cs);
+        stale  = s_done;
+        s_done = f;
+        if (stale) s_stats.unclaimed++;
+        s_stats.frames++;
+        Perf_HistAdd(&s_stats.compose, composeUs);
+        if (backdropUs != (DWORD)-1) Perf_HistAdd(&s_stats.backdrop, backdropUs);
+        if (s_pyr) {
+            PyramidStats ps;
+            Pyramid_GetStats(s_pyr, &ps);
+            s_stats.tilesBuilt  = ps.built;
+            s_stats.tilesReused = ps.hits;
+        }
+        s_stats.mipsBuilt  = s_mipsBuilt;
+        s_stats.mipsReused = s_mipsReused;
+        Perf_HistAdd(&s_stats.latency, Perf_SinceUs(job.tSubmit));
+        notify = s_notify;
+        msg    = s_msg;
+        LeaveCriticalSection(&s_cs);
+
+        RenderFrame_Free(stale);
+
+        if (notify && InterlockedExchange(&s_notified, 1) == 0) {
+            if (!PostMessage(notify, msg, 0, 0)) InterlockedExchange(&s_notified, 0);
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// Public API / Публичный API
+// ============================================================================
+
+BOOL RenderWorker_Start(HWND notify, UINT msg)
+{
+    if (s_thread) {
+        EnterCriticalSection(&s_cs);
+        s_notify = notify;
+        s_msg    = msg;
+        LeaveCriticalSection(&s_cs);
+        return TRUE;
+    }
+
+    InitializeCriticalSection(&s_cs);
+    s_wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!s_wake) {
+        DeleteCriticalSection(&s_cs);
+        return FALSE;
+    }
+
+    s_quit     = 0;
+    s_notified = 0;
+    s_failed   = 0;
+    s_notify   = notify;
+    s_msg      = msg;
+
+    unsigned tid = 0;
+    s_thread = (HANDLE)_beginthreadex(NULL, 0, WorkerProc, NULL, 0, &tid);
+    if (!s_thread) {
+        CloseHandle(s_wake);
+        s_wake = NULL;
+        DeleteCriticalSection(&s_cs);
+        return FALSE;
+    }
+
+    // Composition is latency sensitive but must not starve Winamp's decoder
+    // Композиция чувствительна к задержке, но не должна отнимать время у декодера Winamp
+    SetThreadPriority(s_thread, THREAD_PRIORITY_BELOW_NORMAL);
+    return TRUE;
+}
+
+void RenderWorker_Stop(void)
+{
+    if (!s_thread) {
+        Pyramid_Destroy(s_pyr);
+        s_pyr = NULL;
+        return;
+    }
+
+    InterlockedExchange(&s_quit, 1);
+    SetEvent(s_wake);
+    WaitForSingleObject(s_thread, INFINITE);
+    CloseHandle(s_thread);
+    CloseHandle(s_wake);
+    s_thread = NULL;
+    s_wake   = NULL;
+
+    Cover_Release(s_job.cover);
+    s_job.cover = NULL;
+    RenderFrame_Free(s_done);
+    s_done   = NULL;
+    s_notify = NULL;
+    Pyramid_Destroy(s_pyr);
+    s_pyr    = NULL;
+
+    char line[160];
+    Perf_HistFormat(&s_stats.latency, line, sizeof(line));
+    Perf_Trace("render latency %s", line);
+    Perf_HistFormat(&s_stats.backdrop, line, sizeof(line));
+    Perf_Trace("render backdrop %s", line);
+    Perf_Trace("render mips: %lu built, %lu reused", s_stats.mipsBuilt, s_stats.mipsReused);
+
+    DeleteCriticalSection(&s_cs);
+}
+
+BOOL RenderWorker_IsRunning(void)
+{
+    return s_thread ? TRUE : FALSE;
+}
+
+BOOL RenderWorker_Request(CoverEntry* cover, int W, int H, COLORREF bg, DWORD flags,
+                          const RenderView* view)
+{
+    if (!s_thread || !cover || W <= 0 || H <= 0) return FALSE;
+
+    Cover_AddRef(cover);
+
+    CoverEntry* dropped = NULL;
+    EnterCriticalSection(&s_cs);
+    dropped = s_job.cover;
+    if (dropped) s_stats.superseded++;
+    s_job.cover   = cover;
+    s_job.w       = W;
+    s_job.h       = H;
+    s_job.bg      = bg;
+    s_job.flags   = flags;
+    if (view) s_job.view = *view;
+    else      ZeroMemory(&s_job.view, sizeof(s_job.view));
+    s_job.tSubmit = Perf_Now();
+    s_stats.requests++;
+    LeaveCriticalSection(&s_cs);
+
+    Cover_Release(dropped);
+    SetEvent(s_wake);
+    return TRUE;
+}
+
+RenderFrame* RenderWorker_TakeFrame(void)
+{
+    if (!s_thread) return NULL;
+
+    RenderFrame* f;
+    EnterCriticalSection(&s_cs);
+    f = s_done;
+    s_done = NULL;
+    LeaveCriticalSection(&s_cs);
+
+    InterlockedExchange(&s_notified, 0);
+    return f;
+}
+
+BOOL RenderWorker_TakeFailure(void)
+{
+    return InterlockedExchange(&s_failed, 0) != 0;
+}
+
+void RenderWorker_GetStats(RenderStats* out)
+{
+    if (!out) return;
+    if (!s_thread) {
+        *out = s_stats;
+        return;
+    }
+    EnterCriticalSection(&s_cs);
+    *out = s_stats;
+    LeaveCriticalSection(&s_cs);
+}
@@ -0,0 +1,249 @@
+/**
+ * @file render_worker.h
+ * @brief Background frame composition for the cover view
+ * @brief Фоновая композиция кадров для окна обложки
+ *
+ * Scaling a large cover with HALFTONE StretchBlt can take tens of milliseconds.
+ * This module moves that work off Winamp's UI thread: the view submits a
+ * "compose" request (cover + client size + background colour), a single worker
+ * thread renders a ready-to-blit 32bpp frame and hands it back. The UI thread
+ * only ever blits the latest completed frame and never waits for scaling.
+ *
+ * Масштабирование большой обложки через HALFTONE StretchBlt может занимать
+ * десятки миллисекунд. Этот модуль выносит работу из UI-потока Winamp: окно
+ * отправляет запрос на композицию (обложка + размер клиентской области + цвет фона),
+ * единственный рабочий поток рисует готовый к выводу 32bpp кадр и возвращает его.
+ * UI-поток всегда выводит только последний готовый кадр и никогда не ждёт масштабирования.
+ *
+ * Ownership rules / Правила владения:
+ * - CoverEntry is reference counted; the decoded bitmap is deleted with the last reference
+ * - Only the worker selects a cover bitmap into a DC
+ * - A RenderFrame belongs to exactly one side at a time (worker → UI via RenderWorker_TakeFrame)
+ *
+ * - CoverEntry считает ссылки; декодированный bitmap удаляется вместе с последней ссылкой
+ * - Только рабочий поток выбирает bitmap обложки в DC
+ * - RenderFrame принадлежит ровно одной стороне (рабочий поток → UI через RenderWorker_TakeFrame)
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+#include "perf_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Cover Entry / Запись обложки
+// ============================================================================
+
+#define COVER_MIPS 4   ///< Half-size levels kept per cover / Уровней уменьшения вдвое на обложку
+
+/**
+ * @brief Decoded cover shared between the UI thread and the render worker
+ * @brief Декодированная обложка, разделяемая UI-потоком и рабочим потоком
+ */
+typedef struct CoverEntry {
+    volatile LONG refs;  ///< Reference count / Счётчик ссылок
+    DWORD   id;          ///< Unique cover id / Уникальный идентификатор обложки
+    HBITMAP hbm;         ///< Decoded bitmap (owned) / Декодированный bitmap (во владении)
+    SIZE    sz;          ///< Bitmap size in pixels / Размер bitmap'а в пикселях
+    COLORREF dominant;   ///< Most common colour / Самый частый цвет
+    COLORREF accent;     ///< Readable contrasting colour / Читаемый контрастный цвет
+    struct RenderFrame* mip[COVER_MIPS]; ///< mip[i] = 1/2^(i+1) size, built by the composing thread on demand
+                                         ///< mip[i] = размер 1/2^(i+1), строится рисующим потоком по требованию
+} CoverEntry;
+
+/**
+ * @brief Wrap a freshly decoded bitmap into a cover entry
+ * @brief Обернуть только что декодированный bitmap в запись обложки
+ *
+ * @param hbm Bitmap returned by a tag reader (ownership is taken) / Bitmap от ридера тегов (владение передаётся)
+ * @param sz  Bitmap size / Размер bitmap'а
+ * @return Entry with one reference, or NULL (bitmap is deleted on failure)
+ * @return Запись с одной ссылкой, или NULL (bitmap удаляется при ошибке)
+ *
+ * @note Also extracts the dominant/accent colours from a 32x32 point-sampled
+ *       thumbnail of the already decoded bitmap - no second decode.
+ * @note Также извлекает доминирующий/акцентный цвета из точечной миниатюры 32x32
+ *       уже декодированного bitmap'а - без повторного декодирования.
+ */
+CoverEntry* Cover_Create(HBITMAP hbm, SIZE sz);
+
+/**
+ * @brief Add a reference / Добавить ссылку
+ */
+void Cover_AddRef(CoverEntry* c);
+
+/**
+ * @brief Drop a reference; frees the bitmap with the last one
+ * @brief Снять ссылку; освобождает bitmap вместе с последней
+ *
+ * @note Safe to call with NULL / Безопасно вызывать с NULL
+ */
+void Cover_Release(CoverEntry* c);
+
+// ============================================================================
+// Render Frame / Кадр отрисовки
+// ============================================================================
+
+/// Fill the letterbox with a blurred, darkened copy of the cover
+/// Заполнять поля размытой затемнённой копией обложки
+#define RENDER_BLUR_BACKDROP 0x0001
+
+/**
+ * @brief Zoomed view of a cover / Увеличенный вид обложки
+ *
+ * scale == 0 means "fit to window" / scale == 0 означает "вписать в окно"
+ */
+typedef struct {
+    double scale;   ///< Screen pixels per cover pixel / Экранных пикселей на пиксель обложки
+    double cx, cy;  ///< Cover point shown at the frame centre / Точка обложки в центре кадра
+} RenderView;
+
+/**
+ * @brief Ready-to-blit composed frame
+ * @brief Готовый к выводу скомпонованный кадр
+ */
+typedef struct RenderFrame {
+    HBITMAP  hbm;      ///< 32bpp top-down DIB section / 32bpp DIB section (сверху вниз)
+    DWORD*   bits;     ///< Pixel memory of the DIB / Память пикселей DIB
+    int      w, h;     ///< Frame size / Размер кадра
+    RECT     rcCover;  ///< Where the cover was drawn / Куда нарисована обложка
+    DWORD    coverId;  ///< Source cover id / Идентификатор исходной обложки
+    COLORREF bg;       ///< Background colour used / Использованный цвет фона
+    DWORD    flags;    ///< RENDER_* flags used / Использованные флаги RENDER_*
+    RenderView view;   ///< View used / Использованный вид
+} RenderFrame;
+
+/**
+ * @brief Allocate an empty frame (contents undefined)
+ * @brief Выделить пустой кадр (содержимое не определено)
+ *
+ * @param w, h Frame size / Размер кадра
+ * @return New frame or NULL / Новый кадр или NULL
+ */
+RenderFrame* RenderFrame_Create(int w, int h);
+
+/**
+ * @brief Free a frame taken from the worker
+ * @brief Освободить кадр, полученный от рабочего потока
+ */
+void RenderFrame_Free(RenderFrame* f);
+
+/**
+ * @brief Compute the centred, aspect-preserving cover rectangle
+ * @brief Вычислить центрированный прямоугольник обложки с сохранением пропорций
+ *
+ * @param W, H   Client size / Размер клиентской области
+ * @param sz     Cover size / Размер обложки
+ * @param out    [out] Destination rectangle / Целевой прямоугольник
+ */
+void Render_FitRect(int W, int H, SIZE sz, RECT* out);
+
+/**
+ * @brief Compose a frame synchronously on the calling thread
+ * @brief Скомпоновать кадр синхронно в вызывающем потоке
+ *
+ * Used by the worker itself and as a fallback when the worker thread
+ * could not be started.
+ * Используется самим рабочим потоком и как запасной путь, если поток
+ * не удалось запустить.
+ *
+ * @return New frame or NULL / Новый кадр или NULL
+ *
+ * @warning Never call while the worker is running: only one thread may select a cover bitmap
+ * @warning Не вызывать при работающем потоке: bitmap обложки может выбирать только один поток
+ */
+RenderFrame* Render_Compose(CoverEntry* cover, int W, int H, COLORREF bg, DWORD flags,
+                            const RenderView* view);
+
+// ============================================================================
+// Worker Control / Управление рабочим потоком
+// ============================================================================
+
+/**
+ * @brief Worker statistics / Статистика рабочего потока
+ */
+typedef struct {
+    PerfHistogram latency;  ///< Request → frame ready / Запрос → кадр готов
+    PerfHistogram compose;  ///< Pure composition time / Чистое время композиции
+    PerfHistogram backdrop; ///< Blurred letterbox part of it / Из него - размытые поля
+    DWORD requests;         ///< Requests submitted / Отправлено запросов
+    DWORD superseded;       ///< Requests replaced before start / Запросов заменено до начала
+    DWORD frames;           ///< Frames produced / Кадров создано
+    DWORD unclaimed;        ///< Frames replaced before the UI took them / Кадров заменено до забора UI
+    DWORD failed;           ///< Compositions that produced no frame / Композиций без кадра
+    DWORD tilesBuilt;       ///< Zoom pyramid tiles built / Построено тайлов пирамиды
+    DWORD tilesReused;      ///< Zoom pyramid cache hits / Попаданий в кэш пирамиды
+    DWORD mipsBuilt;        ///< Cover mip levels built / Построено уровней уменьшения обложек
+    DWORD mipsReused;       ///< Fitted frames drawn from an existing mip / Вписанных кадров из готового уровня
+} RenderStats;
+
+/**
+ * @brief Start the render worker thread
+ * @brief Запустить рабочий поток отрисовки
+ *
+ * @param notify Window that receives @p msg when a frame is ready / Окно, получающее @p msg при готовности кадра
+ * @param msg    Notification message / Сообщение-уведомление
+ * @return TRUE if the worker is running / TRUE если поток запущен
+ *
+ * @note Safe to call repeatedly; later calls only retarget the notification
+ * @note Можно вызывать повторно; последующие вызовы лишь меняют получателя уведомлений
+ */
+BOOL RenderWorker_Start(HWND notify, UINT msg);
+
+/**
+ * @brief Stop the worker and free everything it still holds
+ * @brief Остановить рабочий поток и освободить всё, что он удерживает
+ */
+void RenderWorker_Stop(void);
+
+/**
+ * @brief Is the worker thread running? / Запущен ли рабочий поток?
+ */
+BOOL RenderWorker_IsRunning(void);
+
+/**
+ * @brief Queue a composition request (latest request wins)
+ * @brief Поставить запрос на композицию (побеждает последний запрос)
+ *
+ * @param cover Cover to draw (a reference is taken) / Обложка (берётся ссылка)
+ * @param W, H  Target size / Целевой размер
+ * @param bg    Letterbox colour / Цвет полей
+ * @param flags RENDER_* flags / Флаги RENDER_*
+ * @param view  Zoomed view, or NULL to fit / Увеличенный вид, или NULL для вписывания
+ * @return TRUE if queued / TRUE если запрос поставлен
+ */
+BOOL RenderWorker_Request(CoverEntry* cover, int W, int H, COLORREF bg, DWORD flags,
+                          const RenderView* view);
+
+/**
+ * @brief Take ownership of the most recently completed frame
+ * @brief Забрать во владение последний готовый кадр
+ *
+ * @return Frame or NULL if nothing new / Кадр или NULL если нового нет
+ */
+RenderFrame* RenderWorker_TakeFrame(void);
+
+/**
+ * @brief Whether a composition failed since the last call
+ * @brief Не удалась ли композиция с последнего вызова
+ *
+ * Reported with the same notification as a ready frame.
+ * Сообщается тем же уведомлением, что и готовый кадр.
+ */
+BOOL RenderWorker_TakeFailure(void);
+
+/**
+ * @brief Copy current statistics / Скопировать текущую статистику
+ */
+void RenderWorker_GetStats(RenderStats* out);
+
+#ifdef __cplusplus
+}
+#endif
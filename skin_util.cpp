@@ -77,6 +77,17 @@
  */
 static HBRUSH s_br = NULL;
 
+/**
+ * @brief Colour the current brush was created with
+ * @brief Цвет, которым создана текущая кисть
+ *
+ * Kept alongside the brush so code that paints into its own buffers
+ * (render worker) doesn't have to query the brush object.
+ * Хранится рядом с кистью, чтобы код, рисующий в собственные буферы
+ * (рабочий поток отрисовки), не запрашивал объект кисти.
+ */
+static COLORREF s_color = RGB(0, 0, 0);
+
 // ============================================================================
 // Public API Implementation / Реализация публичного API
 // ============================================================================
@@ -129,6 +140,7 @@ void Skin_RefreshDialogBrush()
     // "цвет фона для элементов списка и областей диалога"
     // WADlg_getColor() возвращает RGB значение (COLORREF) из активного скина.
     COLORREF skinColor = WADlg_getColor(WADLG_ITEMBG);
+    s_color = skinColor;
 
     // Step 3: Create new solid brush with skin color
     // Шаг 3: Создать новую сплошную кисть с цветом скина
@@ -164,6 +176,18 @@ HBRUSH Skin_GetDialogBrush()
     return s_br; 
 }
 
+/**
+ * @brief Get current dialog background colour
+ * @brief Получить текущий цвет фона диалога
+ *
+ * @return Colour of the brush returned by Skin_GetDialogBrush()
+ * @return Цвет кисти, возвращаемой Skin_GetDialogBrush()
+ */
+COLORREF Skin_GetDialogColor()
+{
+    return s_br ? s_color : GetSysColor(COLOR_WINDOW);
+}
+
 /**
  * @brief Delete dialog background brush and free resources
  * @brief Удалить кисть фона диалога и освободить ресурсы
@@ -102,6 +102,21 @@ void Skin_RefreshDialogBrush();
  */
 HBRUSH Skin_GetDialogBrush();
 
+/**
+ * @brief Get the colour of the current dialog background brush
+ * @brief Получить цвет текущей кисти фона диалога
+ * 
+ * Code that composes into its own pixel buffers (the render worker) needs
+ * the colour itself rather than the brush handle.
+ * 
+ * Коду, который рисует в собственные буферы пикселей (рабочий поток отрисовки),
+ * нужен сам цвет, а не дескриптор кисти.
+ * 
+ * @return Skin colour, or COLOR_WINDOW if no brush has been created yet
+ * @return Цвет скина, или COLOR_WINDOW если кисть ещё не создана
+ */
+COLORREF Skin_GetDialogColor();
+
 /**
  * @brief Delete the dialog background brush and free resources
  * @brief Удалить кисть фона диалога и освободить ресурсы
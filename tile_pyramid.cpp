@@ -0,0 +1,241 @@
+/**
+ * @file tile_pyramid.cpp
+ * @brief Tile pyramid implementation
+ * @brief Реализация пирамиды тайлов
+ *
+ * Tiles are keyed by (cover id, level, column, row), so a new cover simply
+ * stops hitting the old tiles and they age out of the LRU.
+ * Тайлы индексируются по (id обложки, уровень, столбец, строка), поэтому новая
+ * обложка просто перестаёт попадать в старые тайлы, и они вытесняются LRU.
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "tile_pyramid.h"
+
+// ============================================================================
+// Types / Типы
+// ============================================================================
+
+typedef struct {
+    DWORD        coverId;   // 0 = free slot / 0 = свободный слот
+    int          level, tx, ty;
+    RenderFrame* px;        // tile pixels (w x h valid) / пиксели тайла
+    DWORD        stamp;     // last use / последнее использование
+} Tile;
+
+struct TilePyramid {
+    Tile*        tiles;
+    int          cap;
+    DWORD        clock;
+    PyramidStats stats;
+};
+
+// ============================================================================
+// Cache / Кэш
+// ============================================================================
+
+TilePyramid* Pyramid_Create(int maxTiles)
+{
+    if (maxTiles < 4) maxTiles = 4;
+
+    TilePyramid* p = (TilePyramid*)GlobalAlloc(GPTR, sizeof(TilePyramid));
+    if (!p) return NULL;
+    p->tiles = (Tile*)GlobalAlloc(GPTR, maxTiles * sizeof(Tile));
+    if (!p->tiles) {
+        GlobalFree(p);
+        return NULL;
+    }
+    p->cap = maxTiles;
+    return p;
+}
+
+BOOL Pyramid_Reserve(TilePyramid* p, int tiles)
+{
+    if (!p) return FALSE;
+    if (tiles <= p->cap) return TRUE;
+
+    Tile* t = (Tile*)GlobalAlloc(GPTR, tiles * sizeof(Tile));
+    if (!t) return FALSE;
+    CopyMemory(t, p->tiles, p->cap * sizeof(Tile));
+    GlobalFree(p->tiles);
+    p->tiles = t;
+    p->cap   = tiles;
+    return TRUE;
+}
+
+int Pyramid_TilesFor(int W, int H)
+{
+    const int span = PYRAMID_TILE / 2;
+    int cols = (W + span - 1) / span + 1;
+    int rows = (H + span - 1) / span + 1;
+    return cols * rows + cols + rows;
+}
+
+void Pyramid_Destroy(TilePyramid* p)
+{
+    if (!p) return;
+    for (int i = 0; i < p->cap; ++i) RenderFrame_Free(p->tiles[i].px);
+    GlobalFree(p->tiles);
+    GlobalFree(p);
+}
+
+void Pyramid_GetStats(const TilePyramid* p, PyramidStats* out)
+{
+    if (!out) return;
+    if (p) *out = p->stats;
+    else   ZeroMemory(out, sizeof(*out));
+}
+
+/**
+ * @brief Cut and downscale one tile from the cover
+ * @brief Вырезать и уменьшить один тайл из обложки
+ */
+static RenderFrame* BuildTile(const CoverEntry* cover, HDC src, int level, int tx, int ty)
+{
+    int step = PYRAMID_TILE << level;
+    int sx = tx * step, sy = ty * step;
+    int sw = cover->sz.cx - sx; if (sw > step) sw = step;
+    int sh = cover->sz.cy - sy; if (sh > step) sh = step;
+    if (sw <= 0 || sh <= 0) return NULL;
+
+    int tw = (sw + (1 << level) - 1) >> level;
+    int th = (sh + (1 << level) - 1) >> level;
+
+    RenderFrame* t = RenderFrame_Create(tw, th);
+    if (!t) return NULL;
+
+    HDC dc = CreateCompatibleDC(NULL);
+    if (!dc) {
+        RenderFrame_Free(t);
+        return NULL;
+    }
+    HGDIOBJ old = SelectObject(dc, t->hbm);
+    if (level == 0) {
+        BitBlt(dc, 0, 0, tw, th, src, sx, sy, SRCCOPY);
+    } else {
+        SetStretchBltMode(dc, HALFTONE);
+        SetBrushOrgEx(dc, 0, 0, NULL);
+        StretchBlt(dc, 0, 0, tw, th, src, sx, sy, sw, sh, SRCCOPY);
+    }
+    GdiFlush();
+    SelectObject(dc, old);
+    DeleteDC(dc);
+    return t;
+}
+
+// Eviction order: free slots, then tiles of other covers, then least recently used
+// Порядок вытеснения: свободные слоты, затем тайлы других обложек, затем давно неиспользуемые
+static int EvictRank(const Tile* t, DWORD coverId)
+{
+    if (!t->coverId) return 0;
+    return (t->coverId != coverId) ? 1 : 2;
+}
+
+static RenderFrame* GetTile(TilePyramid* p, const CoverEntry* cover, HDC src, int level, int tx, int ty)
+{
+    int victim = 0;
+    p->clock++;
+
+    for (int i = 0; i < p->cap; ++i) {
+        Tile* t = &p->tiles[i];
+        if (t->coverId == cover->id && t->level == level && t->tx == tx && t->ty == ty) {
+            t->stamp = p->clock;
+            p->stats.hits++;
+            return t->px;
+        }
+        int rt = EvictRank(t, cover->id), rv = EvictRank(&p->tiles[victim], cover->id);
+        if (rt < rv || (rt == rv && t->stamp < p->tiles[victim].stamp)) victim = i;
+    }
+
+    RenderFrame* px = BuildTile(cover, src, level, tx, ty);
+    if (!px) return NULL;
+
+    Tile* v = &p->tiles[victim];
+    if (v->coverId) p->stats.evicted++;
+    RenderFrame_Free(v->px);
+    v->coverId = cover->id;
+    v->level   = level;
+    v->tx      = tx;
+    v->ty      = ty;
+    v->px      = px;
+    v->stamp   = p->clock;
+    p->stats.built++;
+    return px;
+}
+
+// ============================================================================
+// Drawing / Отрисовка
+// ============================================================================
+
+// Screen coordinate of a cover coordinate, rounded the same way for every tile edge
+// Экранная координата точки обложки, округляемая одинаково для всех краёв тайлов
+static int ToScreen(double v, double origin, double scale)
+{
+    double s = (v - origin) * scale;
+    return (int)(s < 0 ? s - 0.5 : s + 0.5);
+}
+
+void Pyramid_Draw(TilePyramid* p, const CoverEntry* cover, HDC src, HDC dst,
+                  int W, int H, const RenderView* view, RECT* drawn)
+{
+    if (drawn) SetRectEmpty(drawn);
+    if (!p || !cover || !src || !dst || !view || view->scale <= 0 || W <= 0 || H <= 0) return;
+
+    const double s = view->scale;
+
+    // Coarsest level that is still sampled at >= 1/2 scale
+    // Самый грубый уровень, который ещё выбирается с масштабом >= 1/2
+    int level = 0;
+    int edge = (cover->sz.cx > cover->sz.cy) ? cover->sz.cx : cover->sz.cy;
+    while (s * (double)(2 << level) <= 1.0 && (edge >> (level + 1)) >= PYRAMID_TILE) ++level;
+
+    const double ox = view->cx - W / (2.0 * s);   // cover point at screen x = 0
+    const double oy = view->cy - H / (2.0 * s);
+    const int    step = PYRAMID_TILE << level;
+
+    double vx0 = ox < 0 ? 0 : ox;
+    double vy0 = oy < 0 ? 0 : oy;
+    double vx1 = ox + W / s; if (vx1 > cover->sz.cx) vx1 = cover->sz.cx;
+    double vy1 = oy + H / s; if (vy1 > cover->sz.cy) vy1 = cover->sz.cy;
+    if (vx1 <= vx0 || vy1 <= vy0) return;
+
+    int tx0 = (int)(vx0 / step), tx1 = (int)((vx1 - 1) / step);
+    int ty0 = (int)(vy0 / step), ty1 = (int)((vy1 - 1) / step);
+
+    HDC tdc = CreateCompatibleDC(dst);
+    if (!tdc) return;
+
+    // Above 1:1 keep pixels crisp; below it average
+    // Выше 1:1 пиксели остаются чёткими; ниже усредняются
+    double levelScale = s * (double)(1 << level);
+    SetStretchBltMode(dst, levelScale < 1.0 ? HALFTONE : COLORONCOLOR);
+    SetBrushOrgEx(dst, 0, 0, NULL);
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            RenderFrame* t = GetTile(p, cover, src, level, tx, ty);
+            if (!t) continue;
+
+            int sx = tx * step, sy = ty * step;
+            int ex = sx + step; if (ex > cover->sz.cx) ex = cover->sz.cx;
+            int ey = sy + step; if (ey > cover->sz.cy) ey = cover->sz.cy;
+
+            int dl = ToScreen(sx, ox, s), dr = ToScreen(ex, ox, s);
+            int dt = ToScreen(sy, oy, s), db = ToScreen(ey, oy, s);
+            if (dr <= dl || db <= dt) continue;
+
+            HGDIOBJ old = SelectObject(tdc, t->hbm);
+            StretchBlt(dst, dl, dt, dr - dl, db - dt, tdc, 0, 0, t->w, t->h, SRCCOPY);
+            SelectObject(tdc, old);
+        }
+    }
+    DeleteDC(tdc);
+
+    if (drawn) {
+        RECT img  = { ToScreen(0, ox, s), ToScreen(0, oy, s),
+                      ToScreen(cover->sz.cx, ox, s), ToScreen(cover->sz.cy, oy, s) };
+        RECT clip = { 0, 0, W, H };
+        IntersectRect(drawn, &img, &clip);
+    }
+}
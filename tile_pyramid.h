@@ -0,0 +1,111 @@
+/**
+ * @file tile_pyramid.h
+ * @brief Lazily built multi-resolution tile pyramid for zoomed cover views
+ * @brief Лениво строящаяся многоуровневая пирамида тайлов для увеличенного просмотра
+ *
+ * Booklet scans of 3000-6000 px are too large to rescale as a whole on every
+ * pan step. The pyramid splits the cover into 256x256 tiles on power-of-two
+ * levels (level 0 = full resolution, level n = 1/2^n) and builds a tile only
+ * when it becomes visible at the level a view needs. Built tiles are kept in
+ * an LRU cache sized to the view, so panning and zooming reuse them and each
+ * frame only blits the visible tiles with a scale factor close to 1.
+ *
+ * Сканы буклетов 3000-6000 px слишком велики, чтобы масштабировать их целиком
+ * на каждом шаге прокрутки. Пирамида делит обложку на тайлы 256x256 на уровнях
+ * степеней двойки (уровень 0 = полное разрешение, уровень n = 1/2^n) и строит тайл
+ * только когда он становится видимым на нужном виду уровне. Готовые тайлы хранятся
+ * в LRU-кэше по размеру вида, поэтому прокрутка и масштабирование переиспользуют их,
+ * а каждый кадр выводит только видимые тайлы с масштабом, близким к 1.
+ *
+ * @note The tag readers decode whole images, so level 0 tiles are cut from the
+ *       decoded cover bitmap rather than decoded region by region.
+ * @note Ридеры тегов декодируют изображение целиком, поэтому тайлы уровня 0
+ *       вырезаются из декодированного bitmap'а, а не декодируются по областям.
+ *
+ * @warning Not thread-safe: use from the render worker thread only
+ * @warning Не потокобезопасно: использовать только из рабочего потока отрисовки
+ *
+ * @author [Your Name]
+ * @date 2025
+ * @version 1.0
+ */
+
+#pragma once
+#include <windows.h>
+#include "render_worker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PYRAMID_TILE 256   ///< Tile edge in pixels / Сторона тайла в пикселях
+
+typedef struct TilePyramid TilePyramid;
+
+/**
+ * @brief Pyramid cache statistics / Статистика кэша пирамиды
+ */
+typedef struct {
+    DWORD built;    ///< Tiles built / Построено тайлов
+    DWORD hits;     ///< Tiles reused from cache / Тайлов взято из кэша
+    DWORD evicted;  ///< Tiles dropped by LRU / Тайлов вытеснено LRU
+} PyramidStats;
+
+/**
+ * @brief Create an empty pyramid cache
+ * @brief Создать пустой кэш пирамиды
+ *
+ * @param maxTiles Cache capacity (each tile is 256 KB) / Ёмкость кэша (каждый тайл 256 КБ)
+ * @return Pyramid or NULL / Пирамида или NULL
+ */
+TilePyramid* Pyramid_Create(int maxTiles);
+
+/**
+ * @brief Grow the cache to at least @p tiles, keeping the tiles it holds
+ * @brief Увеличить кэш минимум до @p tiles, сохранив имеющиеся тайлы
+ *
+ * @return FALSE if the memory is not there; the old capacity stays usable
+ * @return FALSE если памяти нет; прежняя ёмкость остаётся рабочей
+ */
+BOOL Pyramid_Reserve(TilePyramid* p, int tiles);
+
+/**
+ * @brief Tiles one frame of W x H may need, plus a row and a column for panning
+ * @brief Тайлов, нужных одному кадру W x H, плюс строка и столбец для прокрутки
+ *
+ * A level is sampled at a scale in (1/2, 1], so a tile covers at least
+ * PYRAMID_TILE / 2 screen pixels.
+ * Уровень выбирается с масштабом в (1/2, 1], поэтому тайл покрывает не меньше
+ * PYRAMID_TILE / 2 экранных пикселей.
+ */
+int Pyramid_TilesFor(int W, int H);
+
+/**
+ * @brief Free the pyramid and all cached tiles
+ * @brief Освободить пирамиду и все закэшированные тайлы
+ */
+void Pyramid_Destroy(TilePyramid* p);
+
+/**
+ * @brief Draw the visible part of a cover
+ * @brief Нарисовать видимую часть обложки
+ *
+ * @param p      Pyramid / Пирамида
+ * @param cover  Cover the tiles come from / Обложка-источник тайлов
+ * @param src    DC with @p cover's bitmap selected / DC с выбранным bitmap'ом @p cover
+ * @param dst    Destination DC / Целевой DC
+ * @param W, H   Destination size / Размер приёмника
+ * @param view   Scale and centre in cover pixels / Масштаб и центр в пикселях обложки
+ * @param drawn  [out] Screen rectangle covered by the image, or NULL / Экранный прямоугольник изображения, или NULL
+ */
+void Pyramid_Draw(TilePyramid* p, const CoverEntry* cover, HDC src, HDC dst,
+                  int W, int H, const RenderView* view, RECT* drawn);
+
+/**
+ * @brief Copy cache statistics / Скопировать статистику кэша
+ */
+void Pyramid_GetStats(const TilePyramid* p, PyramidStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -42,6 +42,8 @@
 #include "skin_util.h"
 #include "image_loader.h"
 #include "cover_window.h"
+#include "Extensions\zlib_inflate.h"
+#include "Extensions\mp4_reader.h"
 #include "Hotkeys.h"
 
 // ============================================================================
@@ -91,6 +93,9 @@ int UIHost_Init();
 #define DEFAULT_W    275
 #define DEFAULT_H    116
 #define WM_APT_REFRESH (WM_USER + 0x6E01)
+#ifndef WM_MOUSEWHEEL
+#define WM_MOUSEWHEEL 0x020A
+#endif
 #define WA_CMD_EQUALIZER 40258
 
 #define MENUID_APT 0x7001
@@ -231,13 +236,13 @@ static LRESULT HandleSkinChanges(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
     WADlg_init(hwnd);
     Skin_RefreshDialogBrush();
 
-    if (g_state.dlg && IsWindow(g_state.dlg)) {
-        InvalidateRect(g_state.dlg, NULL, TRUE);
-    }
-
+    // The view covers the whole dialog and repaints only what the new colours change
+    // Окно обложки закрывает весь диалог и перерисовывает только то, что меняют новые цвета
     coverView = CoverView_FindOn(g_state.dlg);
     if (coverView) {
-        InvalidateRect(coverView, NULL, TRUE);
+        CoverView_SkinChanged();
+    } else if (g_state.dlg && IsWindow(g_state.dlg)) {
+        InvalidateRect(g_state.dlg, NULL, TRUE);
     }
 
     return CallWindowProcA(g_state.oldProc, hwnd, msg, wp, lp);
@@ -456,17 +461,25 @@ static LRESULT CALLBACK DlgProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
         }
         return 0;
 
+    case WM_MOUSEWHEEL:
+        // The wheel goes to the focused dialog; the cover view does the zooming
+        // Колесо приходит в диалог с фокусом; масштабирует окно обложки
+        view = CoverView_FindOn(hwnd);
+        if (view) {
+            SendMessage(view, msg, wp, lp);
+            return TRUE;
+        }
+        return 0;
+
     case WM_DISPLAYCHANGE:
     case WM_SYSCOLORCHANGE:
         WADlg_init(UIHost_GetWinampWnd());
         Skin_RefreshDialogBrush();
-        InvalidateRect(hwnd, NULL, TRUE);
 
+        // The view invalidates what changed itself / Окно обложки само объявляет изменившееся
         view = CoverView_FindOn(hwnd);
-        if (view) {
-            SendMessage(view, msg, wp, lp);
-            InvalidateRect(view, NULL, TRUE);
-        }
+        if (view) SendMessage(view, msg, wp, lp);
+        else      InvalidateRect(hwnd, NULL, TRUE);
         return 0;
 
     case WM_CLOSE:
@@ -671,6 +684,8 @@ void UIHost_Quit(void)
 
     Skin_DeleteDialogBrush();
     Img_Cleanup();
+    Inflate_ReleaseScratch(TRUE);
+    MP4_ReleaseChapters();
 
     {
         HINSTANCE hi = UIHost_GetHInstance();
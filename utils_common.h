@@ -15,12 +15,14 @@
  * - RAII file handle wrapper for automatic cleanup
  * - Endianness conversion (big-endian/little-endian)
  * - 64-bit safe file positioning
+ * - Read window for header walks, with read statistics
  * - SyncSafe integer decoding (ID3v2/FLAC)
  * - FourCC code generation
  * 
  * - RAII обёртка дескриптора файла для автоматической очистки
  * - Конверсия порядка байтов (big-endian/little-endian)
  * - 64-битная безопасная позиция в файле
+ * - Окно чтения для обхода заголовков, со статистикой чтений
  * - Декодирование SyncSafe целых чисел (ID3v2/FLAC)
  * - Генерация FourCC кодов
  * 
@@ -41,6 +43,38 @@
 // RAII File Wrapper / RAII обёртка файла
 // ============================================================================
 
+/**
+ * @brief File size of an open handle, 64-bit
+ * @brief Размер файла по открытому дескриптору, 64 бита
+ * 
+ * @return File size in bytes, or 0 on failure / Размер файла в байтах, или 0 при ошибке
+ */
+inline unsigned __int64 FileSize64(HANDLE h) {
+    DWORD hi = 0;
+    DWORD lo = GetFileSize(h, &hi);
+    if (lo == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) return 0;
+    return ((unsigned __int64)hi << 32) | lo;
+}
+
+/**
+ * @brief Read exactly @p size bytes at a 64-bit offset of an open handle
+ * @brief Прочитать ровно @p size байт по 64-битному смещению открытого дескриптора
+ * 
+ * @return TRUE if all bytes were read / TRUE если прочитаны все байты
+ */
+inline BOOL ReadFileAt(HANDLE h, unsigned __int64 offset, void* buf, DWORD size) {
+    // Split 64-bit offset into high and low 32-bit parts
+    // Разделить 64-битное смещение на высокую и низкую 32-битные части
+    LONG hi = (LONG)(offset >> 32);
+    DWORD lo = (DWORD)(offset & 0xFFFFFFFF);
+    if (SetFilePointer(h, lo, &hi, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+        GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+    DWORD rd = 0;
+    return ReadFile(h, buf, size, &rd, NULL) && rd == size;
+}
+
 /**
  * @class FileHandle
  * @brief RAII wrapper for Windows file handles
@@ -150,6 +184,16 @@ public:
     DWORD GetSize() const { 
         return IsValid() ? GetFileSize(h, NULL) : 0; 
     }
+
+    /**
+     * @brief Get file size, 64-bit
+     * @brief Получить размер файла, 64 бита
+     * 
+     * @return File size in bytes, or 0 if invalid / Размер файла в байтах, или 0 если невалиден
+     */
+    unsigned __int64 GetSize64() const {
+        return IsValid() ? FileSize64(h) : 0;
+    }
     
     /**
      * @brief Read exact number of bytes from current position
@@ -186,19 +230,7 @@ public:
      * @note Автоматически переходит к смещению перед чтением
      */
     BOOL ReadAt(unsigned __int64 offset, void* buf, DWORD size) {
-        if (!IsValid()) return FALSE;
-        
-        // Split 64-bit offset into high and low 32-bit parts
-        // Разделить 64-битное смещение на высокую и низкую 32-битные части
-        LONG hi = (LONG)(offset >> 32);
-        DWORD lo = (DWORD)(offset & 0xFFFFFFFF);
-        
-        // Seek to position / Переход к позиции
-        if (SetFilePointer(h, lo, &hi, FILE_BEGIN) == INVALID_SET_FILE_POINTER) {
-            if (GetLastError() != NO_ERROR) return FALSE;
-        }
-        
-        return Read(buf, size);
+        return IsValid() && ReadFileAt(h, offset, buf, size);
     }
     
     /**
@@ -214,6 +246,105 @@ public:
     }
 };
 
+// ============================================================================
+// Read Window / Окно чтения
+// ============================================================================
+
+/**
+ * @brief File bytes held in memory while a reader walks headers
+ * @brief Байты файла, хранимые в памяти, пока ридер обходит заголовки
+ *
+ * Neighbouring headers usually sit in the same block, so a walk costs one
+ * read per block rather than one per header. Plain data set up by
+ * FileWindow_Init(), so it can live inside a reader's own state.
+ * Соседние заголовки обычно лежат в одном блоке, поэтому обход стоит одного
+ * чтения на блок, а не на заголовок. Простые данные, заполняемые
+ * FileWindow_Init(), поэтому окно может жить внутри состояния ридера.
+ */
+typedef struct {
+    FileHandle* f;
+    unsigned __int64 end;    ///< Reads stop here: the file size unless narrowed / Чтения не заходят дальше: размер файла, если не сужен
+    BYTE*  buf;
+    DWORD  cap, len;
+    unsigned __int64 pos;    ///< File offset of buf[0] / Смещение buf[0] в файле
+    DWORD  block;            ///< Read size / Размер чтения
+    DWORD  tail;             ///< Within this many bytes of the end a read runs to the end, 0 = off / В пределах стольких байт от конца чтение идёт до конца, 0 = выкл.
+    DWORD* reads;            ///< Caller statistics, may be NULL / Статистика вызывающего, может быть NULL
+    DWORD* bytesRead;
+} FileWindow;
+
+/**
+ * @brief Attach a window to an open file / Привязать окно к открытому файлу
+ */
+inline void FileWindow_Init(FileWindow* w, FileHandle& f, DWORD block, DWORD* reads, DWORD* bytesRead) {
+    ZeroMemory(w, sizeof(*w));
+    w->f         = &f;
+    w->end       = f.GetSize64();
+    w->block     = block;
+    w->reads     = reads;
+    w->bytesRead = bytesRead;
+}
+
+inline void FileWindow_Free(FileWindow* w) {
+    if (w->buf) GlobalFree(w->buf);
+    w->buf = NULL;
+    w->cap = w->len = 0;
+}
+
+/**
+ * @brief Read straight from the file, counted in the window's statistics
+ * @brief Прочитать прямо из файла с учётом в статистике окна
+ */
+inline BOOL FileWindow_ReadAt(FileWindow* w, unsigned __int64 at, void* buf, DWORD size) {
+    if (w->reads) ++*w->reads;
+    if (w->bytesRead) *w->bytesRead += size;
+    return w->f->ReadAt(at, buf, size);
+}
+
+/**
+ * @brief Bytes [at, at + need) if the window already holds them
+ * @brief Байты [at, at + need), если окно их уже держит
+ *
+ * @return Pointer into the window or NULL / Указатель в окно или NULL
+ */
+inline const BYTE* FileWindow_Held(const FileWindow* w, unsigned __int64 at, DWORD need) {
+    if (w->len && at >= w->pos && at - w->pos <= w->len && need <= w->len - (DWORD)(at - w->pos)) {
+        return w->buf + (DWORD)(at - w->pos);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Bytes [at, at + need), reading a block from @p at only if they are not held
+ * @brief Байты [at, at + need); блок от @p at читается, только если их нет в памяти
+ *
+ * The pointer stays valid until the next call.
+ * Указатель действителен до следующего вызова.
+ *
+ * @return Pointer into the window, or NULL past the end / Указатель в окно, или NULL за концом
+ */
+inline const BYTE* FileWindow_View(FileWindow* w, unsigned __int64 at, DWORD need) {
+    const BYTE* p = FileWindow_Held(w, at, need);
+    if (p) return p;
+    if (at >= w->end || need > w->end - at) return NULL;
+
+    DWORD cb = (need > w->block) ? need : w->block;
+    if ((unsigned __int64)cb > w->end - at || (w->tail && w->end - at <= w->tail)) {
+        cb = (DWORD)(w->end - at);
+    }
+    if (cb > w->cap) {
+        if (w->buf) GlobalFree(w->buf);
+        w->buf = (BYTE*)GlobalAlloc(GMEM_FIXED, cb);
+        w->cap = w->buf ? cb : 0;
+        if (!w->buf) return NULL;
+    }
+    w->len = 0;
+    if (!FileWindow_ReadAt(w, at, w->buf, cb)) return NULL;
+    w->pos = at;
+    w->len = cb;
+    return w->buf;
+}
+
 // ============================================================================
 // Endianness Conversion Helpers / Помощники конверсии порядка байтов
 // ============================================================================
@@ -283,6 +414,31 @@ inline DWORD LE32(const BYTE* p) {
            ((DWORD)p[2] << 16) | ((DWORD)p[3] << 24);
 }
 
+/**
+ * @brief Convert 2 bytes from little-endian to native
+ * @brief Конвертировать 2 байта из little-endian в нативный
+ * 
+ * Used for: ASF attribute lengths
+ * Используется для: Длин атрибутов ASF
+ */
+inline DWORD LE16(const BYTE* p) {
+    return ((DWORD)p[0]) | ((DWORD)p[1] << 8);
+}
+
+/**
+ * @brief Convert 8 bytes from little-endian to 64-bit value
+ * @brief Конвертировать 8 байтов из little-endian в 64-битное значение
+ * 
+ * Used for: DSF and RF64 sizes, ASF objects
+ * Используется для: Размеров DSF и RF64, объектов ASF
+ * 
+ * @param p Pointer to 8 bytes / Указатель на 8 байтов
+ * @return 64-bit value in native endianness / 64-битное значение в нативном порядке байтов
+ */
+inline unsigned __int64 LE64(const BYTE* p) {
+    return (unsigned __int64)LE32(p) | ((unsigned __int64)LE32(p + 4) << 32);
+}
+
 // ============================================================================
 // Specialized Decoders / Специализированные декодеры
 // ============================================================================